@@ -45,6 +45,7 @@ private:
 	void ResetIntoPwmMode();
 	void ZeroAmplifierOutput();
 	void Reset();
+	void RecordTelemetry();
 
 	/** HWSerial Elements */
 	// HWSerial commands
@@ -43,3 +43,11 @@ inline constexpr unsigned short AMPLIFIER_PWM_MAX  = 1;		  // Maximum PWM value
 inline constexpr unsigned short TIMING_FREQ_AMPLIFIER_DRIVE			 = 1000;	// Hz
 inline constexpr unsigned short TIMING_FREQ_AMPLIFIER_HWSERIAL		 = 20;		// Hz
 inline constexpr unsigned short TIMING_FREQ_AMPLIFIER_SOFTWARESERIAL = 200;		// Hz
+
+/**
+ * @brief Telemetry config values
+ * 
+ */
+inline constexpr bool			TELEMETRY_SEND_BATCHES = true;	  // Send every drive tick in batches instead of one snapshot per serial tick
+inline constexpr unsigned short TELEMETRY_BATCH_SIZE   = 8;		  // Samples per packet, 5 per serial tick plus room to catch up
+inline constexpr unsigned short TELEMETRY_RING_SIZE	   = 32;	  // Samples kept for the next packet, power of two
@@ -29,4 +29,45 @@ struct PacketStruct {
 	uint8_t	 toggleReverseFlag = 0;
 };
 
-#pragma pack( pop )
\ No newline at end of file
+
+
+/**
+ * @brief One drive tick of amplifier telemetry
+ * 
+ */
+struct TelemetrySampleStruct {
+
+	// Elements
+	uint32_t timeUS	  = 0;	  // micros() at the drive tick
+	uint16_t pwmA	  = 0;
+	uint16_t pwmB	  = 0;
+	uint16_t pwmC	  = 0;
+	int16_t	 currentA = 0;
+	int16_t	 currentB = 0;
+	int16_t	 currentC = 0;
+	int32_t	 encoderA = 0;
+	int32_t	 encoderB = 0;
+	int32_t	 encoderC = 0;
+};
+
+
+
+/**
+ * @brief Struct for batched telemetry packet (Teensy to C++), told apart from PacketStruct by its length
+ * 
+ */
+struct TelemetryPacketStruct {
+
+	// Elements
+	uint8_t				  packetType		= 0;
+	uint8_t				  packetCounter		= 0;
+	uint8_t				  amplifierState	= 0;
+	uint8_t				  toggleReverseFlag = 0;
+	uint16_t			  sampleIndex		= 0;	// Index of samples[0], wraps, a gap means samples were lost
+	uint8_t				  nSamples			= 0;	// Valid samples, oldest first
+	TelemetrySampleStruct samples[TELEMETRY_BATCH_SIZE];
+};
+
+#pragma pack( pop )
+
+static_assert( sizeof( TelemetryPacketStruct ) <= 255, "Frame length is one byte" );
\ No newline at end of file
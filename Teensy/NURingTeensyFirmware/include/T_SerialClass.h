@@ -44,6 +44,8 @@ private:
 	void ReadPacketFromPC();
 	void ParsePacketFromPC( PacketStruct* pkt );
 	void SendPacketToPC();
+	void SendTelemetryToPC( uint8_t outgoingType );
+	void WriteFrameToPC( const uint8_t* payload, uint8_t packetLength );
 
 
 	// Packet variables
@@ -99,6 +99,21 @@ struct SystemStruct {
 
 
 
+/**
+ * @brief Drive tick samples waiting to be sent, written by the drive timer
+ * 
+ */
+struct TelemetryStruct {
+
+	TelemetrySampleStruct samples[TELEMETRY_RING_SIZE];
+	volatile uint16_t	  nRecorded = 0;	// Samples written, wraps, masked into the ring
+	uint16_t			  nSent		= 0;	// Samples handed to the PC, loop only
+
+	static_assert( ( TELEMETRY_RING_SIZE & ( TELEMETRY_RING_SIZE - 1 ) ) == 0 && TELEMETRY_RING_SIZE >= TELEMETRY_BATCH_SIZE, "Ring must be a power of two holding a batch" );
+};
+
+
+
 struct TimingStruct {
 
 	// Interval timer periods
@@ -120,6 +135,7 @@ struct ManagedData {
 	LEDStruct		LED;
 	SerialStruct	Serial;
 	SystemStruct	System;
+	TelemetryStruct Telemetry;
 	TimingStruct	Timing;
 
 	// Point to serial class
@@ -321,6 +321,36 @@ void T_AmplifierClass::Update() {
 	if ( HWSerialC.available() ) {
 		T_AmplifierClass::HWSerial_ReadQueryC();
 	}
+
+	// Keep this tick for the next telemetry packet
+	RecordTelemetry();
+}
+
+
+
+/**
+ * @brief Store the commanded PWM and latest readings of this drive tick in the telemetry ring
+ *
+ * Runs in the drive timer interrupt, the loop reads the ring with interrupts off. A loop that
+ * falls more than a ring behind loses the oldest samples, the PC sees the gap in sampleIndex.
+ */
+void T_AmplifierClass::RecordTelemetry() {
+
+	uint16_t			   nRecorded = shared->Telemetry.nRecorded;
+	TelemetrySampleStruct& sample	 = shared->Telemetry.samples[nRecorded & ( TELEMETRY_RING_SIZE - 1 )];
+
+	sample.timeUS	= micros();
+	sample.pwmA		= shared->Amplifier.commandedPwmA;
+	sample.pwmB		= shared->Amplifier.commandedPwmB;
+	sample.pwmC		= shared->Amplifier.commandedPwmC;
+	sample.currentA = shared->Amplifier.currentMeasuredRawA;
+	sample.currentB = shared->Amplifier.currentMeasuredRawB;
+	sample.currentC = shared->Amplifier.currentMeasuredRawC;
+	sample.encoderA = shared->Amplifier.encoderMeasuredCountA;
+	sample.encoderB = shared->Amplifier.encoderMeasuredCountB;
+	sample.encoderC = shared->Amplifier.encoderMeasuredCountC;
+
+	shared->Telemetry.nRecorded = nRecorded + 1;
 }
 
 
@@ -301,6 +301,12 @@ void T_SerialClass::SendPacketToPC() {
 	};
 
 
+	// Every drive tick since the last packet, or a snapshot of the latest one
+	if ( TELEMETRY_SEND_BATCHES ) {
+		SendTelemetryToPC( outgoingType );
+		return;
+	}
+
 	// Populate packet
 	outgoingPacket.packetType		 = outgoingType;
 	outgoingPacket.packetCounter	 = shared->Amplifier.packetCounter;
@@ -316,29 +322,78 @@ void T_SerialClass::SendPacketToPC() {
 	outgoingPacket.currentC			 = shared->Amplifier.currentMeasuredRawC;
 	outgoingPacket.toggleReverseFlag = shared->Amplifier.toggleReverse;
 
-	// Measure packet length
-	const uint8_t packetLength = sizeof( outgoingPacket );
+	WriteFrameToPC( reinterpret_cast<uint8_t*>( &outgoingPacket ), sizeof( outgoingPacket ) );
+}
+
+
+
+/**
+ * @brief Send the drive tick samples recorded since the last packet, oldest first
+ *
+ * @param outgoingType Packet type for the current state, as for PacketStruct
+ */
+void T_SerialClass::SendTelemetryToPC( uint8_t outgoingType ) {
+
+	TelemetryPacketStruct outgoingPacket;
+
+	// Populate header
+	outgoingPacket.packetType		 = outgoingType;
+	outgoingPacket.packetCounter	 = shared->Amplifier.packetCounter;
+	outgoingPacket.amplifierState	 = shared->Amplifier.isEnabled;
+	outgoingPacket.toggleReverseFlag = shared->Amplifier.toggleReverse;
+
+	// Copy samples out with the drive timer held off
+	noInterrupts();
+	uint16_t nPending = shared->Telemetry.nRecorded - shared->Telemetry.nSent;
+	if ( nPending > TELEMETRY_RING_SIZE ) {
+		shared->Telemetry.nSent = shared->Telemetry.nRecorded - TELEMETRY_RING_SIZE;	// Overwritten, skip
+		nPending				= TELEMETRY_RING_SIZE;
+	}
+	uint8_t nSamples = min( nPending, TELEMETRY_BATCH_SIZE );
+	for ( uint8_t i = 0; i < nSamples; i++ ) {
+		outgoingPacket.samples[i] = shared->Telemetry.samples[( shared->Telemetry.nSent + i ) & ( TELEMETRY_RING_SIZE - 1 )];
+	}
+	interrupts();
+
+	outgoingPacket.sampleIndex = shared->Telemetry.nSent;
+	outgoingPacket.nSamples	   = nSamples;
+	shared->Telemetry.nSent += nSamples;
+
+	WriteFrameToPC( reinterpret_cast<uint8_t*>( &outgoingPacket ), sizeof( outgoingPacket ) );
+}
+
+
+
+/**
+ * @brief Frame a packet and write it to the PC port
+ *
+ * Frame: start byte, payload length, checksum, payload, end byte. The PC tells packet kinds apart
+ * by the length.
+ *
+ * @param payload Packet bytes, the packet type first
+ * @param packetLength Payload length
+ */
+void T_SerialClass::WriteFrameToPC( const uint8_t* payload, uint8_t packetLength ) {
 
 	// Compute checksum
-	uint8_t	 checkSum = outgoingType ^ packetLength;
-	uint8_t* raw	  = reinterpret_cast<uint8_t*>( &outgoingPacket );
+	uint8_t checkSum = payload[0] ^ packetLength;
 	for ( uint8_t i = 0; i < packetLength; ++i ) {
-		checkSum ^= raw[i];
+		checkSum ^= payload[i];
 	}
 
 	// Build buffer header
-	uint8_t buffer[32];
+	uint8_t buffer[sizeof( TelemetryPacketStruct ) + 4];
 	size_t	idx	  = 0;
 	buffer[idx++] = startByte;		 // 0xAA
 	buffer[idx++] = packetLength;	 // sizeof(outgoingPacket)
-	buffer[idx++] = checkSum;		 // sizeof(outgoingPacket)
+	buffer[idx++] = checkSum;
 
 	// Copy packet into buffer
-	memcpy( &buffer[idx], &outgoingPacket, packetLength );
+	memcpy( &buffer[idx], payload, packetLength );
 
 	// Build buffer footer
 	idx += packetLength;
-	buffer[idx++] = endByte;	// sizeof(outgoingPacket)
+	buffer[idx++] = endByte;
 
 
 
@@ -348,7 +403,7 @@ void T_SerialClass::SendPacketToPC() {
 		PrintDebug( "Nothing sent!" );
 
 	} else {
-		PrintDebug( "Sent: " + String( outgoingPacket.packetType ) );
+		PrintDebug( "Sent: " + String( payload[0] ) );
 		// Success
 	}
 }
\ No newline at end of file
@@ -0,0 +1,99 @@
+// Call to header
+#include "Benchmark.h"
+
+// Standard libraries
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <unistd.h>
+
+// OpenCV version and threads
+#include <opencv2/core.hpp>
+
+
+// Every printed result, kept for the JSON report
+static std::vector<BenchmarkResult> results;
+
+// Correctness checks that did not pass
+static std::vector<std::string> failedChecks;
+
+
+/**
+ * @brief Print one result line to the console
+ */
+void PrintResult( const BenchmarkResult& result ) {
+	std::cout << std::left << std::setw( 32 ) << result.name << std::right << std::fixed << std::setprecision( 3 ) << " n = " << std::setw( 5 ) << result.iterations << "   mean = " << std::setw( 8 ) << result.meanMs << " ms   p50 = " << std::setw( 8 ) << result.p50Ms << " ms   p95 = " << std::setw( 8 ) << result.p95Ms
+			  << " ms   max = " << std::setw( 8 ) << result.maxMs << " ms\n";
+	results.push_back( result );
+}
+
+
+
+/**
+ * @brief Record the outcome of a correctness check, any failure fails the whole run
+ *
+ * @param name Check name as printed in the report
+ * @param isPassed Outcome
+ * @return bool isPassed, for printing
+ */
+bool ReportCheck( const std::string& name, bool isPassed ) {
+	if ( !isPassed ) {
+		failedChecks.push_back( name );
+	}
+	return isPassed;
+}
+
+
+
+/**
+ * @brief Names of the checks that failed so far
+ */
+const std::vector<std::string>& FailedChecks() {
+	return failedChecks;
+}
+
+
+
+/**
+ * @brief Write every printed result with machine metadata, for comparing runs across commits
+ *
+ * @param path Output file
+ * @return true if the file was written
+ */
+bool WriteResultsJson( const std::string& path ) {
+
+	std::ofstream file( path );
+	if ( !file.is_open() ) {
+		std::cerr << "Benchmarks:   Could not write " << path << "\n";
+		return false;
+	}
+
+	// Machine and build
+	char hostname[256] = "";
+	gethostname( hostname, sizeof( hostname ) - 1 );
+	std::time_t now = std::time( nullptr );
+	char		date[32];
+	std::strftime( date, sizeof( date ), "%Y-%m-%dT%H:%M:%S", std::localtime( &now ) );
+
+	file << "{\n";
+	file << "  \"date\": \"" << date << "\",\n";
+	file << "  \"host\": \"" << hostname << "\",\n";
+	file << "  \"opencv\": \"" << CV_VERSION << "\",\n";
+	file << "  \"cpuThreads\": " << std::thread::hardware_concurrency() << ",\n";
+	file << "  \"opencvThreads\": " << cv::getNumThreads() << ",\n";
+	file << "  \"results\": [\n";
+
+	// One object per case, times in milliseconds
+	file << std::fixed << std::setprecision( 6 );
+	for ( size_t i = 0; i < results.size(); i++ ) {
+		const BenchmarkResult& result = results[i];
+		file << "    { \"name\": \"" << result.name << "\", \"iterations\": " << result.iterations << ", \"meanMs\": " << result.meanMs << ", \"p50Ms\": " << result.p50Ms << ", \"p95Ms\": " << result.p95Ms << ", \"maxMs\": " << result.maxMs << " }"
+			 << ( i + 1 < results.size() ? "," : "" ) << "\n";
+	}
+	file << "  ]\n}\n";
+
+	std::cout << "Benchmarks:   Saved " << results.size() << " results to " << path << "\n";
+	return true;
+}
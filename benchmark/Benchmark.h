@@ -0,0 +1,93 @@
+#pragma once
+
+// Standard libraries
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+
+
+/**
+ * @brief Summary of one timed benchmark case
+ */
+struct BenchmarkResult {
+	std::string name	   = "";
+	int			iterations = 0;
+	double		meanMs	   = 0.0;
+	double		p50Ms	   = 0.0;
+	double		p95Ms	   = 0.0;
+	double		maxMs	   = 0.0;
+};
+
+
+/**
+ * @brief Reduce per-call timings to a result
+ *
+ * @param name Case name as printed in the report
+ * @param samples Per-call times in milliseconds, reordered in place
+ * @return BenchmarkResult Per-call statistics in milliseconds
+ */
+inline BenchmarkResult SummarizeSamples( const std::string& name, std::vector<double>& samples ) {
+
+	BenchmarkResult result;
+	result.name		  = name;
+	result.iterations = int( samples.size() );
+	if ( samples.empty() ) {
+		return result;
+	}
+
+	for ( double sample : samples ) {
+		result.meanMs += sample / samples.size();
+	}
+	std::sort( samples.begin(), samples.end() );
+	result.p50Ms = samples[size_t( 0.50 * ( samples.size() - 1 ) )];
+	result.p95Ms = samples[size_t( 0.95 * ( samples.size() - 1 ) )];
+	result.maxMs = samples.back();
+
+	return result;
+}
+
+
+/**
+ * @brief Time a callable over a number of iterations after a short warm-up
+ *
+ * @param name Case name as printed in the report
+ * @param iterations Number of timed calls
+ * @param body Callable under test
+ * @return BenchmarkResult Per-call statistics in milliseconds
+ */
+template <typename Function>
+BenchmarkResult RunBenchmark( const std::string& name, int iterations, Function&& body ) {
+
+	// Warm up caches, thread pools and lazy allocations
+	for ( int i = 0; i < std::max( 1, iterations / 10 ); i++ ) {
+		body();
+	}
+
+	// Timed calls
+	std::vector<double> samples( iterations );
+	for ( int i = 0; i < iterations; i++ ) {
+		auto timeStart = std::chrono::steady_clock::now();
+		body();
+		samples[i] = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - timeStart ).count();
+	}
+
+	return SummarizeSamples( name, samples );
+}
+
+
+// Reporting
+void							PrintResult( const BenchmarkResult& result );
+bool							ReportCheck( const std::string& name, bool isPassed );
+const std::vector<std::string>& FailedChecks();
+bool							WriteResultsJson( const std::string& path );
+
+// Benchmark suites
+void BenchmarkCapture();
+void BenchmarkCornerSpace( const std::string& recordedPath );
+void BenchmarkSynthetic();
+void BenchmarkTracking();
+void BenchmarkPyramid();
+void BenchmarkPose();
+void BenchmarkCore();
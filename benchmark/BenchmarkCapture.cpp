@@ -0,0 +1,85 @@
+// Benchmark harness
+#include "Benchmark.h"
+
+// Classes under test
+#include "SystemDataManager.h"
+#include "UndistortClass.h"
+
+
+/**
+ * @brief Capture preprocessing cost per 1600x1200 frame on each backend
+ */
+void BenchmarkCapture() {
+
+	// Stand-alone data manager
+	SystemDataManager dataHandle;
+	auto			  shared = dataHandle.getData();
+	UndistortClass	  Undistort( dataHandle );
+
+	// Random camera-sized frame
+	cv::Mat frameRaw( CONFIG_CAM_HEIGHT, CONFIG_CAM_WIDTH, CV_8UC3 );
+	cv::Mat frameUndistorted, frameGray;
+	cv::randu( frameRaw, 0, 255 );
+
+	// Fused kernel against the multi-pass pipeline, upright and rotated. Pixels whose source lies
+	// outside the camera image are clamped by the kernel but black after remap, so they are left out.
+	// The fixed-point gray is within one level of cvtColor, the contrast stretches that to two.
+	cv::Mat mapFixed, mapUnused, maskInside;
+	cv::convertMaps( shared->Capture.matRemap1, shared->Capture.matRemap2, mapFixed, mapUnused, CV_16SC2, true );
+	std::vector<cv::Mat> coordinates;
+	cv::split( mapFixed, coordinates );
+	maskInside = ( coordinates[0] >= 0 ) & ( coordinates[0] < CONFIG_CAM_WIDTH ) & ( coordinates[1] >= 0 ) & ( coordinates[1] < CONFIG_CAM_HEIGHT );
+
+	double maxDifference = 0.0;
+	for ( bool isRotated : { false, true } ) {
+		cv::Mat reference, mask = maskInside.clone();
+		cv::remap( frameRaw, reference, shared->Capture.matRemap1, shared->Capture.matRemap2, cv::INTER_NEAREST );
+		cv::cvtColor( reference, reference, cv::COLOR_BGR2GRAY );
+		if ( isRotated ) {
+			cv::flip( reference, reference, -1 );
+			cv::flip( mask, mask, -1 );
+		}
+		reference.convertTo( reference, -1, CONFIG_CAM_GRAY_ALPHA, CONFIG_CAM_GRAY_BETA );
+
+		shared->Capture.rotateCamera = isRotated;
+		Undistort.ProcessCPU( frameRaw, frameUndistorted, frameGray, false );
+
+		cv::Mat difference;
+		double	differenceRun = 0.0;
+		cv::absdiff( frameGray, reference, difference );
+		cv::minMaxLoc( difference, nullptr, &differenceRun, nullptr, nullptr, mask );
+		maxDifference = std::max( maxDifference, differenceRun );
+	}
+	bool isReferencePassed = ReportCheck( "capture/cpu_matches_reference", maxDifference <= 2.0 );
+	std::cout << "capture/cpu_matches_reference    max difference = " << maxDifference << " levels" << ( isReferencePassed ? "\n" : "   FAILED\n" );
+
+	// Previous multi-pass CPU pipeline for reference: remap, gray, two flips, contrast
+	PrintResult( RunBenchmark( "capture/cpu_multipass", 300, [&]() {
+		cv::remap( frameRaw, frameUndistorted, shared->Capture.matRemap1, shared->Capture.matRemap2, cv::INTER_NEAREST );
+		cv::cvtColor( frameUndistorted, frameGray, cv::COLOR_BGR2GRAY );
+		cv::flip( frameGray, frameGray, -1 );
+		cv::flip( frameUndistorted, frameUndistorted, -1 );
+		frameGray.convertTo( frameGray, -1, CONFIG_CAM_GRAY_ALPHA, CONFIG_CAM_GRAY_BETA );
+	} ) );
+
+	// CPU backend, fused gray kernel with and without the display image
+	shared->Capture.rotateCamera = false;
+	PrintResult( RunBenchmark( "capture/cpu", 300, [&]() { Undistort.ProcessCPU( frameRaw, frameUndistorted, frameGray, true ); } ) );
+	shared->Capture.rotateCamera = true;
+	PrintResult( RunBenchmark( "capture/cpu_rotated", 300, [&]() { Undistort.ProcessCPU( frameRaw, frameUndistorted, frameGray, true ); } ) );
+	PrintResult( RunBenchmark( "capture/cpu_gray_only", 300, [&]() { Undistort.ProcessCPU( frameRaw, frameUndistorted, frameGray, false ); } ) );
+
+	// Corner-space mode, raw gray only and with a display frame
+	PrintResult( RunBenchmark( "capture/raw_gray_only", 300, [&]() { Undistort.ProcessRaw( frameRaw, frameUndistorted, frameGray, false ); } ) );
+	PrintResult( RunBenchmark( "capture/raw_with_display", 300, [&]() { Undistort.ProcessRaw( frameRaw, frameUndistorted, frameGray, true ); } ) );
+
+	// GPU backend
+	if ( shared->Capture.isGpuAvailable ) {
+		shared->Capture.rotateCamera = false;
+		PrintResult( RunBenchmark( "capture/gpu", 300, [&]() { Undistort.ProcessGPU( frameRaw, frameUndistorted, frameGray, true ); } ) );
+		shared->Capture.rotateCamera = true;
+		PrintResult( RunBenchmark( "capture/gpu_rotated", 300, [&]() { Undistort.ProcessGPU( frameRaw, frameUndistorted, frameGray, true ); } ) );
+	} else {
+		std::cout << "capture/gpu                      skipped, no CUDA device\n";
+	}
+}
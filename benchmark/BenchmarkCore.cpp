@@ -0,0 +1,278 @@
+// Benchmark harness
+#include "Benchmark.h"
+
+// Standard libraries
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+// Classes under test
+#include "ControllerClass.h"
+#include "DisplayClass.h"
+#include "KalmanClass.h"
+#include "LoggingClass.h"
+#include "SerialClass.h"
+#include "SystemDataManager.h"
+
+
+/**
+ * @brief Motor shares as the sector formulas computed them before the allocation table
+ *
+ * Kept as the reference for ControllerClass::AllocateTerms, with the motor outside the sector at
+ * zero instead of whatever the previous call left there.
+ */
+static cv::Point3f LegacyContribution( cv::Point3f terms, float depth ) {
+
+	const float thA	 = 35.0f * DEG2RAD;
+	const float thB	 = 145.0f * DEG2RAD;
+	const float thC	 = 270.0f * DEG2RAD;
+	const float thAB = 110.0f * DEG2RAD;
+	const float thBC = 125.0f * DEG2RAD;
+	const float thAC = 125.0f * DEG2RAD;
+
+	cv::Point3f contribution = cv::Point3f( 0.0f, 0.0f, 0.0f );
+	float		thAT = 0.0f, thBT = 0.0f, thCT = 0.0f;
+
+	float thTarget = std::atan2( terms.y, terms.x );
+	float rTarget  = cv::norm( cv::Vec2f( terms.x, terms.y ) );
+	float rMax	   = std::clamp( float( std::atan2( rTarget, depth ) ), 0.0f, float( 40.0 * DEG2RAD ) ) / ( 40.0 * DEG2RAD );
+
+	if ( thTarget < 0 ) {
+		thTarget += ( 360.0f * DEG2RAD );
+	}
+
+	if ( thTarget >= ( 270 * DEG2RAD ) || thTarget < ( 35 * DEG2RAD ) ) {
+		if ( thTarget < thA ) {
+			thAT = thA - thTarget;
+			thCT = thAC - thAT;
+		}
+		if ( thTarget > thC ) {
+			thCT = thTarget - thC;
+			thAT = thAC - thCT;
+		}
+		contribution.x = ( 1.0f - ( thAT / thAC ) ) * rMax;
+		contribution.z = ( 1.0f - ( thCT / thAC ) ) * rMax;
+	} else if ( thTarget < ( 145 * DEG2RAD ) ) {
+		thAT		   = thTarget - thA;
+		thBT		   = thAB - thAT;
+		contribution.x = ( 1.0f - ( thAT / thAB ) ) * rMax;
+		contribution.y = ( 1.0f - ( thBT / thAB ) ) * rMax;
+	} else {
+		thBT		   = thTarget - thB;
+		thCT		   = thBC - thBT;
+		contribution.y = ( 1.0f - ( thBT / thBC ) ) * rMax;
+		contribution.z = ( 1.0f - ( thCT / thBC ) ) * rMax;
+	}
+
+	return contribution;
+}
+
+
+
+/**
+ * @brief Per-frame cost of the filter, controller, packet framing, logging and overlay stages
+ *
+ * Everything runs on a stand-alone data manager with a target moving on a circle at 90 Hz, so the
+ * numbers line up with the loop stages reported by the profiler.
+ */
+void BenchmarkCore() {
+
+	// Stand-alone data manager
+	SystemDataManager dataHandle;
+	auto			  shared = dataHandle.getData();
+
+	// Target on a 20 mm circle in front of the camera, one step per 90 Hz frame
+	const float dt	   = 1.0f / 90.0f;
+	int			nFrame = 0;
+
+	auto circleAt = [&]( int n ) {
+		float theta = 2.0f * float( CV_PI ) * ( n % 360 ) / 360.0f;
+		return cv::Point3f( 20.0f * std::cos( theta ), 20.0f * std::sin( theta ), 200.0f );
+	};
+
+	shared->Target.isTargetFound		= true;
+	shared->Target.positionUnfilteredMM = circleAt( 0 );
+
+	// Kalman bank update on noisy measurements, active marker only and every bank marker in view
+	KalmanClass Kalman( dataHandle );
+	cv::RNG		rng( 1 );
+	int			activeSlot = MarkerBankSlot( shared->Target.activeID );
+	Kalman.Initialize( circleAt( 0 ), 0.0f );
+
+	for ( bool isEveryMarker : { false, true } ) {
+		PrintResult( RunBenchmark( isEveryMarker ? "core/kalman_update_all_markers" : "core/kalman_update", 20000, [&]() {
+			nFrame++;
+			for ( size_t s = 0; s < CONFIG_MARKER_BANK_SIZE; s++ ) {
+				shared->Target.isMarkerFound[s]		= isEveryMarker || int( s ) == activeSlot;
+				shared->Target.markerPositionsMM[s] = circleAt( nFrame + 30 * int( s ) ) + cv::Point3f( rng.gaussian( 0.3 ), rng.gaussian( 0.3 ), rng.gaussian( 0.3 ) );
+				shared->Target.markerVarianceMM2[s] = cv::Point3f( 0.09f, 0.09f, 0.09f );
+			}
+			Kalman.Update( nFrame * dt );
+		} ) );
+	}
+
+	// Innovation gate, a one-frame 50 mm spike is ignored and a real 50 mm jump is taken up again
+	KalmanClass gated( dataHandle );
+	shared->Target.isMarkerFound.fill( false );
+	shared->Target.isMarkerFound[activeSlot]	 = true;
+	shared->Target.markerVarianceMM2[activeSlot] = cv::Point3f( 0.09f, 0.09f, 0.09f );
+	gated.Initialize( cv::Point3f( 0.0f, 0.0f, 200.0f ), 0.0f );
+	float spikeMM  = 0.0f;
+	int	  nRecover = -1;
+	for ( int n = 1; n <= 200; n++ ) {
+		bool isSpike = n == 90;
+		bool isJump	 = n > 120;
+		shared->Target.markerPositionsMM[activeSlot] = cv::Point3f( ( isSpike || isJump ) ? 50.0f : 0.0f, 0.0f, 200.0f );
+		gated.Update( n * dt );
+		if ( isSpike ) {
+			spikeMM = std::abs( gated.GetPosition().x );
+		}
+		if ( isJump && nRecover < 0 && std::abs( gated.GetPosition().x - 50.0f ) < 1.0f ) {
+			nRecover = n - 120;
+		}
+	}
+	bool isGatePassed = ReportCheck( "core/kalman_gate", spikeMM <= 1.0f && nRecover >= 0 && nRecover <= int( CONFIG_KALMAN_GATE_MAX_REJECTS ) );
+	std::cout << "core/kalman_gate                 spike moved = " << spikeMM << " mm, jump taken after " << nRecover << " frames" << ( isGatePassed ? "\n" : "   FAILED\n" );
+
+	// Controller update, with prediction, and its motor allocation
+	ControllerClass	   Controller( dataHandle );
+	ControlInputStruct input;
+	input.isTargetFound = true;
+	Controller.SetSettings( Controller.ReadSettings() );
+	PrintResult( RunBenchmark( "core/controller_update", 20000, [&]() {
+		nFrame++;
+		input.positionFilteredMM = circleAt( nFrame );
+		input.velocityFilteredMM = circleAt( nFrame + 90 ) - cv::Point3f( 0.0f, 0.0f, 200.0f );
+		input.timeCaptured		 = std::chrono::steady_clock::now();
+		Controller.SetInput( input );
+		Controller.Update();
+	} ) );
+
+	// Allocation table against the sector formulas, every 0.1 deg over a range of strengths and depths
+	double allocationError = 0.0;
+	for ( int a = 0; a < 3600; a++ ) {
+		for ( float magnitude : { 0.0f, 0.5f, 5.0f, 20.0f, 80.0f, 400.0f } ) {
+			for ( float depth : { 50.0f, 200.0f, 1000.0f } ) {
+				float		theta = a * 0.1f * float( CV_PI ) / 180.0f;
+				cv::Point3f terms = cv::Point3f( magnitude * std::cos( theta ), magnitude * std::sin( theta ), 0.0f );
+				cv::Point3f share;
+				input.positionFilteredMM.z = depth;
+				Controller.SetInput( input );
+				Controller.AllocateTerms( &terms, &share, 1 );
+				cv::Point3f delta = share - LegacyContribution( terms, depth );
+				allocationError	  = std::max( { allocationError, double( std::abs( delta.x ) ), double( std::abs( delta.y ) ), double( std::abs( delta.z ) ) } );
+			}
+		}
+	}
+	bool isAllocationPassed = ReportCheck( "core/allocation", allocationError <= 1e-4 );
+	std::cout << "core/allocation                  max error = " << allocationError << ( isAllocationPassed ? "\n" : "   FAILED\n" );
+
+	// One controller's worth of terms, table batch against four sector evaluations
+	const cv::Point3f allocationTerms[] = { circleAt( 10 ), circleAt( 100 ), circleAt( 200 ), circleAt( 300 ) };
+	cv::Point3f		  allocationShares[4];
+	PrintResult( RunBenchmark( "core/allocate_terms", 100000, [&]() { Controller.AllocateTerms( allocationTerms, allocationShares, 4 ); } ) );
+	PrintResult( RunBenchmark( "core/allocate_terms_legacy", 100000, [&]() {
+		for ( size_t n = 0; n < 4; n++ ) {
+			allocationShares[n] = LegacyContribution( allocationTerms[n], 200.0f );
+		}
+	} ) );
+	PrintResult( RunBenchmark( "core/map_to_contribution_abc", 20000, [&]() {
+		nFrame++;
+		cv::Point3f terms = circleAt( nFrame );
+		Controller.MapToContributionABC( cv::Point3f( terms.x, terms.y, 0.0f ) );
+	} ) );
+	PrintResult( RunBenchmark( "core/map_to_contribution_term", 20000, [&]() {
+		nFrame++;
+		cv::Point3f terms = circleAt( nFrame );
+		shared->Controller.percentageProportional = Controller.MapToContributionTerm( cv::Point3f( terms.x, terms.y, 0.0f ) );
+	} ) );
+
+	// Packet framing, checked with one round trip first
+	PacketStruct	   packet;
+	PacketFramerClass  framer;
+	FramedPacketStruct framed;
+	uint8_t			   buffer[PacketFramerClass::MAX_FRAME_LENGTH];
+	packet.packetType	 = 'D';
+	packet.packetCounter = 42;
+	packet.pwmA			 = 1000;
+	packet.pwmB			 = 2048;
+	packet.pwmC			 = 3000;
+
+	size_t length = SerialClass::EncodePacket( packet, buffer );
+	framer.Write( buffer, length );
+	if ( !ReportCheck( "core/serial", length == PacketFramerClass::FRAME_LENGTH && framer.Next( framed ) && !framed.isTelemetry && std::memcmp( &packet, &framed.packet, sizeof( PacketStruct ) ) == 0 && !framer.Next( framed ) ) ) {
+		std::cout << "core/serial                      round trip FAILED\n";
+	}
+
+	PrintResult( RunBenchmark( "core/serial_encode", 100000, [&]() {
+		packet.packetCounter = ( packet.packetCounter + 1 ) % 100;
+		SerialClass::EncodePacket( packet, buffer );
+	} ) );
+	PrintResult( RunBenchmark( "core/serial_decode", 100000, [&]() {
+		framer.Write( buffer, length );
+		framer.Next( framed );
+	} ) );
+
+	// Stream framing, line noise between frames, every 3rd frame a telemetry batch, every 7th with a
+	// bad checksum and every 11th cut short, fed in reads of random size. Every intact frame has to
+	// come out, in order, batches with their last sample.
+	std::vector<uint8_t>  stream;
+	std::vector<int32_t>  intactEncoders;
+	TelemetryPacketStruct telemetry;
+	telemetry.nSamples = TELEMETRY_BATCH_SIZE;
+	for ( int n = 0; n < 1000; n++ ) {
+		for ( int g = rng.uniform( 0, 4 ); g > 0; g-- ) {
+			stream.push_back( uint8_t( rng.uniform( 0, 256 ) ) );
+		}
+		size_t frameLength = 0;
+		if ( n % 3 == 1 ) {
+			telemetry.packetCounter								 = uint8_t( n % 100 );
+			telemetry.samples[TELEMETRY_BATCH_SIZE - 1].encoderA = rng.uniform( -100000, 100000 );
+			frameLength											 = PacketFramerClass::Encode( reinterpret_cast<const uint8_t*>( &telemetry ), sizeof( TelemetryPacketStruct ), buffer );
+		} else {
+			packet.packetCounter = uint8_t( n % 100 );
+			packet.pwmA			 = uint16_t( rng.uniform( 0, 4096 ) );
+			packet.encoderA		 = rng.uniform( -100000, 100000 );
+			frameLength			 = SerialClass::EncodePacket( packet, buffer );
+		}
+		if ( n % 7 == 3 ) {
+			buffer[2] ^= 0x01;
+		} else if ( n % 11 == 5 ) {
+			frameLength = size_t( rng.uniform( 1, int( frameLength ) ) );
+		} else {
+			intactEncoders.push_back( int32_t( n % 3 == 1 ? telemetry.samples[TELEMETRY_BATCH_SIZE - 1].encoderA : packet.encoderA ) );
+		}
+		stream.insert( stream.end(), buffer, buffer + frameLength );
+	}
+
+	std::vector<int32_t> decodedEncoders;
+	framer.Reset();
+	for ( size_t offset = 0; offset < stream.size(); ) {
+		size_t chunk = std::min( size_t( rng.uniform( 1, 64 ) ), stream.size() - offset );
+		framer.Write( &stream[offset], chunk );
+		offset += chunk;
+		while ( framer.Next( framed ) ) {
+			decodedEncoders.push_back( int32_t( framed.isTelemetry ? framed.telemetry.samples[TELEMETRY_BATCH_SIZE - 1].encoderA : framed.packet.encoderA ) );
+		}
+	}
+	const SerialCountersStruct& counters	   = framer.Counters();
+	bool						isFramerPassed = ReportCheck( "core/serial_framer", decodedEncoders == intactEncoders );
+	std::cout << "core/serial_framer               " << counters.nPackets << " of " << intactEncoders.size() << " intact frames, " << counters.nChecksumErrors << " checksum errors, "
+			  << counters.nFramingErrors << " framing errors, " << counters.nBytesSkipped << " bytes skipped" << ( isFramerPassed ? "\n" : "   FAILED\n" );
+
+	PrintResult( RunBenchmark( "core/serial_framer_stream", 1000, [&]() {
+		framer.Write( stream.data(), std::min( stream.size(), size_t( 512 ) ) );
+		while ( framer.Next( framed ) ) { }
+	} ) );
+
+	// Logging, one task worth of entries into the preallocated log
+	LoggingClass Logging( dataHandle );
+	PrintResult( RunBenchmark( "core/logging_add_entry", 5000, [&]() { Logging.AddEntry(); } ) );
+
+	// Overlay drawing without showing a window
+	DisplayClass Display( dataHandle );
+	cv::randu( shared->Capture.matFrameUndistorted, 0, 255 );
+	PrintResult( RunBenchmark( "core/display_render", 300, [&]() { Display.Render(); } ) );
+}
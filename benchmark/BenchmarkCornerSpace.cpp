@@ -0,0 +1,113 @@
+// Benchmark harness
+#include "Benchmark.h"
+
+// Standard libraries
+#include <iostream>
+
+// Classes under test
+#include "ArucoClass.h"
+#include "FrameSourceClass.h"
+#include "SystemDataManager.h"
+#include "UndistortClass.h"
+
+
+/**
+ * @brief Compare corner-space detection against detection on the undistorted frame
+ *
+ * Every recorded frame is run through both paths: the full remap followed by FindTags(), and the
+ * raw gray frame followed by FindTags() with corner undistortion. Reports how often each path found
+ * the active marker, how far the two poses and corner sets disagree, and what each path costs.
+ *
+ * @param recordedPath Recorded session, video file or directory of images
+ */
+void BenchmarkCornerSpace( const std::string& recordedPath ) {
+
+	// Replay recorded frames without pacing
+	RecordedSourceClass Source( recordedPath, replayModeEnum::AS_FAST_AS_POSSIBLE );
+	if ( recordedPath.empty() || !Source.Open() ) {
+		std::cout << "cornerspace/accuracy             skipped, no recorded frames given\n";
+		return;
+	}
+
+	// Stand-alone data manager
+	SystemDataManager dataHandle;
+	auto			  shared = dataHandle.getData();
+	UndistortClass	  Undistort( dataHandle );
+	ArucoClass		  Aruco( dataHandle );
+
+	// Detection only runs while a task is active
+	shared->Task.isRunning		 = true;
+	shared->Capture.isFrameReady = true;
+
+	// Both paths share one detector in different spaces, a search window would carry over between them
+	shared->Aruco.isTrackingEnabled = false;
+
+	// Accumulators
+	cv::Mat frameUndistorted, frameGray;
+	int		nFrames = 0, nFoundUndistorted = 0, nFoundRaw = 0, nBoth = 0;
+	double	timeUndistortedMs = 0.0, timeRawMs = 0.0;
+	double	positionErrorMeanMM = 0.0, positionErrorMaxMM = 0.0;
+	double	cornerErrorMeanPX = 0.0, cornerErrorMaxPX = 0.0;
+
+	cv::Mat								  frameRaw;
+	std::chrono::steady_clock::time_point timeGrabbed, timeSource;
+	while ( Source.Read( frameRaw, timeGrabbed, timeSource ) ) {
+
+		if ( frameRaw.size() != cv::Size( CONFIG_CAM_WIDTH, CONFIG_CAM_HEIGHT ) ) {
+			continue;
+		}
+		nFrames++;
+
+		// Current path: full remap, detect on the undistorted frame
+		auto timeStart = std::chrono::steady_clock::now();
+		Undistort.ProcessCPU( frameRaw, frameUndistorted, frameGray, false );
+		shared->Capture.frameGray = frameGray;
+		shared->Capture.isGrayRaw = false;
+		Aruco.FindTags();
+		timeUndistortedMs += std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - timeStart ).count();
+
+		bool					 isFoundUndistorted	 = shared->Target.isTargetFound;
+		cv::Point3f				 positionUndistorted = shared->Target.positionUnfilteredMM;
+		std::vector<cv::Point2i> cornersUndistorted	 = shared->Target.cornersPX;
+
+		// Corner-space path: detect on the raw frame, undistort the corners
+		timeStart = std::chrono::steady_clock::now();
+		Undistort.ProcessRaw( frameRaw, frameUndistorted, frameGray, false );
+		shared->Capture.frameGray = frameGray;
+		shared->Capture.isGrayRaw = true;
+		Aruco.FindTags();
+		timeRawMs += std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - timeStart ).count();
+
+		bool isFoundRaw = shared->Target.isTargetFound;
+
+		// Tally
+		nFoundUndistorted += isFoundUndistorted;
+		nFoundRaw += isFoundRaw;
+		if ( isFoundUndistorted && isFoundRaw ) {
+			nBoth++;
+
+			double positionError = cv::norm( shared->Target.positionUnfilteredMM - positionUndistorted );
+			positionErrorMeanMM += positionError;
+			positionErrorMaxMM = std::max( positionErrorMaxMM, positionError );
+
+			for ( size_t c = 0; c < 4; c++ ) {
+				double cornerError = cv::norm( shared->Target.cornersPX[c] - cornersUndistorted[c] );
+				cornerErrorMeanPX += cornerError / 4.0;
+				cornerErrorMaxPX = std::max( cornerErrorMaxPX, cornerError );
+			}
+		}
+	}
+
+	if ( nFrames == 0 ) {
+		std::cout << "cornerspace/accuracy             skipped, no " << CONFIG_CAM_WIDTH << " x " << CONFIG_CAM_HEIGHT << " frames in " << recordedPath << "\n";
+		return;
+	}
+
+	// Report
+	std::cout << "cornerspace/accuracy             frames = " << nFrames << "   found undistorted = " << nFoundUndistorted << "   found raw = " << nFoundRaw << "   both = " << nBoth << "\n";
+	std::cout << "cornerspace/time                 undistorted = " << timeUndistortedMs / nFrames << " ms/frame   raw = " << timeRawMs / nFrames << " ms/frame\n";
+	if ( nBoth > 0 ) {
+		std::cout << "cornerspace/position_difference  mean = " << positionErrorMeanMM / nBoth << " mm   max = " << positionErrorMaxMM << " mm\n";
+		std::cout << "cornerspace/corner_difference    mean = " << cornerErrorMeanPX / nBoth << " px   max = " << cornerErrorMaxPX << " px\n";
+	}
+}
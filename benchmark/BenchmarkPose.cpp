@@ -0,0 +1,135 @@
+// Benchmark harness
+#include "Benchmark.h"
+
+// Standard libraries
+#include <cmath>
+#include <iostream>
+
+// OpenCV
+#include <opencv2/calib3d.hpp>
+
+// Classes under test
+#include "ArucoClass.h"
+#include "SceneGeneratorClass.h"
+#include "SystemDataManager.h"
+#include "UndistortClass.h"
+
+
+/**
+ * @brief Pose stage latency and frame-to-frame jitter
+ *
+ * Latency: the previous estimatePoseSingleMarkers() call against solvePnP with IPPE_SQUARE, and the
+ * warm-started refinement, on ground-truth corners with half a pixel of noise.
+ *
+ * Jitter: a static tilted marker rendered with fresh sensor noise every frame, run through the full
+ * FindTags() path with and without warm start. Reports the spread of the reported position around
+ * its mean and the bias of that mean against the rendered pose.
+ */
+void BenchmarkPose() {
+
+	// Stand-alone data manager
+	SystemDataManager	dataHandle;
+	auto				shared = dataHandle.getData();
+	UndistortClass		Undistort( dataHandle );
+	ArucoClass			Aruco( dataHandle );
+	SceneGeneratorClass Scene;
+
+	shared->Task.isRunning		 = true;
+	shared->Capture.isFrameReady = true;
+	shared->Capture.rotateCamera = false;
+	shared->Capture.isGrayRaw	 = false;
+
+	// Static marker, tilted enough to matter but inside the working range
+	std::vector<SceneMarkerStruct> markers( 1 );
+	markers[0].id	   = shared->Target.activeID;
+	markers[0].widthMM = CONFIG_LARGE_MARKER_WIDTH;
+	markers[0].tvec	   = cv::Vec3d( 15.0, -10.0, 200.0 );
+	cv::Mat rotFacing, rotTilt, rotation;
+	cv::Rodrigues( cv::Vec3d( CV_PI, 0.0, 0.0 ), rotFacing );
+	cv::Rodrigues( cv::Vec3d( 0.15, 0.1, 0.05 ), rotTilt );
+	rotation = rotFacing * rotTilt;
+	cv::Rodrigues( rotation, markers[0].rvec );
+
+	// Ground truth corners
+	SceneSettingsStruct	   settings;
+	SceneGroundTruthStruct truth;
+	cv::Mat				   frameRaw, frameUndistorted, frameGray;
+	Scene.Render( markers, settings, frameRaw, truth );
+
+	// Stage latency on noisy corners
+	cv::Mat objectPoints( 4, 1, CV_32FC3 );
+	objectPoints.at<cv::Vec3f>( 0 ) = cv::Vec3f( -CONFIG_LARGE_MARKER_WIDTH / 2.f, CONFIG_LARGE_MARKER_WIDTH / 2.f, 0 );
+	objectPoints.at<cv::Vec3f>( 1 ) = cv::Vec3f( CONFIG_LARGE_MARKER_WIDTH / 2.f, CONFIG_LARGE_MARKER_WIDTH / 2.f, 0 );
+	objectPoints.at<cv::Vec3f>( 2 ) = cv::Vec3f( CONFIG_LARGE_MARKER_WIDTH / 2.f, -CONFIG_LARGE_MARKER_WIDTH / 2.f, 0 );
+	objectPoints.at<cv::Vec3f>( 3 ) = cv::Vec3f( -CONFIG_LARGE_MARKER_WIDTH / 2.f, -CONFIG_LARGE_MARKER_WIDTH / 2.f, 0 );
+
+	std::vector<cv::Point2f> corners( 4 );
+	cv::RNG					 rng( 1 );
+
+	auto jitterCorners = [&]() {
+		for ( size_t c = 0; c < 4; c++ ) {
+			corners[c] = truth.cornersUndistortedPX[0][c] + cv::Point2f( rng.gaussian( 0.5 ), rng.gaussian( 0.5 ) );
+		}
+	};
+
+	std::vector<cv::Vec3d> rvecs, tvecs;
+	cv::Vec3d			   rvec, tvec;
+	cv::Mat				   noDistortion = cv::Mat::zeros( 1, 5, CV_64F );
+	cv::TermCriteria	   criteria( cv::TermCriteria::COUNT | cv::TermCriteria::EPS, 10, 1e-6 );
+
+	PrintResult( RunBenchmark( "pose/estimate_single_markers", 2000, [&]() {
+		jitterCorners();
+		cv::aruco::estimatePoseSingleMarkers( std::vector<std::vector<cv::Point2f>> { corners }, CONFIG_LARGE_MARKER_WIDTH, CONFIG_CAMERA_MATRIX, noDistortion, rvecs, tvecs );
+	} ) );
+	PrintResult( RunBenchmark( "pose/ippe_square", 2000, [&]() {
+		jitterCorners();
+		cv::solvePnP( objectPoints, corners, CONFIG_CAMERA_MATRIX, noDistortion, rvec, tvec, false, cv::SOLVEPNP_IPPE_SQUARE );
+	} ) );
+	PrintResult( RunBenchmark( "pose/ippe_square_warm_start", 2000, [&]() {
+		jitterCorners();
+		cv::Vec3d rvecRefined = rvec, tvecRefined = tvec;
+		cv::solvePnP( objectPoints, corners, CONFIG_CAMERA_MATRIX, noDistortion, rvec, tvec, false, cv::SOLVEPNP_IPPE_SQUARE );
+		cv::solvePnPRefineLM( objectPoints, corners, CONFIG_CAMERA_MATRIX, noDistortion, rvecRefined, tvecRefined, criteria );
+	} ) );
+
+	// Jitter through FindTags(), fresh sensor noise on the same scene every frame
+	settings.noiseSigma = 4.0;
+	for ( bool isWarmStart : { false, true } ) {
+
+		shared->Aruco.isPoseWarmStart = isWarmStart;
+
+		std::vector<double>		 samplesPose;
+		std::vector<cv::Point3f> positions;
+		for ( int i = 0; i < 300; i++ ) {
+			Scene.Render( markers, settings, frameRaw, truth );
+			Undistort.ProcessCPU( frameRaw, frameUndistorted, frameGray, false );
+			shared->Capture.frameGray = frameGray;
+			Aruco.FindTags();
+
+			if ( shared->Target.isTargetFound ) {
+				samplesPose.push_back( shared->Aruco.poseTimeMS );
+				positions.push_back( shared->Target.positionUnfilteredMM );
+			}
+		}
+
+		std::string name = std::string( "pose/" ) + ( isWarmStart ? "warm_start" : "closed_form" );
+		PrintResult( SummarizeSamples( name + "/findtags_pose", samplesPose ) );
+		if ( positions.empty() ) {
+			std::cout << name << "/jitter          no detections\n";
+			continue;
+		}
+
+		// Spread around the mean and bias of the mean
+		cv::Point3f positionMean( 0.0f, 0.0f, 0.0f );
+		for ( const cv::Point3f& position : positions ) {
+			positionMean += position * ( 1.0f / positions.size() );
+		}
+		double jitterRMS = 0.0, jitterMax = 0.0;
+		for ( const cv::Point3f& position : positions ) {
+			double deviation = cv::norm( position - positionMean );
+			jitterRMS += deviation * deviation / positions.size();
+			jitterMax = std::max( jitterMax, deviation );
+		}
+		std::cout << name << "/jitter          frames = " << positions.size() << "   rms = " << std::sqrt( jitterRMS ) << " mm   max = " << jitterMax << " mm   bias = " << cv::norm( positionMean - truth.positionsMM[0] ) << " mm\n";
+	}
+}
@@ -0,0 +1,298 @@
+// Benchmark harness
+#include "Benchmark.h"
+
+// Standard libraries
+#include <cmath>
+#include <iostream>
+
+// Classes under test
+#include "ArucoClass.h"
+#include "FrameSourceClass.h"
+#include "KalmanClass.h"
+#include "SceneGeneratorClass.h"
+#include "SystemDataManager.h"
+#include "TimingClass.h"
+#include "UndistortClass.h"
+
+
+/**
+ * @brief One controlled condition to score the detector under
+ */
+struct SyntheticScenarioStruct {
+	std::string			name	   = "";
+	SceneSettingsStruct settings;
+	double				maxTiltDEG = 20.0;
+	double				speedMMS   = 0.0;	 // Random direction, only matters with a trail
+};
+
+
+/**
+ * @brief Render random poses under one scenario and score FindTags() against the ground truth
+ *
+ * Runs the normal undistort + FindTags() path on every frame. Position error uses the
+ * Target.positionUnfilteredMM convention; corner error is measured in undistorted pixels.
+ *
+ * @param name Prefix for the report lines
+ * @param scenario Degradations and pose range
+ * @param nFrames Number of frames to render
+ */
+static void ScoreRandomPoses( const std::string& name, const SyntheticScenarioStruct& scenario, int nFrames, SceneGeneratorClass& Scene, UndistortClass& Undistort, ArucoClass& Aruco, std::shared_ptr<ManagedData> shared ) {
+
+	// Poses are independent, a search window would only ever miss
+	shared->Aruco.isTrackingEnabled = false;
+
+	// Active marker, moved every frame
+	std::vector<SceneMarkerStruct> markers( 1 );
+	markers[0].id	   = shared->Target.activeID;
+	markers[0].widthMM = CONFIG_LARGE_MARKER_WIDTH;
+
+	cv::Mat								  frameRaw, frameUndistorted, frameGray;
+	std::chrono::steady_clock::time_point timeGrabbed, timeSource;
+	SceneGroundTruthStruct				  truth;
+
+	// Frames come through the same source interface the capture thread uses
+	int					 frameIndex = 0;
+	SyntheticSourceClass Source(
+		[&]( cv::Mat& frame, double& frameTimeSeconds ) {
+			if ( frameIndex >= nFrames ) {
+				return false;
+			}
+
+			Scene.RandomPose( markers[0], 40.0, 80.0, 300.0, scenario.maxTiltDEG );
+			cv::Vec3d direction( cv::theRNG().uniform( -1.0, 1.0 ), cv::theRNG().uniform( -1.0, 1.0 ), cv::theRNG().uniform( -1.0, 1.0 ) );
+			markers[0].velocityMMS = direction * ( scenario.speedMMS / std::max( 1e-9, cv::norm( direction ) ) );
+
+			Scene.Render( markers, scenario.settings, frame, truth );
+			frameTimeSeconds = double( frameIndex++ ) / CONFIG_CAM_FRAMERATE;
+			return true;
+		},
+		replayModeEnum::AS_FAST_AS_POSSIBLE );
+	Source.Open();
+
+	// Accumulators
+	std::vector<double> samplesFindTags, samplesPipeline;
+	int					nFound				= 0;
+	double				positionErrorMeanMM = 0.0, positionErrorMaxMM = 0.0;
+	double				cornerErrorMeanPX = 0.0, cornerErrorMaxPX = 0.0;
+
+	while ( Source.Read( frameRaw, timeGrabbed, timeSource ) ) {
+
+		// Same path the main loop runs on a captured frame
+		auto timeStart = std::chrono::steady_clock::now();
+		Undistort.ProcessCPU( frameRaw, frameUndistorted, frameGray, false );
+		shared->Capture.frameGray = frameGray;
+		auto timeDetect			  = std::chrono::steady_clock::now();
+		Aruco.FindTags();
+		auto timeEnd = std::chrono::steady_clock::now();
+
+		samplesFindTags.push_back( std::chrono::duration<double, std::milli>( timeEnd - timeDetect ).count() );
+		samplesPipeline.push_back( std::chrono::duration<double, std::milli>( timeEnd - timeStart ).count() );
+
+		if ( !shared->Target.isTargetFound || truth.ids.empty() ) {
+			continue;
+		}
+		nFound++;
+
+		// Pose error against the rendered pose
+		double positionError = cv::norm( shared->Target.positionUnfilteredMM - truth.positionsMM[0] );
+		positionErrorMeanMM += positionError;
+		positionErrorMaxMM = std::max( positionErrorMaxMM, positionError );
+
+		for ( size_t c = 0; c < 4; c++ ) {
+			double cornerError = cv::norm( cv::Point2f( shared->Target.cornersPX[c] ) - truth.cornersUndistortedPX[0][c] );
+			cornerErrorMeanPX += cornerError / 4.0;
+			cornerErrorMaxPX = std::max( cornerErrorMaxPX, cornerError );
+		}
+	}
+
+	// Report
+	PrintResult( SummarizeSamples( name + "/findtags", samplesFindTags ) );
+	PrintResult( SummarizeSamples( name + "/pipeline", samplesPipeline ) );
+	std::cout << name << "/accuracy    found = " << nFound << " / " << nFrames;
+	if ( nFound > 0 ) {
+		std::cout << "   position mean = " << positionErrorMeanMM / nFound << " mm   max = " << positionErrorMaxMM << " mm   corner mean = " << cornerErrorMeanPX / nFound << " px   max = " << cornerErrorMaxPX << " px";
+	}
+	std::cout << "\n";
+}
+
+
+/**
+ * @brief FindTags() latency and pose error on rendered frames with known ground truth
+ *
+ * Each scenario renders the active marker at random poses in the working volume through a
+ * SyntheticSourceClass and compares what FindTags() reports with what was rendered.
+ */
+void BenchmarkSynthetic() {
+
+	// Stand-alone data manager
+	SystemDataManager	dataHandle;
+	auto				shared = dataHandle.getData();
+	UndistortClass		Undistort( dataHandle );
+	ArucoClass			Aruco( dataHandle );
+	SceneGeneratorClass Scene;
+
+	// Detection only runs while a task is active
+	shared->Task.isRunning		 = true;
+	shared->Capture.isFrameReady = true;
+	shared->Capture.rotateCamera = false;
+	shared->Capture.isGrayRaw	 = false;
+
+	// Conditions, from ideal to the worst the rig sees in practice
+	std::vector<SyntheticScenarioStruct> scenarios( 7 );
+	scenarios[0].name = "clean";
+
+	scenarios[1].name		= "oblique";
+	scenarios[1].maxTiltDEG = 55.0;
+
+	scenarios[2].name				  = "blur";
+	scenarios[2].settings.blurSigmaPX = 1.5;
+
+	scenarios[3].name				 = "noise";
+	scenarios[3].settings.noiseSigma = 12.0;
+
+	scenarios[4].name					 = "dark";
+	scenarios[4].settings.exposureGain	 = 0.35;
+	scenarios[4].settings.exposureOffset = 10.0;
+	scenarios[4].settings.noiseSigma	 = 4.0;
+
+	scenarios[5].name					 = "bright";
+	scenarios[5].settings.exposureGain	 = 1.6;
+	scenarios[5].settings.exposureOffset = 30.0;
+
+	scenarios[6].name					= "motion";
+	scenarios[6].speedMMS				= 400.0;
+	scenarios[6].settings.exposureTimeS = 1.0 / CONFIG_CAM_FRAMERATE;
+	scenarios[6].settings.trailSteps	= 8;
+
+	for ( const SyntheticScenarioStruct& scenario : scenarios ) {
+		ScoreRandomPoses( "synthetic/" + scenario.name, scenario, 200, Scene, Undistort, Aruco, shared );
+	}
+}
+
+
+/**
+ * @brief Full-frame reacquisition cost at full, half and quarter resolution
+ *
+ * Level 0 is the previous behaviour, detectMarkers with sub-pixel refinement on the whole frame.
+ */
+void BenchmarkPyramid() {
+
+	// Stand-alone data manager
+	SystemDataManager	dataHandle;
+	auto				shared = dataHandle.getData();
+	UndistortClass		Undistort( dataHandle );
+	ArucoClass			Aruco( dataHandle );
+	SceneGeneratorClass Scene;
+
+	shared->Task.isRunning		 = true;
+	shared->Capture.isFrameReady = true;
+	shared->Capture.rotateCamera = false;
+	shared->Capture.isGrayRaw	 = false;
+
+	// Mild real-world degradation
+	SyntheticScenarioStruct scenario;
+	scenario.settings.blurSigmaPX = 0.8;
+	scenario.settings.noiseSigma  = 3.0;
+
+	for ( uint8_t level = 0; level <= 2; level++ ) {
+		shared->Aruco.pyramidLevel = level;
+		ScoreRandomPoses( "pyramid/level" + std::to_string( level ), scenario, 200, Scene, Undistort, Aruco, shared );
+	}
+}
+
+
+/**
+ * @brief FindTags() cost and hit rate along a smooth trajectory, with and without ROI tracking
+ *
+ * The active marker circles the working volume while bobbing in depth. Found positions feed a
+ * KalmanClass exactly like UpdateSystem() does, so the search window sees the same filtered velocity
+ * it would on the rig.
+ */
+void BenchmarkTracking() {
+
+	const int	 nFrames  = 3 * CONFIG_CAM_FRAMERATE;
+	const double periodS  = 1.5;
+	const double radiusMM = 30.0;
+
+	// Stand-alone data manager
+	SystemDataManager	dataHandle;
+	auto				shared = dataHandle.getData();
+	UndistortClass		Undistort( dataHandle );
+	ArucoClass			Aruco( dataHandle );
+	TimingClass			Timing( dataHandle );
+	SceneGeneratorClass Scene;
+
+	shared->Task.isRunning		 = true;
+	shared->Capture.isFrameReady = true;
+	shared->Capture.rotateCamera = false;
+	shared->Capture.isGrayRaw	 = false;
+
+	// Mild real-world degradation
+	SceneSettingsStruct settings;
+	settings.blurSigmaPX = 0.8;
+	settings.noiseSigma	 = 3.0;
+
+	std::vector<SceneMarkerStruct> markers( 1 );
+	markers[0].id	   = shared->Target.activeID;
+	markers[0].widthMM = CONFIG_LARGE_MARKER_WIDTH;
+
+	cv::Mat								  frameRaw, frameUndistorted, frameGray;
+	std::chrono::steady_clock::time_point timeGrabbed, timeSource;
+	SceneGroundTruthStruct				  truth;
+
+	for ( bool isTracking : { false, true } ) {
+
+		KalmanClass Kalman( dataHandle );
+		shared->Aruco.isTrackingEnabled = isTracking;
+
+		// Smooth trajectory, same every run
+		int					 frameIndex = 0;
+		SyntheticSourceClass Source(
+			[&]( cv::Mat& frame, double& frameTimeSeconds ) {
+				if ( frameIndex >= nFrames ) {
+					return false;
+				}
+
+				frameTimeSeconds	   = double( frameIndex++ ) / CONFIG_CAM_FRAMERATE;
+				double phase		   = 2.0 * CV_PI * frameTimeSeconds / periodS;
+				markers[0].tvec		   = cv::Vec3d( radiusMM * std::cos( phase ), radiusMM * std::sin( phase ), 180.0 + 20.0 * std::sin( 0.5 * phase ) );
+				markers[0].velocityMMS = cv::Vec3d( -radiusMM * std::sin( phase ), radiusMM * std::cos( phase ), 10.0 * std::cos( 0.5 * phase ) ) * ( 2.0 * CV_PI / periodS );
+
+				Scene.Render( markers, settings, frame, truth );
+				return true;
+			},
+			replayModeEnum::AS_FAST_AS_POSSIBLE );
+		Timing.StartTimer();
+		Source.Open();
+
+		std::vector<double> samplesFindTags;
+		int					nFound = 0, nTracked = 0;
+
+		while ( Source.Read( frameRaw, timeGrabbed, timeSource ) ) {
+
+			Undistort.ProcessCPU( frameRaw, frameUndistorted, frameGray, false );
+			shared->Capture.frameGray	= frameGray;
+			shared->Capture.timeGrabbed = timeGrabbed;
+			shared->Capture.timeSource	= timeSource;
+
+			auto timeStart = std::chrono::steady_clock::now();
+			Aruco.FindTags();
+			samplesFindTags.push_back( std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - timeStart ).count() );
+
+			nTracked += shared->Aruco.isTracking;
+
+			// Filter as the main loop does, every frame on the time it was recorded
+			Kalman.Update( Timing.GetRunningTime( shared->Capture.timeSource ) );
+			if ( shared->Target.isTargetFound ) {
+				nFound++;
+				shared->Target.positionFilteredNewMM = Kalman.GetPosition();
+				shared->Target.velocityFilteredNewMM = Kalman.GetVelocity();
+			}
+		}
+
+		// Report
+		std::string name = std::string( "tracking/" ) + ( isTracking ? "roi" : "full_frame" );
+		PrintResult( SummarizeSamples( name + "/findtags", samplesFindTags ) );
+		std::cout << name << "/accuracy    found = " << nFound << " / " << nFrames << "   searched in window = " << nTracked << "\n";
+	}
+}
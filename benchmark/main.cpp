@@ -0,0 +1,70 @@
+// Benchmark harness
+#include "Benchmark.h"
+
+// Standard libraries
+#include <iostream>
+#include <string>
+
+
+/**
+ * @brief Run every benchmark suite and print the results
+ *
+ * Usage: NURingBenchmarks [recorded frame directory] [--json results.json]
+ *
+ * @return int 1 if a correctness check failed or the report could not be written
+ */
+int main( int argc, char** argv ) {
+
+	// Optional directory of recorded camera frames and JSON report
+	std::string recordedPath = "";
+	std::string jsonPath	 = "";
+	for ( int i = 1; i < argc; i++ ) {
+		std::string arg = argv[i];
+		if ( arg == "--json" && i + 1 < argc ) {
+			jsonPath = argv[++i];
+		} else {
+			recordedPath = arg;
+		}
+	}
+
+	std::cout << "\nBenchmarks:   Running...\n\n";
+
+	// Capture preprocessing
+	BenchmarkCapture();
+
+	// Detection on raw frame with corner undistortion
+	BenchmarkCornerSpace( recordedPath );
+
+	// Detection latency and pose error on rendered scenes
+	BenchmarkSynthetic();
+
+	// Region-of-interest tracking against full-frame search
+	BenchmarkTracking();
+
+	// Coarse-to-fine full-frame search against full resolution
+	BenchmarkPyramid();
+
+	// Pose stage latency and jitter
+	BenchmarkPose();
+
+	// Filter, controller, packet framing, logging and overlay
+	BenchmarkCore();
+
+	// Machine-readable report
+	if ( !jsonPath.empty() && !WriteResultsJson( jsonPath ) ) {
+		return 1;
+	}
+
+	// Correctness checks fail the run
+	if ( !FailedChecks().empty() ) {
+		std::cout << "\nBenchmarks:   " << FailedChecks().size() << " check(s) FAILED:";
+		for ( const std::string& name : FailedChecks() ) {
+			std::cout << " " << name;
+		}
+		std::cout << "\n";
+		return 1;
+	}
+
+	std::cout << "\nBenchmarks:   Done.\n";
+	return 0;
+}
@@ -3,10 +3,14 @@
 // Memory for shared data
 #include <memory>
 
+// Frame timing for the search window
+#include <chrono>
+
 // OpenCV core functions
 #include <opencv2/aruco.hpp>
 #include <opencv2/calib3d.hpp>
 #include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
 #include <opencv2/video/tracking.hpp>
 
 
@@ -33,6 +37,11 @@ public:
 private:
 	// Private functions
 	void Initialize();
+	void	 UndistortCorners( std::vector<cv::Point2f>& corners );
+	cv::Rect PredictSearchRegion( const cv::Size& frameSize );
+	void	 DetectPyramid( const cv::Mat& frameGray, int level );
+	bool	 EstimatePose( const std::vector<cv::Point2f>& corners, const cv::Mat& distortion, bool isActive );
+	cv::Point3f MeasurementVariance( const std::vector<cv::Point2f>& corners, const cv::Mat& distortion, float& reprojectionPX );
 
 	// Data manager handle
 	SystemDataManager&			 dataHandle;
@@ -45,19 +54,36 @@ private:
 	cv::aruco::Dictionary		  arucoDictionary;
 	cv::aruco::DetectorParameters arucoDetectorParams;
 	cv::aruco::ArucoDetector	  arucoDetector;
+	cv::aruco::ArucoDetector	  arucoDetectorCoarse;	  // No corner refinement, runs on the scaled frame
+	cv::Mat						  arucoPyramid;			  // Scaled detection image
 
 	// Aruco variables
-	std::vector<uint8_t>				  arucoTagsPresent { 10, 0 };									// Is a given tag present?
+	std::vector<uint8_t>				  arucoTagsPresent = std::vector<uint8_t>( 10, 0 );									// Is a given tag present?
 	std::vector<int>					  arucoDetectedIDs;												// Collection of IDs detected
 	cv::Point3f							  arucoPositionError3dNew = cv::Point3f( 0.0f, 0.0f, 0.0f );	// [mm] New raw position of tag relative to camera
 	cv::Point2i							  arucoPositionError2d	  = cv::Point2i( 0, 0 );				// [px] Position of tag relative to camera
 	std::vector<std::vector<cv::Point2f>> arucoCorners ;
-	std::vector<cv::Vec3d>				  arucoRotationVector, arucoTranslationVector;
+	cv::Vec3d							  arucoRotationVector, arucoTranslationVector;					// Pose of the active tag
+	cv::Vec3d							  arucoRotationPrevious, arucoTranslationPrevious;				// Warm start for the next frame
+	cv::Vec3d							  arucoRotationRefined, arucoTranslationRefined;				// Warm-started candidate
+	bool								  isPosePrevious = false;										// Previous frame had a pose
+	cv::TermCriteria					  arucoRefineCriteria { cv::TermCriteria::COUNT | cv::TermCriteria::EPS, 10, 1e-6 };
+	std::vector<cv::Point2f>			  arucoMarkerCornersPX = std::vector<cv::Point2f>( 4 );		// Corners of the tag being processed
 	cv::Mat								  arucoPoints { 4, 1, CV_32FC3 };
 	std::vector<cv::Point2i>			  arucoActiveCorners = { cv::Point2i( 0, 0 ), cv::Point2i( 0, 0 ), cv::Point2i( 0, 0 ), cv::Point2i( 0, 0 ) };
+	std::vector<cv::Point2f>			  arucoCornersUndistorted;										// Corners moved from raw to undistorted space
+	cv::Mat								  arucoNoDistortion = cv::Mat::zeros( 1, 5, CV_64F );			// Pose from corners that are already undistorted
+	std::vector<cv::Point2f>			  arucoReprojectedPX = std::vector<cv::Point2f>( 4 );		// Tag corners projected back from the pose
 	
 	// short								  arucoMarkerSize	 = 20;
 
+	// Region-of-interest tracking, corners kept in detection space
+	std::vector<cv::Point2f>			  trackedCorners;				// Active tag corners from the last hit
+	int									  trackedID		 = 0;			// Tag the window follows
+	float								  trackedDepthMM = 0.0f;		// [mm] Tag distance at the last hit
+	std::chrono::steady_clock::time_point timeTracked;					// Grab time of the last hit
+	unsigned short						  framesSinceFullSearch = 0;	// Windowed frames since the whole frame was searched
+
 
 	std::vector<std::vector<cv::Point2f>> arucoRejects;
 };
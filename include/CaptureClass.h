@@ -3,12 +3,24 @@
 // Memory for shared data
 #include <memory>
 
+// Capture thread
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
 // OpenCV core functions
-#include <opencv2/calib3d.hpp>
 #include <opencv2/core.hpp>
-#include <opencv2/cudawarping.hpp>
-#include <opencv2/imgproc.hpp>
-#include <opencv2/videoio.hpp>
+
+// Live, recorded and synthetic frame sources
+#include "FrameSourceClass.h"
+
+// Latest-frame handoff between capture thread and main loop
+#include "TripleBuffer.h"
+
+// Frame preprocessing
+#include "UndistortClass.h"
 
 
 
@@ -17,7 +29,20 @@ class SystemDataManager;
 struct ManagedData;
 
 
-/** 
+/**
+ * @brief One camera frame prepared for detection
+ */
+struct CaptureFrameStruct {
+	cv::Mat								  frameRaw;				 // Camera image as delivered by the source
+	cv::Mat								  frameGray;			 // Contrast-adjusted gray image used for detection
+	bool								  isGrayRaw	  = false;	 // frameGray is in raw (distorted) camera space
+	std::chrono::steady_clock::time_point timeGrabbed;			 // Moment the source delivered the frame
+	std::chrono::steady_clock::time_point timeSource;			 // Moment the frame was recorded, same as timeGrabbed when live
+	uint64_t							  frameNumber = 0;		 // Running frame counter
+};
+
+
+/**
  * @brief Capture class definition
  */
 class CaptureClass {
@@ -26,9 +51,14 @@ class CaptureClass {
 public:
 	// Data manager handle
 	CaptureClass( SystemDataManager& dataHandle );
+	~CaptureClass();
 
 	// Public functions
+	bool Initialize();
+	bool SetSource( std::unique_ptr<FrameSourceClass> source );
+	void Start();
 	void GetFrame();
+	void Close();
 
 private:
 	// Data manager handle
@@ -36,10 +66,23 @@ private:
 	std::shared_ptr<ManagedData> shared;
 
 	// Capture variables
-	cv::VideoCapture Capture;
+	std::unique_ptr<FrameSourceClass> Source;
+	UndistortClass					  Undistort;
+
+	// Capture thread
+	std::thread						   captureThread;
+	std::atomic<bool>				   isCaptureRunning = { false };
+	TripleBuffer<CaptureFrameStruct> frameBuffer;
+	TripleBuffer<cv::Mat>			   displayBuffer;	 // Undistorted color frames, only published when produced
+	uint64_t						   frameCounter = 0;
 
+	// Wakes the main loop when a frame is published
+	std::mutex				frameMutex;
+	std::condition_variable frameSignal;
+	uint64_t				framesPublished = 0;	// Guarded by frameMutex
+	uint64_t				framesTaken		= 0;	// Main loop only
 
 	// Private functions
-	void		Initialize();
-	
-};
\ No newline at end of file
+	void CaptureLoop();
+	void ProcessFrame( CaptureFrameStruct& frame, cv::Mat& frameUndistorted, bool isColorRequired );
+};
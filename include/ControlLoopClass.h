@@ -0,0 +1,78 @@
+#pragma once
+
+// Memory for shared data
+#include <memory>
+
+// Control thread
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+// Controller input
+#include "ControllerClass.h"
+
+// Target state and settings into the control thread, its result back out
+#include "TripleBuffer.h"
+
+
+
+// Forward declarations
+class SystemDataManager;
+class SerialClass;
+struct ManagedData;
+
+
+/**
+ * @brief Runs the controller and the serial send at CONFIG_CONTROL_RATE_HZ, apart from the camera
+ *
+ * The main loop posts the filtered target state once per frame, the control thread picks up the
+ * newest state at every tick, predicts it to actuation time and sends the command. Between frames
+ * the prediction horizon keeps growing, so the motors follow the constant-velocity model instead of
+ * holding the command of the last frame.
+ *
+ * The control thread never touches shared data the main loop writes. Update() hands it the gains,
+ * flags, ramp requests and amplifier feedback once per loop and copies the result of the latest tick
+ * back for the display and logger, both through triple buffers. Converting the amplifier feedback
+ * for display (ControllerClass::UpdateAmplifier) stays on the main loop, where Receive() parses it.
+ * Without the thread, Update() runs the controller and the send on the main loop instead.
+ *
+ * The first tick on each frame pushes its control and send stamps to Latency.controlStamps, tagged
+ * with the frame's grab time, so LatencyClass can match them to the frame they belong to.
+ */
+class ControlLoopClass {
+
+public:
+	// Data manager handle
+	ControlLoopClass( SystemDataManager& dataHandle, ControllerClass& controller, SerialClass& serial );
+	~ControlLoopClass();
+
+	// Public functions
+	void Start();
+	void Close();
+	void Post( const ControlInputStruct& input );
+	void Update();
+	bool IsRunning() const { return isControlRunning; }
+
+private:
+	// Data manager handle
+	SystemDataManager&			 dataHandle;
+	std::shared_ptr<ManagedData> shared;
+	ControllerClass&			 Controller;
+	SerialClass&				 Serial;
+
+	// Control thread
+	std::thread							controlThread;
+	std::atomic<bool>					isControlRunning = { false };
+	TripleBuffer<ControlInputStruct>	inputBuffer;
+	TripleBuffer<ControlSettingsStruct> settingsBuffer;
+	TripleBuffer<ControlOutputStruct>	outputBuffer;
+	uint64_t							nTicks	   = 0;
+	uint64_t							nTicksLate = 0;
+
+	// Latency trace
+	std::chrono::steady_clock::time_point timeTraced;	 // Frame of the last pushed stamps, ticking thread only
+
+	// Private functions
+	void ControlLoop();
+	void TraceTick( std::chrono::steady_clock::time_point timeSent );
+};
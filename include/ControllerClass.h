@@ -1,26 +1,101 @@
 #pragma once
 
+#include <array>
+#include <chrono>
 #include <cmath>
 #include <memory>
 #include <opencv2/core.hpp>
+#include <string>
 
+// Gain and state types
+#include "SystemDataManager.h"
 
-class SystemDataManager;
-struct ManagedData;
 
-// Constants
-#define RAD2DEG 57.2958
-#define DEG2RAD 0.01745
+/**
+ * @brief Target state from the vision side, one per processed frame
+ */
+struct ControlInputStruct {
+	bool								  isTargetFound		   = false;
+	bool								  isTargetReset		   = false;
+	cv::Point3f							  positionFilteredMM   = cv::Point3f( 0.0f, 0.0f, 0.0f );	 // [mm]
+	cv::Point3f							  velocityFilteredMM   = cv::Point3f( 0.0f, 0.0f, 0.0f );	 // [mm/s]
+	cv::Point3f							  positionIntegratedMM = cv::Point3f( 0.0f, 0.0f, 0.0f );
+	std::chrono::steady_clock::time_point timeCaptured;	   // Grab time of the frame the state belongs to
+};
+
+
+/**
+ * @brief Gains, flags and amplifier feedback from the main loop, everything a control tick reads besides the target
+ */
+struct ControlSettingsStruct {
+
+	// Controller
+	Point4f		gainKp;
+	Point4f		gainKi;
+	Point4f		gainKd;
+	float		integralDecay	    = 0.9f;	   // Integral kept per frame without a target
+	float		rampDurationTime    = 1.0f;	   // [s]
+	uint32_t	nRampRequests	    = 0;	   // Ramp restarts asked for so far, see ControllerStruct
+	bool		isPredictionEnabled = CONFIG_PREDICTION_ENABLED;
+	float		sendP50MS		    = 0.0f;	   // [ms] Median control to send time
+	float		packetDelayMS	    = 0.0f;	   // [ms] Serial packet delay
+	bool		isTensionOnly	    = false;
+	cv::Point3f commandedTensionABC = cv::Point3f( 0.0f, 0.0f, 0.0f );
+	cv::Point3f commandedLimits	    = cv::Point3f( 0.0f, 0.0f, 0.0f );
+	bool		isOverLimitA	    = false;
+	bool		isOverLimitB	    = false;
+	bool		isOverLimitC	    = false;
+
+	// Serial send
+	bool	  isSending			 = false;	 // Port open and sending switched on
+	stateEnum state				 = stateEnum::IDLE;
+	bool	  isAmplifierActive  = false;
+	bool	  isReverseRequested = false;
+	bool	  isReverseConstant  = false;
+};
+
+
+/**
+ * @brief Result of one control tick, copied into shared data on the main loop for the display and logger
+ */
+struct ControlOutputStruct {
+	cv::Point3f							  positionPredictedMM	 = cv::Point3f( 0.0f, 0.0f, 0.0f );	   // [mm] What the controller acted on
+	float								  predictionHorizonMS	 = 0.0f;							   // [ms]
+	cv::Point3f							  proportionalTerm		 = cv::Point3f( 0.0f, 0.0f, 0.0f );
+	cv::Point3f							  integralTerm			 = cv::Point3f( 0.0f, 0.0f, 0.0f );
+	cv::Point3f							  derivativeTerm		 = cv::Point3f( 0.0f, 0.0f, 0.0f );
+	cv::Point3f							  combinedPIDTerms		 = cv::Point3f( 0.0f, 0.0f, 0.0f );
+	cv::Point3f							  percentageProportional = cv::Point3f( 0.0f, 0.0f, 0.0f );
+	cv::Point3f							  percentageIntegral	 = cv::Point3f( 0.0f, 0.0f, 0.0f );
+	cv::Point3f							  percentageDerivative	 = cv::Point3f( 0.0f, 0.0f, 0.0f );
+	cv::Point3f							  commandedPercentageABC = cv::Point3f( 0.0f, 0.0f, 0.0f );
+	cv::Point3f							  commandedCurrentABC	 = cv::Point3f( 0.0f, 0.0f, 0.0f );
+	cv::Point3i							  commandedPwmABC		 = cv::Point3i( 2048, 2048, 2048 );	   // 2048 is off
+	float								  rampPercentage		 = 0.0f;
+	bool								  isRampingUp			 = false;
+	std::chrono::steady_clock::time_point timeCaptured;		 // Grab time of the frame the result was computed from
+	std::chrono::steady_clock::time_point timeControlled;	 // Controller update done
+};
 
 class ControllerClass {
 public:
 	ControllerClass( SystemDataManager& ctx );
 
-	void Update();
-	void Update4D();
-	void MapToContributionABC( cv::Point3f terms );
-	void UpdateAmplifier();
-	void UpdateVibrotactile();
+	void					   SetInput( const ControlInputStruct& newInput );
+	void					   SetSettings( const ControlSettingsStruct& newSettings );
+	const ControlOutputStruct& GetOutput() const { return output; }
+	ControlSettingsStruct	   ReadSettings() const;								// Main loop only
+	void					   WriteOutput( const ControlOutputStruct& result );	// Main loop only
+	void					   Update();
+	void					   Update( std::chrono::steady_clock::time_point timeNow );	// Simulated clock, see PlantSimulatorClass
+	void					   Update4D();
+	void					   MapToContributionABC( cv::Point3f terms );
+	cv::Point3f				   MapToContributionTerm( cv::Point3f terms );
+	void					   AllocateTerms( const cv::Point3f* terms, cv::Point3f* shares, size_t nTerms ) const;
+	void					   UpdateAmplifier();
+	void					   UpdateVibrotactile();
+	bool					   LoadGains( const std::string& path );
+	bool					   SaveGains( const std::string& path ) const;
 
 private:
 	SystemDataManager&			 dataHandle;
@@ -28,14 +103,6 @@ private:
 
 	// float		radius		   = 0.005f;							 // Pulley radius in [m]
 	cv::Point3f contribution = cv::Point3f( 0.0f, 0.0f, 0.0f );	   // Motor contribution
-	float		rTarget		 = 0.0f;							   // Distance to Target on XY plane
-	float		rMax		 = 0.0f;							   // Maximum target distance (based on max angle 40-deg)
-	float		rMaxXY		 = 0.0f;							   // Maximum target distance (based on max angle 40-deg)
-	float		rMaxZ		 = 0.0f;							   // Maximum target distance (based on max angle 40-deg)
-	float		thTarget	 = 0.0f;							   // Angle towards Target on XY plane
-	float		thAT		 = 0.0f;							   // Angle between Target and motor A
-	float		thBT		 = 0.0f;							   // Angle between Target and motor B
-	float		thCT		 = 0.0f;							   // Angle between Target and motor C
 	const float thA			 = 35.0f * DEG2RAD;					   // Angle of motor A
 	const float thB			 = 145.0f * DEG2RAD;				   // Angle of motor B
 	const float thC			 = 270.0f * DEG2RAD;				   // Angle of motor C
@@ -43,15 +110,36 @@ private:
 	const float thBC		 = 125.0f * DEG2RAD;				   // Arc of motors BC
 	const float thAC		 = 125.0f * DEG2RAD;				   // Arc of motors AC
 
+	// Motor allocation, share of each motor per unit strength sampled over the direction angle
+	static constexpr int							 ALLOCATION_STEPS_PER_DEG = 2;	  // Keeps the motor angles on sample points
+	static constexpr int							 ALLOCATION_STEPS		  = 360 * ALLOCATION_STEPS_PER_DEG;
+	std::array<cv::Point3f, ALLOCATION_STEPS + 1> allocationTable;
+
+	// Latest target state, settings and result, only touched by the thread running Update()
+	ControlInputStruct	  input;
+	bool				  isInputFresh = false;	   // Not yet used by Update()
+	ControlSettingsStruct settings;
+	ControlOutputStruct	  output;
+
+	// Ramp-up after the amplifiers are switched on or the target is reset
+	uint32_t							  nRampRequestsSeen = 0;
+	std::chrono::steady_clock::time_point timeRampStart;
+
+	// Persistent over-limit state tracker, per controller so simulated runs start clean
+	bool wasOverLimitA = false;
+	bool wasOverLimitB = false;
+	bool wasOverLimitC = false;
+
 	// PID
 	cv::Point3f currentError  = cv::Point3f( 0.0f, 0.0f, 0.0f );
 	cv::Point3f previousError = cv::Point3f( 0.0f, 0.0f, 0.0f );
 	cv::Point3f deltaError	  = cv::Point3f( 0.0f, 0.0f, 0.0f );
-	float		integralDecay = 0.9f;	 // 0.9 = slow, 0.0 = instant
 
 	// Functions
+	void		BuildAllocationTable();
+	void		MapToMotors();
 	cv::Point3f MapToCurrent( cv::Point3f percentage, float iNominal );
 	cv::Point3i MapToPWM( cv::Point3f percentage, int min, int max );
-	cv::Point3f MapToContributionTerm( cv::Point3f terms );
-	void		RampUp();
+	void		Predict( std::chrono::steady_clock::time_point timeNow );
+	void		RampUp( std::chrono::steady_clock::time_point timeNow );
 };
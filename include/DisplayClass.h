@@ -30,7 +30,9 @@ public:
 	DisplayClass( SystemDataManager& dataHandle );
 
 	// Public functions
+	void Initialize();
 	void Update();
+	void Render();
 	void AddStaticDisplayPanels();
 	// void ShowVisualizer();
 	// void UpdateVisualizer();
@@ -106,6 +108,10 @@ private:
 	short	 log_textX	= 0;
 	short	 log_textY	= 0;
 
+	// Profiler variables
+	bool	 isProfilerDrawn  = false;
+	uint32_t profilerRevision = 0;
+
 
 	// Visualizer settings
 	std::vector<cv::Point2i> ProjectedCorners;
@@ -125,6 +131,7 @@ private:
 	void BuildLogInterface();
 	void BuildKeyboardShortcuts();
 	void BuildChecklist();
+	void BuildProfilerInterface();
 
 	// Drawing helper functions
 	void DrawCell( std::string str, std::string cell0, short width, short height, float sz, cv::Scalar textColor, cv::Scalar fillColor, bool centered );
@@ -143,6 +150,8 @@ private:
 	void AddTextSerial();
 	void AddTextMotorOutput();
 	void AddTextTask();
+	void AddTextLatency();
+	void AddTextLoop();
 
 
 	// Outdated visualization
@@ -0,0 +1,147 @@
+#pragma once
+
+// Standard libraries
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+// OpenCV core functions
+#include <opencv2/core.hpp>
+#include <opencv2/videoio.hpp>
+
+
+
+// Pacing of recorded and synthetic frames
+enum class replayModeEnum { REAL_TIME, AS_FAST_AS_POSSIBLE };
+
+
+/**
+ * @brief Where CaptureClass gets its frames from
+ *
+ * Read() blocks until the next frame is due and stamps it twice: timeGrabbed is when it entered
+ * the pipeline, always the steady clock at delivery, and timeSource is when it was recorded, the
+ * spacing between frames the filter steps by. The two only differ for replay, which runs ahead of
+ * the clock as fast as possible. Implementations are only ever used from the capture thread.
+ */
+class FrameSourceClass {
+
+public:
+	virtual ~FrameSourceClass() = default;
+
+	// Source interface
+	virtual bool		Open()																														  = 0;
+	virtual bool		Read( cv::Mat& frame, std::chrono::steady_clock::time_point& timeGrabbed, std::chrono::steady_clock::time_point& timeSource ) = 0;
+	virtual void		Close()																														  = 0;
+	virtual bool		IsOpen() const																												  = 0;
+	virtual bool		IsFinished() const { return false; }	// Replay reached its last frame
+	virtual std::string Describe() const																											  = 0;
+};
+
+
+/**
+ * @brief Live camera on /dev/video0 through V4L2
+ */
+class LiveSourceClass : public FrameSourceClass {
+
+public:
+	LiveSourceClass( const std::string& device );
+
+	bool		Open() override;
+	bool		Read( cv::Mat& frame, std::chrono::steady_clock::time_point& timeGrabbed, std::chrono::steady_clock::time_point& timeSource ) override;
+	void		Close() override;
+	bool		IsOpen() const override;
+	std::string Describe() const override;
+
+private:
+	std::string		 device;
+	cv::VideoCapture Capture;
+};
+
+
+/**
+ * @brief Common pacing for sources that replay frames with known timestamps
+ */
+class ReplaySourceClass : public FrameSourceClass {
+
+public:
+	ReplaySourceClass( replayModeEnum mode );
+
+protected:
+	// Map a recorded frame time onto the steady clock, sleeping first in real-time mode
+	std::chrono::steady_clock::time_point PaceFrame( double frameTimeSeconds );
+	void								  ResetPacing();
+
+	replayModeEnum replayMode;
+
+private:
+	bool								  isPacingStarted = false;
+	double								  firstFrameTime  = 0.0;
+	std::chrono::steady_clock::time_point replayStartTime;
+};
+
+
+/**
+ * @brief Recorded session, either a video file or a directory of images
+ *
+ * Per-frame timestamps in seconds are read from a text file with one value per line, found next to
+ * the recording as `<video>.timestamps.txt` or `<directory>/timestamps.txt`. Frames without a
+ * timestamp are spaced at CONFIG_CAM_FRAMERATE.
+ */
+class RecordedSourceClass : public ReplaySourceClass {
+
+public:
+	RecordedSourceClass( const std::string& path, replayModeEnum mode, bool isLooping = false );
+
+	bool		Open() override;
+	bool		Read( cv::Mat& frame, std::chrono::steady_clock::time_point& timeGrabbed, std::chrono::steady_clock::time_point& timeSource ) override;
+	void		Close() override;
+	bool		IsOpen() const override;
+	bool		IsFinished() const override;
+	std::string Describe() const override;
+
+	// Number of frames, if known up front (image sequences only)
+	size_t FrameCount() const;
+
+private:
+	bool   LoadTimestamps( const std::string& timestampPath );
+	double FrameTime( size_t index ) const;
+
+	std::string				path;
+	bool					isLooping	  = false;
+	bool					isImageFolder = false;
+	bool					isOpen		  = false;
+	bool					isFinished	  = false;
+	size_t					frameIndex	  = 0;
+	double					loopOffset	  = 0.0;	// Added to timestamps after each wrap
+	std::vector<cv::String> imageFiles;
+	std::vector<double>		timestamps;
+	cv::VideoCapture		Video;
+};
+
+
+/**
+ * @brief Frames produced in memory by a generator callback
+ *
+ * The generator fills the frame and its time in seconds and returns false when it has no more
+ * frames. Used for benchmarks and simulation without a camera or a recording.
+ */
+class SyntheticSourceClass : public ReplaySourceClass {
+
+public:
+	using GeneratorFunction = std::function<bool( cv::Mat& frame, double& frameTimeSeconds )>;
+
+	SyntheticSourceClass( GeneratorFunction generator, replayModeEnum mode );
+
+	bool		Open() override;
+	bool		Read( cv::Mat& frame, std::chrono::steady_clock::time_point& timeGrabbed, std::chrono::steady_clock::time_point& timeSource ) override;
+	void		Close() override;
+	bool		IsOpen() const override;
+	bool		IsFinished() const override;
+	std::string Describe() const override;
+
+private:
+	GeneratorFunction generator;
+	bool			  isOpen	 = false;
+	bool			  isFinished = false;
+};
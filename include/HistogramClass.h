@@ -0,0 +1,71 @@
+#pragma once
+
+// Standard libraries
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+
+
+/**
+ * @brief Fixed-bin histogram for timing values
+ *
+ * Bins are allocated once in the constructor, Add() only increments counters. Values above the last
+ * bin land in an overflow bin and are still counted in the mean and maximum. Percentiles are
+ * reported at the centre of the bin they fall into, so their resolution is the bin width.
+ */
+class HistogramClass {
+
+public:
+	HistogramClass( double binWidth = 0.1, size_t nBins = 1000 )
+		: binWidth( binWidth )
+		, bins( nBins + 1, 0 ) { }
+
+	void Add( double value ) {
+		size_t bin = ( value <= 0.0 ) ? 0 : std::min( size_t( value / binWidth ), bins.size() - 1 );
+		bins[bin]++;
+		count++;
+		sum += value;
+		max = std::max( max, value );
+	}
+
+	void Reset() {
+		std::fill( bins.begin(), bins.end(), 0 );
+		count = 0;
+		sum	  = 0.0;
+		max	  = 0.0;
+	}
+
+	uint64_t Count() const { return count; }
+	double	 Mean() const { return count ? sum / count : 0.0; }
+	double	 Max() const { return max; }
+	double	 BinWidth() const { return binWidth; }
+
+	const std::vector<uint64_t>& Bins() const { return bins; }
+
+	// Value below which the given fraction of samples fall
+	double Percentile( double fraction ) const {
+
+		if ( count == 0 ) {
+			return 0.0;
+		}
+
+		uint64_t target		= uint64_t( fraction * ( count - 1 ) ) + 1;
+		uint64_t cumulative = 0;
+		for ( size_t i = 0; i < bins.size() - 1; i++ ) {
+			cumulative += bins[i];
+			if ( cumulative >= target ) {
+				return std::min( ( i + 0.5 ) * binWidth, max );
+			}
+		}
+
+		return max;
+	}
+
+private:
+	double				  binWidth = 0.1;
+	std::vector<uint64_t> bins;				// Last bin collects overflow
+	uint64_t			  count = 0;
+	double				  sum	= 0.0;
+	double				  max	= 0.0;
+};
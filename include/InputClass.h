@@ -7,6 +7,10 @@
 #include <functional>
 #include <unordered_map>
 
+// Headless input script
+#include <string>
+#include <vector>
+
 // OpenCV core functions
 #include <opencv2/core.hpp>
 #include <opencv2/highgui.hpp>
@@ -29,6 +33,10 @@ public:
 	// Public functions
 	void ParseInput( int key );
 
+	// Headless input
+	bool LoadScript( const std::string& path );
+	void ParseScript();
+
 	// Register key bindings
 	void RegisterKeyBindings();
 
@@ -41,6 +49,16 @@ private:
 	// Key map
 	std::unordered_map<int, std::function<void()>> keyBindings;
 
+	// Scripted input, sorted by time
+	struct ScriptEventStruct {
+		float		timeS	 = 0.0f;	 // Seconds after startup
+		char		command	 = 'k';		 // k = key, t = touch, r = release
+		int			key		 = 255;
+		cv::Point2i position = cv::Point2i( 0, 0 );
+	};
+	std::vector<ScriptEventStruct> script;
+	size_t						   scriptIndex = 0;
+
 	// Increment / decrement
 	void AdjustValue( float& target, float step, float min, float max );
 	void Increment( float& target, float step, float max );
@@ -97,4 +115,10 @@ private:
 	void K_DeselectAdjustment();
 	void K_SetReverseType();
 	void K_RotateCamera();
+	void K_CaptureBackendToggle();
+	void K_DetectionSpaceToggle();
+	void K_TrackingToggle();
+	void K_PyramidLevelCycle();
+	void K_ProfilerToggle();
+	void K_TraceToggle();
 };
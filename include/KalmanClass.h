@@ -1,6 +1,7 @@
 #pragma once
 
 // Memory for shared data
+#include <array>
 #include <memory>
 
 // OpenCV
@@ -13,9 +14,45 @@
 class SystemDataManager;
 struct ManagedData;
 
+
+// One lane per axis and bank marker, lane = axis * CONFIG_MARKER_BANK_SIZE + slot
+inline constexpr size_t KALMAN_LANES = 3 * CONFIG_MARKER_BANK_SIZE;
+
+
+/**
+ * @brief Constant-velocity filters for every bank marker, structure of arrays
+ *
+ * Each lane is one axis of one marker with state [p v] and symmetric covariance [p00 p01; p01 p11].
+ * Measurement noise and time step are per lane, from the detection quality and the time since the
+ * marker's last accepted measurement.
+ */
+struct KalmanBankStruct {
+	alignas( 32 ) std::array<float, KALMAN_LANES> position {};
+	alignas( 32 ) std::array<float, KALMAN_LANES> velocity {};
+	alignas( 32 ) std::array<float, KALMAN_LANES> p00 {};
+	alignas( 32 ) std::array<float, KALMAN_LANES> p01 {};
+	alignas( 32 ) std::array<float, KALMAN_LANES> p11 {};
+	alignas( 32 ) std::array<float, KALMAN_LANES> measured {};
+	alignas( 32 ) std::array<float, KALMAN_LANES> isMeasured {};	// 1 when the lane is corrected this frame, 0 leaves it untouched
+	alignas( 32 ) std::array<float, KALMAN_LANES> noiseR {};		// [mm^2] Measurement noise
+	alignas( 32 ) std::array<float, KALMAN_LANES> dt {};			// [s] Since the last accepted measurement
+	alignas( 32 ) std::array<float, KALMAN_LANES> innovation {};	// [mm] Measurement minus prediction
+	alignas( 32 ) std::array<float, KALMAN_LANES> innovationS {};	// [mm^2] Innovation variance
+	std::array<float, CONFIG_MARKER_BANK_SIZE>	  tMeasured {};		// Last accepted measurement per marker
+	std::array<bool, CONFIG_MARKER_BANK_SIZE>	  isInitialized {};
+	std::array<unsigned short, CONFIG_MARKER_BANK_SIZE> nRejected {};	// Consecutive measurements outside the gate
+};
+
+
 /**
  * @brief Create a new kalman filter object
- * 
+ *
+ * Keeps a filter for every marker in CONFIG_MARKER_BANK_IDS, so switching the active target picks
+ * up an already converged state. x, y and z follow independent constant-velocity models with
+ * diagonal noise, so each marker's 6x6 filter is run as three 2x2 filters with a closed-form gain.
+ * All lanes are updated in one branch-free pass over the arrays, no allocations per update.
+ * Measurements far outside their predicted spread are rejected by an innovation gate, a marker
+ * that keeps failing it has really moved and starts over on the measurement.
  */
 class KalmanClass {
 public:
@@ -27,8 +64,8 @@ public:
 	KalmanClass( SystemDataManager& ctx );
 
 	// Public methods
-	void		Initialize( const cv::Point3f& initialPos, float tInitial );	// Initialize filter
-	void		Update( const cv::Point3f& measuredPos, float tCurrent );		// Update filter
+	void		Initialize( const cv::Point3f& initialPos, float tInitial );	// Initialize active target filter
+	void		Update( float tCurrent );										// Update every marker seen this frame
 	cv::Point3f GetPosition() const;											// Get filtered position
 	cv::Point3f GetVelocity() const;											// Get filtered velocity
 	cv::Point2f GetAngle() const;												// Get filtered angle
@@ -48,31 +85,25 @@ private:
 	SystemDataManager&			 dataHandle;
 	std::shared_ptr<ManagedData> shared;
 
-	// Private matrices
-	cv::Mat state;										// [x y z vx vy vz]
-	cv::Mat P = cv::Mat::eye( 6, 6, CV_32F ) * 1.0f;	// Covariance
-	cv::Mat Q;											// Process noise
-	cv::Mat R;											// Measurement noise
-	cv::Mat H;											// Measurement matrix
-	cv::Mat I;											// Identity
-
-	// Measurement matrices
-	cv::Mat z;
-	cv::Mat y;
-	cv::Mat S;
-	cv::Mat K;
-	cv::Mat F;
+	// Filter bank
+	KalmanBankStruct bank;
+	int				 activeSlot = -1;	 // Bank slot the integral error belongs to
 
 	// Private variables
 	float tPrevious						= 0.0f;		// Previous timestamp
-	bool  isInitialized					= false;	// Check if filter is initialized
 	float dt							= 0.0f;		// Timestep
 	float kalmanProcessNoiseCovarianceQ = 0.01f;	// 0.01 Higher Q = more trust in model, faster response, less lag
-	float kalmanMeasurementNoiseR		= 0.1f;		// 0.5f;		// 10.0 [mm^2] Higher R means less trust in model, smoother but more lag
-	float kalmanTimeStepDt				= 0.01f;	// 0.01 Minimum time step
+	float kalmanProcessNoiseVelocityQ	= 0.5f;		// Process noise on the velocity states
+	float kalmanTimeStepDt				= 0.01f;	// 0.01 Longest time step of the integral error
 
 	// Integral error
 	cv::Point3f integralError = cv::Point3f( 0.0f, 0.0f, 0.0f );
 	cv::Point3f prevError	  = cv::Point3f( 0.0f, 0.0f, 0.0f );
 	float		maxError	  = 100.0f;	   // [mm]
+
+	// Private functions
+	void InitializeSlot( int slot, const cv::Point3f& initialPos, float tInitial );
+	void Innovate();
+	void Gate( float tCurrent );
+	void PredictAndCorrect();
 };
\ No newline at end of file
@@ -0,0 +1,69 @@
+#pragma once
+
+// Memory for shared data
+#include <memory>
+
+// Frame timestamps
+#include <chrono>
+#include <deque>
+#include <string>
+
+// Latency distributions
+#include "HistogramClass.h"
+
+
+
+// Forward declarations
+class SystemDataManager;
+struct ManagedData;
+
+
+/**
+ * @brief Frame that made it through detection and filtering, waiting for its control tick
+ */
+struct LatencyFrameStruct {
+	std::chrono::steady_clock::time_point timeGrabbed;
+	std::chrono::steady_clock::time_point timeFiltered;
+};
+
+
+/**
+ * @brief Glass-to-motor latency of every captured frame
+ *
+ * Each frame carries its grab time from the capture thread. FindTags and KalmanClass::Update stamp
+ * Latency.time* as they finish, and Update(), called once per loop, turns the stamps of a newly
+ * captured frame into per-segment histograms. The control and send stamps come from the first
+ * control tick on the frame, through Latency.controlStamps and tagged with its grab time, so they
+ * are matched to their own frame whether or not the control thread runs. Stages that did not run
+ * for the frame (no tag, serial off) end the chain.
+ */
+class LatencyClass {
+
+public:
+	// Data manager handle
+	LatencyClass( SystemDataManager& dataHandle );
+
+	// Public functions
+	void Update();
+	void Dump( const std::string& timestamp );
+
+private:
+	// Data manager handle
+	SystemDataManager&			 dataHandle;
+	std::shared_ptr<ManagedData> shared;
+
+	// Segment distributions [ms]
+	HistogramClass histCaptureToDetect;
+	HistogramClass histDetectToFilter;
+	HistogramClass histFilterToControl;
+	HistogramClass histControlToSend;
+	HistogramClass histCaptureToSend;
+
+	// Private variables
+	std::chrono::steady_clock::time_point timeRecorded;				 // Grab time of the last recorded frame
+	std::deque<LatencyFrameStruct>		  framesPending;			 // Oldest first, until their control tick comes in
+	unsigned short						  nFramesSinceSummary = 0;	 // Display summary refresh counter
+
+	// Private functions
+	void UpdateSummary();
+};
@@ -36,6 +36,10 @@ struct loggingStruct {
 	std::string custom8;
 	std::string custom9;
 	std::string custom10;
+
+	// Loop health
+	float	 loopPeriodMS  = 0.0f;	  // [ms] Mean period over the last second
+	uint32_t nOverrunsTask = 0;		  // Deadline misses so far in this task
 };
 
 
@@ -0,0 +1,80 @@
+#pragma once
+
+// Standard libraries
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Packet types
+#include "PacketTypes.h"
+
+
+
+/**
+ * @brief Receive statistics since the port was opened
+ */
+struct SerialCountersStruct {
+	uint64_t nPackets		 = 0;	 // Valid packets decoded
+	uint64_t nFramingErrors	 = 0;	 // Start byte followed by a wrong length or footer
+	uint64_t nChecksumErrors = 0;	 // Complete frame with a bad checksum
+	uint64_t nBytesSkipped	 = 0;	 // Bytes thrown away while looking for a start byte
+	uint64_t nDropped		 = 0;	 // Valid packets the reader could not hand on
+};
+
+
+/**
+ * @brief Payload of one valid frame, the length says which packet it is
+ */
+struct FramedPacketStruct {
+	bool				  isTelemetry = false;	  // telemetry is filled instead of packet
+	PacketStruct		  packet;
+	TelemetryPacketStruct telemetry;
+};
+
+
+
+/**
+ * @brief Incremental decoder for the Teensy serial frame
+ *
+ * Frame: start byte, payload length, checksum, payload, end byte. The length is that of a
+ * PacketStruct or a TelemetryPacketStruct, anything else is a framing error. Bytes go into a ring
+ * in any chunking, straight from read() through WriteSpace() and Commit(), and Next() takes
+ * complete frames out. A frame that fails any check costs only its start byte, the search for the next
+ * start byte begins right after it, so a corrupt or cut-off frame never swallows the good one
+ * behind it. Not thread safe, the reader thread owns it.
+ */
+class PacketFramerClass {
+
+public:
+	// Frame layout
+	static constexpr uint8_t START_BYTE		  = 0xAA;
+	static constexpr uint8_t END_BYTE		  = 0x55;
+	static constexpr size_t	 FRAME_LENGTH	  = sizeof( PacketStruct ) + 4;
+	static constexpr size_t	 MAX_FRAME_LENGTH = sizeof( TelemetryPacketStruct ) + 4;
+
+	// Public functions
+	uint8_t* WriteSpace( size_t& nFree );
+	void	 Commit( size_t nBytes );
+	void	 Write( const uint8_t* bytes, size_t nBytes );
+	bool	 Next( FramedPacketStruct& outPacket );
+	void	 Reset();
+
+	const SerialCountersStruct& Counters() const { return counters; }
+	SerialCountersStruct&		Counters() { return counters; }
+
+	static uint8_t Checksum( const uint8_t* payload, uint8_t packetLength );
+	static size_t  Encode( const uint8_t* payload, uint8_t packetLength, uint8_t* buffer );
+
+private:
+	// Received bytes, head and tail run freely and are masked into the ring
+	static constexpr size_t			  RING_SIZE = 1024;
+	std::array<uint8_t, RING_SIZE>	  ring {};
+	size_t							  head = 0;	   // Next byte to decode
+	size_t							  tail = 0;	   // Next byte to write
+	std::array<uint8_t, MAX_FRAME_LENGTH> frame {};	// Frame copied out of the ring
+
+	// Statistics
+	SerialCountersStruct counters;
+
+	static_assert( ( RING_SIZE & ( RING_SIZE - 1 ) ) == 0 && RING_SIZE >= 2 * MAX_FRAME_LENGTH, "Ring must be a power of two holding two frames" );
+};
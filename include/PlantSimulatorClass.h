@@ -0,0 +1,110 @@
+#pragma once
+
+// Memory for shared data
+#include <memory>
+
+// Standard libraries
+#include <cstdint>
+#include <functional>
+
+// OpenCV core functions
+#include <opencv2/core.hpp>
+
+// Configuration
+#include "config.h"
+
+
+
+// Forward declarations
+class SystemDataManager;
+struct ManagedData;
+
+
+/**
+ * @brief Plant parameters, defaults are a relaxed hand at arm's length
+ */
+struct PlantSettingsStruct {
+
+	// Finger and hand, aim point at the target depth
+	float fingerNaturalHz	 = 4.0f;	  // [Hz] Passive stiffness pulling the aim back to rest
+	float fingerDampingRatio = 0.6f;	  // Damping of the hand
+	float fingerGainMMPerA	 = 100.0f;	  // [mm/A] Steady-state aim deflection per amp of net cable pull
+
+	// Camera
+	float cameraRateHz	  = 90.0f;	  // [Hz] Frame rate
+	float cameraLatencyMS = 15.0f;	  // [ms] Exposure to detection result
+	float cameraNoiseMM	  = 0.3f;	  // [mm] Measurement noise per axis, 1 sigma
+	float cameraDropout	  = 0.0f;	  // Chance that a frame misses the marker
+
+	// Teensy and amplifier
+	float commandDelayMS = 2.0f;						   // [ms] Serial link and firmware
+	float currentTauMS	 = 1.0f;						   // [ms] Current loop time constant
+	float currentLimitA	 = CONFIG_DEVICE_NOMINAL_CURRENT;	   // [A] Amplifier current limit per motor
+
+	// Integration
+	float	 physicsStepS = 1e-4f;	  // [s] Plant integration step
+	float	 settleBandMM = 2.0f;	  // [mm] Error band for the settling time
+	uint64_t seed		  = 1;		  // Camera noise and dropouts
+};
+
+
+/**
+ * @brief Scores of one simulated run
+ */
+struct PlantResultStruct {
+	float	 errorRMSMM	  = 0.0f;	  // [mm] True XY aim error over the run
+	float	 errorMaxMM	  = 0.0f;	  // [mm]
+	float	 errorEndMM	  = 0.0f;	  // [mm] Error at the end of the run
+	float	 overshootMM  = 0.0f;	  // [mm] Furthest the aim went past the target along the initial reach
+	float	 settleTimeS  = -1.0f;	  // [s] Error stays inside settleBandMM from here on, -1 if it never does
+	float	 currentMeanA = 0.0f;	  // [A] Mean motor current, all three motors
+	uint64_t nFrames	  = 0;		  // Frames delivered to the filter
+	uint64_t nTicks		  = 0;		  // Controller updates
+	uint64_t nOverLimit	  = 0;		  // Plant steps with a motor at the current limit
+	double	 wallTimeS	  = 0.0;	  // [s] Time the run took
+};
+
+
+/**
+ * @brief Closed-loop plant for running the real filter and controller faster than real time
+ *
+ * Three models stand in for the hardware. The hand is a damped spring holding the aim point, and the
+ * three cables pull it along the motor directions thA, thB and thC of ControllerClass. The camera
+ * samples the target relative to the aim at cameraRateHz, with noise, dropouts and latency, into
+ * Target.positionUnfilteredMM. The Teensy and amplifier apply the commanded PWM after the serial
+ * delay, map it back to current like the firmware, limit it and report currents and over-limit
+ * flags in shared->Amplifier.
+ *
+ * KalmanClass and ControllerClass run unchanged, on a simulated clock, with frames handled like
+ * UpdateSystem() and the controller ticking at CONFIG_CONTROL_RATE_HZ. Gains and controller flags
+ * are taken from shared->Controller as they are. Each run starts from rest with a fresh filter and
+ * controller, ramping up as when the amplifiers are switched on. Not thread safe, use one simulator
+ * and data manager per thread.
+ */
+class PlantSimulatorClass {
+
+public:
+	// Data manager handle
+	PlantSimulatorClass( SystemDataManager& dataHandle, const PlantSettingsStruct& settings = PlantSettingsStruct() );
+
+	// Public functions
+	PlantResultStruct Run( float durationS, const std::function<cv::Point3f( float )>& targetPath );
+
+	// Public variables
+	PlantSettingsStruct settings;
+
+private:
+	// Data manager handle
+	SystemDataManager&			 dataHandle;
+	std::shared_ptr<ManagedData> shared;
+
+	// Plant state
+	cv::Point2f aimMM		   = cv::Point2f( 0.0f, 0.0f );	  // [mm] Where the finger points at the target depth
+	cv::Point2f aimVelocityMMS = cv::Point2f( 0.0f, 0.0f );	  // [mm/s]
+	cv::Point3f currentABC	   = cv::Point3f( 0.0f, 0.0f, 0.0f );	  // [A] Motor currents
+	cv::Point3i appliedPwmABC  = cv::Point3i( 2048, 2048, 2048 );	  // PWM the amplifier is running on
+
+	// Private functions
+	void StepAmplifier( float dt, bool& isOverLimit );
+	void StepFinger( float dt );
+};
@@ -0,0 +1,99 @@
+#pragma once
+
+// Standard libraries
+#include <vector>
+
+// OpenCV core functions
+#include <opencv2/aruco.hpp>
+#include <opencv2/core.hpp>
+
+
+
+/**
+ * @brief One marker placed in the synthetic scene
+ *
+ * The pose follows the estimatePoseSingleMarkers() convention: the marker frame has its origin at the
+ * marker centre, x to the right, y up and z out of the marker, and rvec / tvec take marker points into
+ * the camera frame in mm. A marker facing the camera upright has rvec = ( pi, 0, 0 ).
+ */
+struct SceneMarkerStruct {
+	int		  id		  = 1;
+	float	  widthMM	  = 20.0f;							  // Outer edge of the black border
+	cv::Vec3d rvec		  = cv::Vec3d( CV_PI, 0.0, 0.0 );
+	cv::Vec3d tvec		  = cv::Vec3d( 0.0, 0.0, 200.0 );	  // [mm]
+	cv::Vec3d velocityMMS = cv::Vec3d( 0.0, 0.0, 0.0 );	  // [mm/s] Only used for motion trails
+};
+
+
+/**
+ * @brief Image degradations applied on top of the ideal render
+ */
+struct SceneSettingsStruct {
+	double background	  = 160.0;	  // Gray level behind the markers
+	double blurSigmaPX	  = 0.0;	  // Gaussian optical blur, 0 disables
+	double noiseSigma	  = 0.0;	  // Additive sensor noise in gray levels, 0 disables
+	double exposureGain	  = 1.0;	  // Multiplies the image, < 1 under-exposes
+	double exposureOffset = 0.0;	  // Added after the gain
+	double exposureTimeS  = 0.0;	  // Shutter time for motion trails
+	int	   trailSteps	  = 1;		  // Sub-renders averaged over the shutter time, 1 disables trails
+};
+
+
+/**
+ * @brief What the generator actually rendered, for scoring detection against
+ */
+struct SceneGroundTruthStruct {
+	std::vector<int>					  ids;
+	std::vector<cv::Vec3d>				  rvecs;				 // Pose at mid-exposure
+	std::vector<cv::Vec3d>				  tvecs;				 // [mm] Pose at mid-exposure
+	std::vector<cv::Point3f>			  positionsMM;			 // Same convention as Target.positionUnfilteredMM
+	std::vector<std::vector<cv::Point2f>> cornersRawPX;			 // Corners in the distorted camera image
+	std::vector<std::vector<cv::Point2f>> cornersUndistortedPX;	 // Corners after undistortion, unrotated
+};
+
+
+/**
+ * @brief Renders DICT_4X4_50 markers into camera-sized frames at known poses
+ *
+ * Markers are drawn into an ideal pinhole image with CONFIG_CAMERA_MATRIX, then warped through the
+ * inverse of the undistortion map so the output carries the real lens distortion. Blur, exposure
+ * and noise are applied afterwards, in that order, roughly matching lens, shutter and sensor.
+ * Output frames are CV_8UC3 at CONFIG_CAM_WIDTH x CONFIG_CAM_HEIGHT, the same as the camera.
+ *
+ * Not thread safe, use one generator per thread.
+ */
+class SceneGeneratorClass {
+
+public:
+	SceneGeneratorClass( uint64_t seed = 1 );
+
+	// Public functions
+	void Render( const std::vector<SceneMarkerStruct>& markers, const SceneSettingsStruct& settings, cv::Mat& frame, SceneGroundTruthStruct& truth );
+	void RandomPose( SceneMarkerStruct& marker, double rangeXYMM, double minZMM, double maxZMM, double maxTiltDEG );
+
+private:
+	// Private functions
+	void					 BuildDistortionMap();
+	const cv::Mat&			 MarkerPatch( int id );
+	void					 RenderIdeal( const SceneMarkerStruct& marker, const cv::Vec3d& tvec, cv::Mat& image );
+	std::vector<cv::Point3f> MarkerObjectPoints( float widthMM ) const;
+
+	// Marker dictionary and rendered patches, indexed by id
+	cv::aruco::Dictionary arucoDictionary;
+	std::vector<cv::Mat>  markerPatches;
+	int					  patchCellPX	  = 32;	   // Patch resolution per marker bit
+	int					  patchQuietCells = 1;	   // White margin around the marker, in cells
+
+	// Raw pixel -> ideal pixel lookup
+	cv::Mat matDistortMapX;
+	cv::Mat matDistortMapY;
+
+	// Working buffers, CV_32FC1
+	cv::Mat matIdeal;
+	cv::Mat matIdealSum;
+	cv::Mat matRaw;
+	cv::Mat matNoise;
+	cv::Mat matGray;
+
+	cv::RNG rng;
+};
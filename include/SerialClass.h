@@ -4,8 +4,16 @@
 #include <memory>
 
 // Packet types
+#include "PacketFramerClass.h"
 #include "PacketTypes.h"
 
+// Sent packets handed from the control thread to the main loop, received ones from the reader thread
+#include "SpscQueue.h"
+#include "TripleBuffer.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+
 // Serial libraries
 #include <cctype>		// For determining upper/lower case
 #include <fcntl.h>		// File controls
@@ -19,21 +27,46 @@
 // Forward declarations
 class SystemDataManager;
 struct ManagedData;
+struct ControlSettingsStruct;
+struct ControlOutputStruct;
+enum class traceLaneEnum : uint8_t;
+
+
+
+/**
+ * @brief Packet or telemetry batch from the Teensy with the time its bytes were read
+ */
+struct ReceivedPacketStruct {
+	FramedPacketStruct					  frame;
+	std::chrono::steady_clock::time_point timeReceived;
+};
 
 
 
 /** 
  * @brief Display class definition
+ *
+ * Incoming packets are read on their own thread, woken by epoll as bytes arrive. Each wakeup reads
+ * everything the port holds into PacketFramerClass, and decoded packets queue up for Receive() on
+ * the main loop, so a frame split over several reads is never lost and a slow main loop delays
+ * telemetry instead of dropping it. Telemetry batches carry every 1 kHz drive tick of the Teensy,
+ * Receive() appends them all to the amplifier history.
  */
 class SerialClass {
 
 public:
 	// Data manager handle
 	SerialClass( SystemDataManager& dataHandle, uint8_t nPorts );
+	~SerialClass();
 
 	// Public functions
-	void Close();
-	void Update();
+	void								  Start();	  // Reader thread
+	void								  Close();
+	std::chrono::steady_clock::time_point Send( traceLaneEnum lane, const ControlSettingsStruct& settings, const ControlOutputStruct& command );	// Any one thread, see ControlLoopClass
+	void								  Receive();																								// Main loop only
+
+	// Packet framing, no port needed
+	static size_t EncodePacket( const PacketStruct& packet, uint8_t* buffer );
 
 
 
@@ -47,22 +80,33 @@ private:
 	void InitializePort1();
 
 	// Port Variables
-	int			   SerialOut;
-	int			   SerialIn;
+	int			   SerialOut = -1;
+	int			   SerialIn	 = -1;
 	struct termios tty0;
 	struct termios tty1;
 	int8_t		   nPortsOpen = 1;
 
+	// Last sent packet, only formatted for the display on the main loop
+	TripleBuffer<PacketStruct> sentPackets;
+	std::atomic<bool>		   isSendFailed  = { false };
+	uint8_t					   packetCounter = 0;	 // Sending thread only
+
+	// Reader thread
+	std::thread								  receiveThread;
+	std::atomic<bool>						  isReceiveRunning = { false };
+	int										  wakeFd		   = -1;	// Wakes the reader for shutdown
+	PacketFramerClass						  framer;					// Reader thread only
+	SpscQueue<ReceivedPacketStruct, 256>	  receivedPackets;
+	TripleBuffer<SerialCountersStruct>		  receiveCounters;
+	std::chrono::steady_clock::time_point	  timeReceivedLast;			// Main loop only
+
 	// Serial functions
-	void SendPacketToTeensy();
-	// void ReadPacketFromTeensy();
-	bool ReadTeensyPacket( PacketStruct& outPacket );
-	void ParsePacketFromTeensy( PacketStruct pkt );				// Parse packet from teensy and save data
-	void ConvertPacketToSerialString( PacketStruct packet );	// Convert packet to string for debugging
-	void PrintByte( std::vector<uint8_t> pktBytes );			// Print contents of a byte vector
-	void StringOutput( const uint8_t* buff );
-
-	float elapsedTimeNow = 0.0f; 
-	float elapsedTimeLast = 0.0f; 
+	std::chrono::steady_clock::time_point SendPacketToTeensy( traceLaneEnum lane, const ControlSettingsStruct& settings, const ControlOutputStruct& command );
+	void								  ReceiveLoop();
+	void								  ParsePacketFromTeensy( PacketStruct pkt );							  // Parse packet from teensy and save data
+	PacketStruct						  AppendTelemetryFromTeensy( const TelemetryPacketStruct& telemetry );	  // Store a batch in the history, newest sample as a packet
+	void								  ConvertPacketToSerialString( PacketStruct packet );					  // Convert packet to string for debugging
+	void								  PrintByte( std::vector<uint8_t> pktBytes );							  // Print contents of a byte vector
+	void								  StringOutput( const uint8_t* buff );
 
 };
\ No newline at end of file
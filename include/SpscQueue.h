@@ -0,0 +1,60 @@
+#pragma once
+
+// Standard libraries
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+
+
+/**
+ * @brief Lock-free single-producer / single-consumer queue of fixed capacity
+ *
+ * Unlike TripleBuffer, every pushed value is delivered once and in order until the queue is full.
+ * Head and tail run freely and are masked into the ring, so the capacity has to be a power of two.
+ * Each side only writes its own index, on its own cache line.
+ */
+template <typename T, size_t N>
+class SpscQueue {
+
+	static_assert( N >= 2 && ( N & ( N - 1 ) ) == 0, "Capacity must be a power of two" );
+
+public:
+	/**
+	 * @brief Producer side, copy a value in
+	 *
+	 * @return false if the queue is full, the value is not stored
+	 */
+	bool Push( const T& value ) {
+		size_t tailNow = tail.load( std::memory_order_relaxed );
+		if ( tailNow - head.load( std::memory_order_acquire ) == N ) {
+			return false;
+		}
+		slots[tailNow & ( N - 1 )] = value;
+		tail.store( tailNow + 1, std::memory_order_release );
+		return true;
+	}
+
+	/**
+	 * @brief Consumer side, take the oldest value out
+	 *
+	 * @return false if the queue is empty
+	 */
+	bool Pop( T& value ) {
+		size_t headNow = head.load( std::memory_order_relaxed );
+		if ( headNow == tail.load( std::memory_order_acquire ) ) {
+			return false;
+		}
+		value = slots[headNow & ( N - 1 )];
+		head.store( headNow + 1, std::memory_order_release );
+		return true;
+	}
+
+private:
+	// Storage
+	std::array<T, N> slots;
+
+	// Ring positions
+	alignas( 64 ) std::atomic<size_t> head = { 0 };	   // Consumer only
+	alignas( 64 ) std::atomic<size_t> tail = { 0 };	   // Producer only
+};
@@ -1,6 +1,9 @@
 #pragma once
 
 // Necessary libraries
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <iomanip>
 #include <iostream>
 #include <memory>
@@ -10,14 +13,18 @@
 #include <ArucoClass.h>
 #include <opencv2/aruco.hpp>
 #include <opencv2/core.hpp>
-#include <opencv2/cudaimgproc.hpp>
+#include <opencv2/imgproc.hpp>
 
 // Runtime configuration
 #include "config.h"
 
 // Packet
+#include "PacketFramerClass.h"
 #include "PacketTypes.h"
 
+// Control stamps from the control thread
+#include "SpscQueue.h"
+
 // Constants
 #define RAD2DEG 57.2958
 #define DEG2RAD 0.01745
@@ -29,6 +36,12 @@ enum class stateEnum { IDLE, DRIVING_PWM, MEASURING_LIMITS, ZERO_ENCODER };
 enum class selectTorqueTargetEnum { NONE, ABD, ADD, FLEX, EXT };
 enum class taskEnum { IDLE, CALIBRATE, FITTS, LIMIT };
 enum class selectLimitEnum { NONE, AMP_A, AMP_B, AMP_C };
+enum class captureBackendEnum { CPU, GPU };
+enum class detectionSpaceEnum { UNDISTORTED_FRAME, RAW_CORNERS };
+enum class loopStageEnum : uint8_t { INPUT, CAPTURE, TASK, DETECT, SYSTEM, CONTROL, TOUCH, SERIAL, DISPLAY, COUNT };
+inline constexpr const char* loopStageNames[] = { "Input", "Capture", "Task", "Detect", "System", "Control", "Touch", "Serial", "Display" };
+enum class traceLaneEnum : uint8_t { MAIN, CAPTURE, CONTROL, SERIAL, COUNT };
+enum class traceEventEnum : uint8_t { INPUT, CAPTURE, TASK, DETECT, SYSTEM, CONTROL, TOUCH, SERIAL, DISPLAY, KALMAN, SERIAL_WRITE, SERIAL_READ, FRAME_READ, FRAME_PROCESS, CONTROL_TICK, COUNT };	// Starts with the loop stages
 
 enum class selectSystemEnum { NONE, GAIN_PROPORTIONAL, GAIN_INTEGRAL, GAIN_DERIVATIVE, AMP_TENSION, AMP_LIMIT };
 enum class selectSubsystemEnum { NONE, ALL, ABD, ADD, EXT, FLEX, AMP_A, AMP_B, AMP_C };
@@ -91,9 +104,30 @@ struct AmplifierStruct {
 	cv::Point3f commandedLimits = cv::Point3f( 0.10f, 0.10f, 0.10f );
 };
 
+struct AmplifierHistoryStruct {
+	std::array<TelemetrySampleStruct, CONFIG_AMPLIFIER_HISTORY_SIZE> samples {};			// Ring, the newest at ( nSamples - 1 ) % size
+	uint64_t														 nSamples		 = 0;	// Samples appended since start
+	uint64_t														 nSamplesLost	 = 0;	// Gaps in the Teensy sample index
+	uint16_t														 sampleIndexNext = 0;	// Teensy sample index expected next
+};
+
 struct ArUcoStruct {
 
 	// bool isArUcoTagFound = false;
+
+	// Region-of-interest tracking
+	bool	 isTrackingEnabled = CONFIG_ARUCO_TRACKING;	   // Allow searching around the last corners
+	bool	 isTracking		   = false;					   // This frame was searched in a window
+	uint8_t	 trackingMisses	   = 0;						   // Consecutive windows without the active tag
+	cv::Rect searchRegionPX;							   // Area searched this frame, detection space
+
+	// Coarse-to-fine full-frame search
+	uint8_t pyramidLevel = CONFIG_ARUCO_PYRAMID_LEVEL;	  // Candidates found at 1/2^n scale, 0 = full resolution
+
+	// Pose stage
+	bool  isPoseWarmStart = CONFIG_ARUCO_WARM_START;	// Refine from the previous pose
+	float poseTimeMS	  = 0.0f;						// [ms] Cost of the last pose estimate
+	float reprojectionPX  = 0.0f;						// [px] RMS corner reprojection error of the active tag
 };
 
 struct RunningLogStruct {
@@ -104,17 +138,26 @@ struct RunningLogStruct {
 };
 
 struct CaptureStruct {
-	bool	rotateCamera = false;
-	bool	isFrameReady = false;
-	cv::Mat frameRaw	 = cv::Mat( CONFIG_CAM_HEIGHT, CONFIG_CAM_WIDTH, CV_8UC3 );
-	cv::Mat frameGray	 = cv::Mat( CONFIG_CAM_HEIGHT, CONFIG_CAM_WIDTH, CV_8UC3 );
-
-	// OpenCV GPU matrices
-	cv::cuda::GpuMat GpuMatFrameRaw			= cv::cuda::GpuMat( CONFIG_CAM_HEIGHT, CONFIG_CAM_WIDTH, CV_8UC3 );
-	cv::cuda::GpuMat GpuMatFrameGray		= cv::cuda::GpuMat( CONFIG_CAM_HEIGHT, CONFIG_CAM_WIDTH, CV_8UC1 );
-	cv::cuda::GpuMat GpuMatFrameUndistorted = cv::cuda::GpuMat( CONFIG_CAM_HEIGHT, CONFIG_CAM_WIDTH, CV_8UC1 );
-	cv::cuda::GpuMat GpuMatRemap1;
-	cv::cuda::GpuMat GpuMatRemap2;
+	std::atomic<bool>					  rotateCamera = { false };	   // Read by the capture thread
+	bool								  isFrameReady = false;		   // A new frame was taken this iteration
+	std::chrono::steady_clock::time_point timeGrabbed;				   // Grab time of the current frame, for latency
+	std::chrono::steady_clock::time_point timeSource;				   // Recorded time of the current frame, for filter and tracking steps
+	uint64_t							  frameNumber = 0;			   // Running frame counter of the current frame
+	cv::Mat								  frameRaw	  = cv::Mat( CONFIG_CAM_HEIGHT, CONFIG_CAM_WIDTH, CV_8UC3 );
+	cv::Mat								  frameGray	  = cv::Mat( CONFIG_CAM_HEIGHT, CONFIG_CAM_WIDTH, CV_8UC1 );
+
+	// Preprocessing backend
+	std::atomic<captureBackendEnum> backend		   = { captureBackendEnum::CPU };	 // Read by the capture thread
+	bool							isGpuAvailable = false;							 // CUDA device found at startup
+	std::atomic<bool>				isColorRequested = { false };					 // Produce the color image, set by DisplayClass while it shows one
+
+	// Frame source
+	std::string		  sourceName	   = "";			 // Description of the active frame source
+	std::atomic<bool> isSourceFinished = { false };	 // Replay has run out of frames
+
+	// Detection space
+	std::atomic<detectionSpaceEnum> detectionSpace = { detectionSpaceEnum::UNDISTORTED_FRAME };	   // Read by the capture thread
+	bool							isGrayRaw	   = false;										   // Current frameGray is in raw camera space
 
 	// OpenCV image matrices
 	cv::Mat matFrameUndistorted = cv::Mat( CONFIG_CAM_HEIGHT, CONFIG_CAM_WIDTH, CV_8UC3 );
@@ -151,16 +194,18 @@ struct ControllerStruct {
 	cv::Point3f commandedCurrentABC	   = cv::Point3f( 0.0f, 0.0f, 0.0f );	 // Commanded current output
 	cv::Point3f commandedTensionABC	   = cv::Point3f( 0.0f, 0.0f, 0.0f );	 // Commanded tension
 	cv::Point3f torqueABC			   = cv::Point3f( 0.0f, 0.0f, 0.0f );	 // Commanded torque
-	float		rampPercentage		   = 0.00f;								 // Counter
-	float		rampStartTime		   = 0.0f;								 // [s]
+	float		rampPercentage		   = 0.00f;								 // Counter, as of the last control tick
+	uint32_t	nRampRequests		   = 0;									 // Bump to restart the ramp, the controller picks it up at its next tick
 	float		rampDurationTime	   = 1.0f;								 // [s]
-	bool		isRampingUp			   = false;								 // Is the motor ramping up?
+	float		integralDecay		   = 0.9f;								 // Integral kept per frame without a target, 0.9 = slow, 0.0 = instant
+	bool		isRampingUp			   = false;								 // Is the motor ramping up? As of the last control tick
 	bool		isLimitSet			   = false;								 // Are the motor limits set?
 	int			integrationRadius	   = 100;
 	cv::Point3f percentageProportional = cv::Point3f( 0.0f, 0.0f, 0.0f );
 	cv::Point3f percentageIntegral	   = cv::Point3f( 0.0f, 0.0f, 0.0f );
 	cv::Point3f percentageDerivative   = cv::Point3f( 0.0f, 0.0f, 0.0f );
 	bool		toggleReverse		   = false;
+	bool		isPredictionEnabled	   = CONFIG_PREDICTION_ENABLED;	   // Act on the predicted instead of the filtered position
 };
 
 struct DisplayStruct {
@@ -187,6 +232,32 @@ struct KalmanFilterStruct {
 	cv::Mat pMatrix;
 };
 
+struct ControlStampStruct {
+	std::chrono::steady_clock::time_point timeCaptured;		 // Grab time of the frame the tick acted on
+	std::chrono::steady_clock::time_point timeControlled;	 // Controller update done
+	std::chrono::steady_clock::time_point timeSent;			 // Packet written to the serial port, default if nothing went out
+};
+
+struct LatencyStruct {
+
+	// Stage stamps, written as each stage finishes with the current frame
+	std::chrono::steady_clock::time_point timeDetected;	   // FindTags() done
+	std::chrono::steady_clock::time_point timeFiltered;	   // Kalman update done
+
+	// First control tick on each frame, pushed by whichever thread runs the controller
+	SpscQueue<ControlStampStruct, 64> controlStamps;
+
+	// Display summary [ms]
+	float	 totalP50MS	  = 0.0f;	 // Glass-to-motor
+	float	 totalP95MS	  = 0.0f;
+	float	 totalMaxMS	  = 0.0f;
+	float	 detectP50MS  = 0.0f;	 // Capture to detection
+	float	 filterP50MS  = 0.0f;	 // Detection to filter
+	float	 controlP50MS = 0.0f;	 // Filter to controller
+	float	 sendP50MS	  = 0.0f;	 // Controller to serial write
+	uint64_t nFrames	  = 0;		 // Frames traced end to end
+};
+
 struct LoggingStruct {
 
 	// Flags
@@ -223,9 +294,10 @@ struct LoggingStruct {
 struct SystemStruct {
 
 	// Flags
-	bool isMainRunning	= true;		// Global flag to shut-down safely
-	bool isShuttingDown = false;	// Trigger safe shutdown
+	bool isMainRunning	= true;				  // Global flag to shut-down safely
+	bool isShuttingDown = false;			  // Trigger safe shutdown
 	bool useRing		= true;
+	bool isHeadless		= CONFIG_HEADLESS;	  // No HighGUI windows, input from a script
 
 	// State enum
 	stateEnum state = stateEnum::IDLE;
@@ -241,6 +313,9 @@ struct SerialStruct {
 
 	int8_t packetDelay = 0;
 
+	// Reader thread statistics, refreshed by Receive()
+	SerialCountersStruct counters;
+
 	// Plaintext packet
 	std::string packetOut = "";
 	std::string packetIn  = "";
@@ -259,6 +334,18 @@ struct TaskStruct {
 };
 
 
+/**
+ * @brief Kalman bank slot of a marker ID, -1 for markers without a filter
+ */
+inline int MarkerBankSlot( int id ) {
+	for ( size_t s = 0; s < CONFIG_MARKER_BANK_SIZE; s++ ) {
+		if ( CONFIG_MARKER_BANK_IDS[s] == id ) {
+			return int( s );
+		}
+	}
+	return -1;
+}
+
 struct TargetTelemetryStruct {
 	int						 activeID			   = 1;	   // ID of target currently being tracked
 	bool					 isTargetReset		   = false;
@@ -275,6 +362,16 @@ struct TargetTelemetryStruct {
 	cv::Point3f				 positionIntegratedMM  = cv::Point3f( 0.0f, 0.0f, 0.0f );															// Integrated position
 	cv::Point3f				 offsetMm			   = cv::Point3f( 0, -CONFIG_TARGET_OFFSET_Y_MM, 0 );											// Offset
 	float					 rotationDEG		   = 0.0f;																						// Target angle
+
+	// Filtered state propagated to the expected actuation time
+	cv::Point3f positionPredictedMM = cv::Point3f( 0.0f, 0.0f, 0.0f );	   // [mm] What the controller acts on
+	float		predictionHorizonMS = 0.0f;								   // [ms] Frame capture to actuation
+
+	// Every bank marker seen in the current frame, the active one included
+	std::array<bool, CONFIG_MARKER_BANK_SIZE>		 isMarkerFound {};		  // Seen this frame
+	std::array<cv::Point3f, CONFIG_MARKER_BANK_SIZE> markerPositionsMM {};	  // [mm] Raw position, same frame as positionUnfilteredMM
+	std::array<cv::Point3f, CONFIG_MARKER_BANK_SIZE> markerVarianceMM2 {};	  // [mm^2] Measurement noise per axis from detection quality
+	uint32_t										 nMeasurementsGated = 0;	  // Measurements the filter rejected as outliers
 };
 
 struct RingTelemetryStruct {
@@ -293,11 +390,50 @@ struct RingTelemetryStruct {
 };
 
 
+struct StageStatsStruct {
+	float p50MS = 0.0f;
+	float p95MS = 0.0f;
+	float p99MS = 0.0f;
+	float maxMS = 0.0f;
+};
+
 struct TimingStruct {
 
 	short measuredFrequency	 = 45;		// Default timing frequency
 	float elapsedRunningTime = 0.0f;	// Elapsed time in seconds
 	float timestepDT		 = 0.0f;
+
+	// Loop profiler, rolling window refreshed once per second
+	std::array<StageStatsStruct, size_t( loopStageEnum::COUNT )> stages;
+	uint32_t													 stagesRevision	 = 0;		 // Incremented on every refresh
+	bool														 isProfilerShown = false;	 // Profiler window open
+
+	// Loop deadline, statistics over the last second
+	float		  loopPeriodMS	   = 0.0f;					   // [ms] Mean period
+	float		  loopJitterMS	   = 0.0f;					   // [ms] Standard deviation of the period
+	float		  loopPeriodMaxMS  = 0.0f;					   // [ms] Longest period
+	uint32_t	  nOverruns		   = 0;						   // Periods over the deadline since startup
+	uint32_t	  nOverrunsTask	   = 0;						   // Periods over the deadline in the current task
+	loopStageEnum lastOverrunStage = loopStageEnum::COUNT;	   // Longest stage of the last late iteration, COUNT if none yet
+};
+
+struct TraceEventStruct {
+	int64_t		   beginNS = 0;	   // steady_clock
+	int64_t		   endNS   = 0;
+	traceEventEnum event   = traceEventEnum::INPUT;
+};
+
+struct TraceLaneStruct {
+	std::unique_ptr<TraceEventStruct[]> events;				// CONFIG_TRACE_EVENTS slots, allocated when recording first starts
+	std::atomic<uint32_t>				nWritten = { 0 };	// Published by the single writing thread
+	uint32_t							nStarted = 0;		// nWritten when the current recording started
+};
+
+struct TraceStruct {
+
+	std::atomic<bool>											isRecording		  = { false };
+	bool														isToggleRequested = false;	  // Start, or stop and write the file
+	std::array<TraceLaneStruct, size_t( traceLaneEnum::COUNT )> lanes;
 };
 
 struct TouchscreenStruct {
@@ -316,22 +452,25 @@ struct VibrationStruct {
 struct ManagedData {
 
 	// Structs
-	AmplifierStruct		  Amplifier;
-	ArUcoStruct			  Aruco;
-	CalibrationStruct	  Calibration;	  // Logging variables
-	CaptureStruct		  Capture;
-	ControllerStruct	  Controller;
-	DisplayStruct		  Display;
-	InputStruct			  Input;
-	KalmanFilterStruct	  KalmanFilter;
-	LoggingStruct		  Logging;
-	SystemStruct		  System;
-	SerialStruct		  Serial;
-	TargetTelemetryStruct Target;
-	TaskStruct			  Task;
-	TimingStruct		  Timing;
-	TouchscreenStruct	  Touchscreen;
-	VibrationStruct		  Vibration;
+	AmplifierStruct		   Amplifier;
+	AmplifierHistoryStruct AmplifierHistory;
+	ArUcoStruct			   Aruco;
+	CalibrationStruct	   Calibration;	  // Logging variables
+	CaptureStruct		   Capture;
+	ControllerStruct	   Controller;
+	DisplayStruct		   Display;
+	InputStruct			   Input;
+	KalmanFilterStruct	   KalmanFilter;
+	LatencyStruct		   Latency;
+	LoggingStruct		   Logging;
+	SystemStruct		   System;
+	SerialStruct		   Serial;
+	TargetTelemetryStruct  Target;
+	TaskStruct			   Task;
+	TimingStruct		   Timing;
+	TouchscreenStruct	   Touchscreen;
+	TraceStruct			   Trace;
+	VibrationStruct		   Vibration;
 
 	// Helper functions
 	float		GetNorm2D( cv::Point2f pt1 );													// Calculate magnitude of 2D vector
@@ -91,6 +91,7 @@ private:
 
 	// General
 	void InitializeInterface( taskEnum task );
+	void ShowInterface();
 
 
 
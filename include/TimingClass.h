@@ -7,10 +7,22 @@
 #include <memory>
 #include <sstream>
 
+// Loop profiler
+#include <array>
+#include <atomic>
+#include <vector>
+
+// Configuration
+#include <config.h>
+
+// Session distributions
+#include "HistogramClass.h"
+
 
 // Forward declarations
 class SystemDataManager;
 struct ManagedData;
+enum class loopStageEnum : uint8_t;
 
 
 
@@ -30,12 +42,17 @@ public:
 	void		UpdateFullDateAndTime();
 	void		UpdateTaskTime();
 	std::string GetFullDateAndTime( bool echo );
+	float		GetRunningTime( std::chrono::steady_clock::time_point time ) const;
 
 	// Task timers
 	void  TaskTimerStart();
 	void  TaskTimerStop();
 	float TaskTimerGetElapsedSeconds();
 
+	// Loop profiler
+	void RecordStage( loopStageEnum stage, std::chrono::steady_clock::time_point timeStart );
+	void DumpProfile( const std::string& timestamp );
+
 
 
 private:
@@ -60,4 +77,56 @@ private:
 	std::chrono::steady_clock::time_point taskTimeEnd;
 	std::chrono::duration<double>		  taskTimeElapsed;
 	bool								  TASK_TIMER_STARTED = false;
+
+	// Stage samples, written by the thread running the stage and read back once per second
+	struct StageRingStruct {
+		std::array<std::atomic<float>, CONFIG_PROFILER_WINDOW> samplesMS;
+		std::atomic<uint32_t>								   nWritten = { 0 };
+		HistogramClass										   session	= HistogramClass( 0.01, 10000 );	// Whole run, for the exit report
+		float												   iterationMS = 0.0f;							// Main loop only, time spent this iteration
+		uint32_t											   nOverruns   = 0;								// Late iterations where this stage took longest
+	};
+	std::unique_ptr<StageRingStruct[]> stageRings;
+	std::vector<float>				   stageScratch;	// Sort buffer for the percentiles
+
+	// Loop deadline
+	std::chrono::steady_clock::time_point previousLoopTime;
+	bool								  isLoopTimed	 = false;
+	bool								  wasTaskRunning = false;
+	double								  periodSumMS	 = 0.0;
+	double								  periodSumSqMS	 = 0.0;
+	float								  periodMaxMS	 = 0.0f;
+	uint32_t							  nPeriods		 = 0;
+	HistogramClass						  periodHistogram;	  // Whole run, for the exit report
+
+	// Private functions
+	void UpdateProfile();
+	void UpdateDeadline( float periodMS );
+	void UpdateLoopStatistics();
+};
+
+
+
+/**
+ * @brief Times the enclosing scope as one loop stage
+ *
+ * Construct at the top of a block, the stage is recorded when the block is left.
+ */
+class StageTimer {
+
+public:
+	StageTimer( TimingClass& timing, loopStageEnum stage )
+		: timing( timing )
+		, stage( stage )
+		, timeStart( std::chrono::steady_clock::now() ) { }
+
+	~StageTimer() { timing.RecordStage( stage, timeStart ); }
+
+	StageTimer( const StageTimer& )			   = delete;
+	StageTimer& operator=( const StageTimer& ) = delete;
+
+private:
+	TimingClass&						  timing;
+	loopStageEnum						  stage;
+	std::chrono::steady_clock::time_point timeStart;
 };
\ No newline at end of file
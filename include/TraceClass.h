@@ -0,0 +1,83 @@
+#pragma once
+
+// Memory for shared data
+#include <memory>
+
+// Event timestamps
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+
+
+// Forward declarations
+class SystemDataManager;
+class TimingClass;
+struct ManagedData;
+struct TraceStruct;
+enum class traceLaneEnum : uint8_t;
+enum class traceEventEnum : uint8_t;
+
+
+/**
+ * @brief Records pipeline stages as Chrome trace events for Perfetto / chrome://tracing
+ *
+ * Every thread writes complete events (begin and end time) into its own preallocated ring in
+ * shared->Trace. Recording only stores two timestamps and an event id, names and JSON are produced
+ * when the trace is written, so it can stay on during real sessions. Written on stop, requested
+ * from the keyboard, and at shutdown.
+ */
+class TraceClass {
+
+public:
+	// Data manager handle
+	TraceClass( SystemDataManager& dataHandle, TimingClass& timing );
+
+	// Public functions
+	void Initialize();
+	void Update();
+	void Close();
+
+	// Hot path, any thread that owns the lane
+	static void Record( TraceStruct& trace, traceLaneEnum lane, traceEventEnum event, std::chrono::steady_clock::time_point timeBegin, std::chrono::steady_clock::time_point timeEnd );
+
+private:
+	// Data manager handle
+	SystemDataManager&			 dataHandle;
+	std::shared_ptr<ManagedData> shared;
+	TimingClass&				 Timing;
+
+	// Private variables
+	std::chrono::steady_clock::time_point timeStarted;
+
+	// Private functions
+	void Start();
+	void Stop();
+	void Write( const std::string& timestamp );
+};
+
+
+
+/**
+ * @brief Records the enclosing scope as one trace event
+ */
+class TraceScope {
+
+public:
+	TraceScope( TraceStruct& trace, traceLaneEnum lane, traceEventEnum event )
+		: trace( trace )
+		, lane( lane )
+		, event( event )
+		, timeBegin( std::chrono::steady_clock::now() ) { }
+
+	~TraceScope() { TraceClass::Record( trace, lane, event, timeBegin, std::chrono::steady_clock::now() ); }
+
+	TraceScope( const TraceScope& )			   = delete;
+	TraceScope& operator=( const TraceScope& ) = delete;
+
+private:
+	TraceStruct&						  trace;
+	traceLaneEnum						  lane;
+	traceEventEnum						  event;
+	std::chrono::steady_clock::time_point timeBegin;
+};
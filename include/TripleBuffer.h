@@ -0,0 +1,75 @@
+#pragma once
+
+// Standard libraries
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+
+
+/**
+ * @brief Lock-free single-producer / single-consumer triple buffer
+ *
+ * The producer always owns one slot to write into, the consumer always owns one slot to read
+ * from, and the third slot sits in the middle holding the most recently published value. Neither
+ * side ever waits: publishing swaps the write slot with the middle slot, and acquiring swaps the
+ * read slot with the middle slot only when something new has been published since the last call.
+ *
+ * A slot handed out by ReadBuffer() stays untouched by the producer until the next successful
+ * Acquire(), so anything borrowed from it (e.g. cv::Mat headers) is valid until then.
+ */
+template <typename T>
+class TripleBuffer {
+
+public:
+	/**
+	 * @brief Slot currently owned by the producer
+	 */
+	T& WriteBuffer() { return buffers[writeIndex]; }
+
+	/**
+	 * @brief Publish the write slot as the newest value and take back the stale middle slot
+	 */
+	void Publish() {
+		uint8_t previous = middleIndex.exchange( uint8_t( writeIndex | FRESH_BIT ), std::memory_order_acq_rel );
+		writeIndex		 = previous & INDEX_MASK;
+	}
+
+	/**
+	 * @brief Swap in the newest published value if there is one
+	 *
+	 * @return true if ReadBuffer() now refers to a value not seen before
+	 */
+	bool Acquire() {
+		if ( !( middleIndex.load( std::memory_order_acquire ) & FRESH_BIT ) ) {
+			return false;
+		}
+
+		uint8_t previous = middleIndex.exchange( readIndex, std::memory_order_acq_rel );
+		readIndex		 = previous & INDEX_MASK;
+		return true;
+	}
+
+	/**
+	 * @brief Slot currently owned by the consumer
+	 */
+	T& ReadBuffer() { return buffers[readIndex]; }
+
+	/**
+	 * @brief Direct access to all slots, only safe before the producer starts
+	 */
+	std::array<T, 3>& Slots() { return buffers; }
+
+private:
+	// Middle index carries a flag marking whether it holds an unread value
+	static constexpr uint8_t FRESH_BIT	= 0x04;
+	static constexpr uint8_t INDEX_MASK = 0x03;
+
+	// Storage
+	std::array<T, 3> buffers;
+
+	// Slot ownership
+	uint8_t				 writeIndex	 = 0;	 // Producer only
+	std::atomic<uint8_t> middleIndex = { 1 };
+	uint8_t				 readIndex	 = 2;	 // Consumer only
+};
@@ -0,0 +1,82 @@
+#pragma once
+
+// Memory for shared data
+#include <memory>
+
+// OpenCV core functions
+#include <opencv2/calib3d.hpp>
+#include <opencv2/core.hpp>
+#include <opencv2/core/hal/intrin.hpp>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/opencv_modules.hpp>
+
+// CUDA modules are optional, the CPU backend is always available
+#if defined( HAVE_OPENCV_CUDAWARPING ) && defined( HAVE_OPENCV_CUDAIMGPROC )
+#define UNDISTORT_HAS_CUDA 1
+#include <opencv2/cudaimgproc.hpp>
+#include <opencv2/cudawarping.hpp>
+#else
+#define UNDISTORT_HAS_CUDA 0
+#endif
+
+
+
+// Forward declarations
+class SystemDataManager;
+struct ManagedData;
+
+
+/**
+ * @brief Undistort and grayscale conversion for captured frames
+ *
+ * Owns the remap tables and the per-backend working buffers. Runs on the capture thread, so the
+ * only shared state it reads per frame are the atomic backend and rotation flags.
+ *
+ * The CPU backend builds the detection image in a single pass per pixel: a nearest-neighbour
+ * gather through a precomputed offset table (with the 180 degree rotation already folded in),
+ * fixed-point BGR to gray, and a contrast LUT. The color image is a separate remap that only
+ * runs when the caller asks for it.
+ *
+ * ProcessRaw() serves the corner-space detection mode: the detection image stays in raw camera
+ * space and only the marker corners are undistorted later, in ArucoClass.
+ */
+class UndistortClass {
+
+public:
+	// Data manager handle
+	UndistortClass( SystemDataManager& dataHandle );
+
+	// Public functions
+	void Process( const cv::Mat& frameRaw, cv::Mat& frameUndistorted, cv::Mat& frameGray, bool isColorRequired );
+	void ProcessCPU( const cv::Mat& frameRaw, cv::Mat& frameUndistorted, cv::Mat& frameGray, bool isColorRequired );
+	void ProcessGPU( const cv::Mat& frameRaw, cv::Mat& frameUndistorted, cv::Mat& frameGray, bool isColorRequired );
+	void ProcessRaw( const cv::Mat& frameRaw, cv::Mat& frameUndistorted, cv::Mat& frameGray, bool isColorRequired );
+
+private:
+	// Data manager handle
+	SystemDataManager&			 dataHandle;
+	std::shared_ptr<ManagedData> shared;
+
+	// Fixed-point remap tables for the CPU backend, upright and rotated 180 degrees
+	cv::Mat matRemapFixedXY;			   // CV_16SC2 integer source coordinates
+	cv::Mat matRemapFixedXYRotated;		   // CV_16SC2 integer source coordinates
+	cv::Mat matRemapOffset;				   // CV_32SC1 byte offset of the source pixel
+	cv::Mat matRemapOffsetRotated;		   // CV_32SC1 byte offset of the source pixel
+	cv::Mat lutContrast;				   // 256 entry alpha / beta adjustment
+
+	// GPU working buffers, only allocated when a CUDA device is present
+#if UNDISTORT_HAS_CUDA
+	cv::cuda::GpuMat GpuMatFrameRaw;
+	cv::cuda::GpuMat GpuMatFrameUndistorted;
+	cv::cuda::GpuMat GpuMatFrameGray;
+	cv::cuda::GpuMat GpuMatRemap1;
+	cv::cuda::GpuMat GpuMatRemap2;
+	cv::cuda::GpuMat GpuMatRemap1Rotated;
+	cv::cuda::GpuMat GpuMatRemap2Rotated;
+#endif
+
+	// Private functions
+	void Initialize();
+	void BuildOffsetTable( const cv::Mat& mapFixed, cv::Mat& mapOffset );
+	void RemapGrayRow( const uchar* source, const int* offsets, uchar* destination, int width );
+};
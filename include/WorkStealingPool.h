@@ -0,0 +1,115 @@
+#pragma once
+
+// Standard libraries
+#include <algorithm>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+
+/**
+ * @brief Runs a batch of independent tasks on every core, idle workers steal from busy ones
+ *
+ * Task indices start split evenly, one contiguous range per worker. A worker takes tasks from
+ * the front of its own range. Once that is empty, it takes the back half of the first non-empty
+ * range it finds. Tasks that take very different times (short and long simulated runs) keep
+ * every core busy until the batch is done, with one uncontended lock per task.
+ */
+class WorkStealingPool {
+
+public:
+	WorkStealingPool( size_t nWorkers = std::max( 1u, std::thread::hardware_concurrency() ) )
+		: ranges( nWorkers ) { }
+
+	/**
+	 * @brief Number of workers, body() sees worker ids below this
+	 */
+	size_t Workers() const { return ranges.size(); }
+
+	/**
+	 * @brief Run body( task, worker ) for every task in [0, nTasks) and wait for all of them
+	 *
+	 * A worker only runs one task at a time, so per-worker state indexed by the worker id needs
+	 * no locking.
+	 */
+	template <typename Function>
+	void Run( size_t nTasks, Function&& body ) {
+
+		// Even split
+		const size_t nWorkers = ranges.size();
+		for ( size_t w = 0; w < nWorkers; w++ ) {
+			ranges[w].begin = nTasks * w / nWorkers;
+			ranges[w].end	= nTasks * ( w + 1 ) / nWorkers;
+		}
+
+		std::vector<std::thread> workers;
+		for ( size_t w = 0; w < nWorkers; w++ ) {
+			workers.emplace_back( [this, w, &body]() {
+				size_t task = 0;
+				while ( Pop( w, task ) || ( Steal( w ) && Pop( w, task ) ) ) {
+					body( task, w );
+				}
+			} );
+		}
+		for ( std::thread& worker : workers ) {
+			worker.join();
+		}
+	}
+
+private:
+	// Tasks still owned by one worker, on their own cache line
+	struct alignas( 64 ) RangeStruct {
+		std::mutex lock;
+		size_t	   begin = 0;
+		size_t	   end	 = 0;
+	};
+
+	std::vector<RangeStruct> ranges;
+
+	/**
+	 * @brief Take the next task from the worker's own range
+	 */
+	bool Pop( size_t worker, size_t& task ) {
+
+		std::lock_guard<std::mutex> guard( ranges[worker].lock );
+		if ( ranges[worker].begin == ranges[worker].end ) {
+			return false;
+		}
+		task = ranges[worker].begin++;
+		return true;
+	}
+
+	/**
+	 * @brief Move the back half of another worker's range into the thief's empty range
+	 *
+	 * Only one lock is held at a time. Nothing is ever added to a batch, so a full pass that finds
+	 * every range empty means the batch is done, apart from tasks already being run.
+	 */
+	bool Steal( size_t thief ) {
+
+		const size_t nWorkers = ranges.size();
+		for ( size_t offset = 1; offset < nWorkers; offset++ ) {
+
+			RangeStruct& victim = ranges[( thief + offset ) % nWorkers];
+			size_t		 begin	= 0;
+			size_t		 end	= 0;
+			{
+				std::lock_guard<std::mutex> guard( victim.lock );
+				if ( victim.begin == victim.end ) {
+					continue;
+				}
+				begin		= victim.begin + ( victim.end - victim.begin ) / 2;
+				end			= victim.end;
+				victim.end	= begin;
+			}
+
+			std::lock_guard<std::mutex> guard( ranges[thief].lock );
+			ranges[thief].begin = begin;
+			ranges[thief].end	= end;
+			return true;
+		}
+		return false;
+	}
+};
@@ -118,6 +118,28 @@ inline constexpr float CONFIG_DEVICE_NOMINAL_TORQUE	 = 28.6;	 // Nominal torque
 inline std::string CONFIG_SERIAL_PORT_0 = "/dev/ttyACM0";
 // inline std::string CONFIG_SERIAL_PORT_0 = "/dev/pts/10";
 inline std::string CONFIG_SERIAL_PORT_1 = "/dev/ttyACM1";
+inline constexpr uint32_t CONFIG_AMPLIFIER_HISTORY_SIZE = 4096;	 // Teensy drive tick samples kept, about 4 s at 1 kHz
+
+// Frame source
+inline std::string CONFIG_CAPTURE_DEVICE			= "/dev/video0";	// Live camera
+inline std::string CONFIG_CAPTURE_REPLAY_PATH		= "";				// Video file or image directory to replay instead of the camera
+inline bool		   CONFIG_CAPTURE_REPLAY_REAL_TIME = true;			// Pace replay at recorded timing, otherwise as fast as possible
+inline bool		   CONFIG_CAPTURE_REPLAY_LOOP		= false;			// Restart replay at the end
+
+// Run mode
+inline bool		   CONFIG_HEADLESS		 = false;	  // No windows or key polling, input comes from the script
+inline std::string CONFIG_HEADLESS_SCRIPT = "";	  // Timed key / touch script for headless runs
+inline std::string CONFIG_GAINS_PATH	   = "";	  // Controller gains loaded at startup, e.g. from NURingGainSweep
+
+// Diagnostics output
+inline std::string				CONFIG_LOGGING_PATH	   = "/home/tom/Code/nuring/logging/";	// Latency, timing and trace reports
+inline constexpr unsigned short CONFIG_PROFILER_WINDOW = 512;								// Loop iterations kept for the rolling stage percentiles
+inline constexpr bool			CONFIG_TRACE_ENABLED   = false;								// Record trace events from startup
+inline constexpr uint32_t		CONFIG_TRACE_EVENTS	   = 1 << 19;								// Ring slots per thread, the newest events are kept
+
+// Loop deadline
+inline constexpr float CONFIG_LOOP_DEADLINE_MS	  = 1000.0f / 90.0f;	  // [ms] Iterations slower than this count as a miss
+inline constexpr float CONFIG_LOOP_JITTER_WARN_MS = 2.0f;				  // [ms] Period standard deviation that raises a warning during a task
 
 
 
@@ -152,6 +174,40 @@ inline constexpr unsigned short CONFIG_CAM_FOCUS_LEVEL		 = 0;		 // 0
 inline constexpr bool			CONFIG_CAM_AUTO_FOCUS		 = 0;		 // 0
 inline constexpr unsigned short CONFIG_CAM_ZOOM				 = 0;		 // 0
 
+// Capture preprocessing
+inline constexpr bool			CONFIG_CAPTURE_USE_GPU	   = true;	  // Use CUDA remap when a device is present
+inline constexpr unsigned short CONFIG_CAPTURE_REMAP_BANDS = 16;	  // Row bands for the CPU remap
+inline constexpr double			CONFIG_CAM_GRAY_ALPHA	   = 1.4;	  // Detection image contrast (1.0 = no change)
+inline constexpr double			CONFIG_CAM_GRAY_BETA	   = 100;	  // Detection image brightness (0 = no change)
+inline constexpr bool			CONFIG_DETECT_IN_RAW_SPACE		= false;	// Detect on the raw frame and undistort only marker corners
+inline constexpr unsigned short CONFIG_CAPTURE_DISPLAY_INTERVAL = 3;		// Display remap every n-th frame in raw-space detection
+inline constexpr unsigned short CONFIG_CAPTURE_WAIT_MS			= 50;		// Longest the main loop waits for a new frame, keeps input alive when the source stalls
+
+// Marker detection
+inline constexpr bool			CONFIG_ARUCO_TRACKING		  = true;	// Search a window around the last corners instead of the full frame
+inline constexpr unsigned short CONFIG_ARUCO_ROI_MARGIN_PX	  = 40;	// Minimum border added around the predicted corners
+inline constexpr unsigned short CONFIG_ARUCO_ROI_MAX_MISSES = 3;	// Missed windows before falling back to a full-frame search
+inline constexpr unsigned short CONFIG_ARUCO_FULL_SEARCH_FRAMES = 15;	// Search the full frame this often while tracking, keeps every bank marker measured
+inline constexpr unsigned short CONFIG_ARUCO_PYRAMID_LEVEL  = 1;	// Full-frame search on a 1/2^n scaled frame, 0 = full resolution
+inline constexpr bool			CONFIG_ARUCO_WARM_START		  = true;	// Refine the pose from the previous frame
+inline constexpr double			CONFIG_ARUCO_WARM_START_MAX_MM = 10.0;	// Discard warm-started poses further than this from the closed form
+
+// Target filter
+inline constexpr int	  CONFIG_MARKER_BANK_IDS[]	  = { 1, 2, 3, 4, 5, 8 };						// Markers with their own filter, in slot order
+inline constexpr size_t CONFIG_MARKER_BANK_SIZE	  = sizeof( CONFIG_MARKER_BANK_IDS ) / sizeof( int );
+inline constexpr float  CONFIG_KALMAN_BANK_TIMEOUT_S = 0.5f;	// Restart a marker's filter when it has not been seen for this long
+inline constexpr float  CONFIG_KALMAN_CORNER_NOISE_PX = 1.0f;	// [px] Corner noise of a sharp, frontal tag, 0.1 mm^2 laterally at 200 mm
+inline constexpr float  CONFIG_KALMAN_R_MIN_MM2	  = 0.01f;	// [mm^2] Floor on the measurement noise
+inline constexpr float  CONFIG_KALMAN_GATE_CHI2	  = 16.3f;	// Innovation gate, 99.9 % of inliers for three axes
+inline constexpr float  CONFIG_KALMAN_GATE_MIN_MM	  = 10.0f;	// [mm] Innovations shorter than this always pass the gate
+inline constexpr unsigned short CONFIG_KALMAN_GATE_MAX_REJECTS = 3;	// Consecutive rejections before the marker's filter starts over
+inline constexpr bool	  CONFIG_PREDICTION_ENABLED	  = true;	// Control on the state predicted to actuation time
+inline constexpr float  CONFIG_PREDICTION_MAX_MS	  = 50.0f;	// [ms] Longest prediction horizon
+
+// Control thread
+inline constexpr bool			CONFIG_CONTROL_THREAD  = true;	// Run controller and serial send on their own thread, otherwise once per loop
+inline constexpr unsigned short CONFIG_CONTROL_RATE_HZ = 500;	// [Hz] Control thread tick rate
+
 // Declare colors (defined in `config.cpp`)
 extern const cv::Scalar CONFIG_colRedMd, CONFIG_colRedLt, CONFIG_colRedDk, CONFIG_colRedBk, CONFIG_colRedWt;
 extern const cv::Scalar CONFIG_colOraMd, CONFIG_colOraLt, CONFIG_colOraDk, CONFIG_colOraBk, CONFIG_colOraWt;
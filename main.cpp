@@ -16,15 +16,18 @@ auto shared = dataHandle.getData();
 // Custom class objects
 #include "include/ArucoClass.h"
 #include "include/CaptureClass.h"
+#include "include/ControlLoopClass.h"
 #include "include/ControllerClass.h"
 #include "include/DisplayClass.h"
 #include "include/InputClass.h"
 #include "include/KalmanClass.h"
+#include "include/LatencyClass.h"
 #include "include/LoggingClass.h"
 #include "include/SerialClass.h"
 #include "include/TasksClass.h"
 #include "include/TimingClass.h"
 #include "include/TouchscreenClass.h"
+#include "include/TraceClass.h"
 
 // New class objects
 // New class objects
@@ -39,6 +42,9 @@ LoggingClass	 Logging( dataHandle );					  // Logging interface
 ControllerClass	 Controller( dataHandle );				  // Controller
 KalmanClass		 Kalman( dataHandle );					  // Kalman filter
 TasksClass		 Tasks( dataHandle, Timing, Logging );	  // Tasks interface
+LatencyClass	 Latency( dataHandle );					  // Glass-to-motor latency
+TraceClass		 Trace( dataHandle, Timing );			  // Trace-event recorder
+ControlLoopClass ControlLoop( dataHandle, Controller, Serial );	  // Fixed-rate control thread
 
 
 
@@ -59,10 +65,16 @@ bool FLAG_PrintState		   = false;
 
 /**
  * @brief Main program loop
+ *
+ * Options:
+ *     --headless         no windows or key polling, the full pipeline still runs
+ *     --script <file>    timed key / touch script, replaces the keyboard in headless mode
+ *     --replay <path>    replay a recorded video or image directory instead of the camera
+ *     --gains <file>     controller gains to start with, as written by NURingGainSweep
  * 
  * @return int 
  */
-int main() {
+int main( int argc, char* argv[] ) {
 
 	// Reverse type
 	shared->Amplifier.isReverseConstant = true;	   // ( constant = 1 )
@@ -80,6 +92,42 @@ int main() {
 
 	shared->System.useRing = false;
 
+	// Command line overrides
+	for ( int i = 1; i < argc; i++ ) {
+		std::string arg = argv[i];
+		if ( arg == "--headless" ) {
+			shared->System.isHeadless = true;
+		} else if ( arg == "--script" && i + 1 < argc ) {
+			CONFIG_HEADLESS_SCRIPT = argv[++i];
+		} else if ( arg == "--replay" && i + 1 < argc ) {
+			CONFIG_CAPTURE_REPLAY_PATH = argv[++i];
+		} else if ( arg == "--gains" && i + 1 < argc ) {
+			CONFIG_GAINS_PATH = argv[++i];
+		} else {
+			std::cerr << "Main:         Unknown argument " << arg << ", expected --headless, --script <file>, --replay <path> or --gains <file>\n";
+			return 1;
+		}
+	}
+
+	// Tuned gains
+	if ( !CONFIG_GAINS_PATH.empty() && !Controller.LoadGains( CONFIG_GAINS_PATH ) ) {
+		return 1;
+	}
+
+	// Camera, or the recording picked above
+	if ( !Capture.Initialize() ) {
+		std::cerr << "Main:         Could not open frame source " << shared->Capture.sourceName << "\n";
+		return 1;
+	}
+
+	// Headless runs take their input from the script
+	if ( shared->System.isHeadless ) {
+		std::cout << "Main:         Headless mode, source " << shared->Capture.sourceName << "\n";
+		if ( !CONFIG_HEADLESS_SCRIPT.empty() && !Input.LoadScript( CONFIG_HEADLESS_SCRIPT ) ) {
+			return 1;
+		}
+	}
+
 	// Optimization for C/C++ data types
 	std::ios_base::sync_with_stdio( false );
 	std::cout.setf( std::ios::unitbuf );
@@ -96,9 +144,9 @@ int main() {
 	// Start timer for measuring loop frequency
 	Timing.StartTimer();
 
-	// Add shortcut panel
+	// Open windows and add shortcut panel
 	// Canvas.BuildKeyboardShortcuts();
-	Canvas.AddStaticDisplayPanels();
+	Canvas.Initialize();
 
 	// Initialize kalman filter
 	shared->KalmanFilter.pMatrix = cv::Mat::eye( 6, 6, CV_32F ) * 1.0f;
@@ -106,6 +154,20 @@ int main() {
 	// Set default system state
 	shared->System.state = stateEnum::IDLE;
 
+	// Start trace recording if enabled, before the capture thread starts writing events
+	Trace.Initialize();
+
+	// Start grabbing frames on the capture thread
+	Capture.Start();
+
+	// Control and send at a fixed rate on their own thread
+	if ( CONFIG_CONTROL_THREAD ) {
+		ControlLoop.Start();
+	}
+
+	// Read amplifier feedback as it arrives
+	Serial.Start();
+
 	// Main loop
 	while ( shared->System.isMainRunning ) {
 
@@ -117,41 +179,95 @@ int main() {
 		// Update timer (for measuring loop frequency)
 		Timing.Update();
 
-		// Parse any input and use OpenCV WaitKey()
-		Input.ParseInput( cv::pollKey() & 0xFF );
+		// Parse any input and use OpenCV WaitKey(), or the script when headless
+		{
+			StageTimer timer( Timing, loopStageEnum::INPUT );
+			if ( shared->System.isHeadless ) {
+				Input.ParseScript();
+			} else {
+				Input.ParseInput( cv::pollKey() & 0xFF );
+			}
+		}
 
-		// Capture frame
-		Capture.GetFrame();
+		// Take newest captured frame
+		{
+			StageTimer timer( Timing, loopStageEnum::CAPTURE );
+			Capture.GetFrame();
+		}
 
 		// Run the appropriate task
-		SelectTask();
+		{
+			StageTimer timer( Timing, loopStageEnum::TASK );
+			SelectTask();
+		}
 
 		// Detect ArUco tags
-		Aruco.FindTags();
+		{
+			StageTimer timer( Timing, loopStageEnum::DETECT );
+			Aruco.FindTags();
+		}
 
 		// Update system
-		UpdateSystem();
+		{
+			StageTimer timer( Timing, loopStageEnum::SYSTEM );
+			UpdateSystem();
+		}
 
-		// Update controller
-		Controller.Update();
-		Controller.UpdateAmplifier();
-		Controller.UpdateVibrotactile();
+		// Update controller, ticks on the control thread when it runs, feedback is converted where Receive() parsed it
+		{
+			StageTimer timer( Timing, loopStageEnum::CONTROL );
+			ControlLoop.Update();
+			Controller.UpdateAmplifier();
+			Controller.UpdateVibrotactile();
+		}
 
 		// Check touchscreen input
-		Touch.GetCursorPosition();
+		{
+			StageTimer timer( Timing, loopStageEnum::TOUCH );
+			Touch.GetCursorPosition();
+		}
 
 		// Update serial messages
-		Serial.Update();
+		{
+			StageTimer timer( Timing, loopStageEnum::SERIAL );
+			Serial.Receive();
+		}
+
+		// Trace the frame through the pipeline
+		Latency.Update();
+		Trace.Update();
 
 		// Update display
-		Canvas.Update();
+		{
+			StageTimer timer( Timing, loopStageEnum::DISPLAY );
+			Canvas.Update();
+		}
+
+		// Headless replays end with the recording
+		if ( shared->System.isHeadless && shared->Capture.isSourceFinished ) {
+			shared->System.isShuttingDown = true;
+		}
 
 		// Update shutdown flags for clean shutdown
 		if ( shared->System.isShuttingDown ) {
 			shared->System.isMainRunning = false;
 		}
 	}
-	cv::destroyAllWindows();
+
+	// Stop control, serial and capture threads
+	ControlLoop.Close();
+	Serial.Close();
+	Capture.Close();
+	Trace.Close();
+
+	// Latency and loop stage reports
+	std::string timestamp = Timing.GetFullDateAndTime( false );
+	Latency.Dump( timestamp );
+	Timing.DumpProfile( timestamp );
+
+	if ( !shared->System.isHeadless ) {
+		cv::destroyAllWindows();
+	}
 	return 0;
 }
 
@@ -248,20 +364,23 @@ void SelectTask() {
  */
 void UpdateSystem() {
 
-	if ( shared->Target.isTargetFound && shared->Capture.isFrameReady ) {
+	// Nothing new from the detector
+	if ( !shared->Capture.isFrameReady ) {
+		return;
+	}
 
-		if ( cv::norm( cv::Point2f( shared->Target.positionUnfilteredMM.x, shared->Target.positionUnfilteredMM.y ) - cv::Point2f( shared->Target.positionFilteredOldMM.x, shared->Target.positionFilteredOldMM.y ) ) > 100.0f ) {
-			shared->Target.isTargetReset = true;
-		}
+	// Kalman.Update() consumes the reset request, the controller still has to restart its ramp on it
+	const bool isTargetReset = shared->Target.isTargetReset;
 
+	// Update every marker seen in this frame, on the time the frame was captured, outliers are gated per marker
+	Kalman.Update( Timing.GetRunningTime( shared->Capture.timeSource ) );
+
+	if ( shared->Target.isTargetFound ) {
 
 		// Save old data
 		shared->Target.positionFilteredOldMM = shared->Target.positionFilteredNewMM;
 		shared->Target.velocityFilteredOldMM = shared->Target.velocityFilteredNewMM;
 
-		// Update kalman filter
-		Kalman.Update( shared->Target.positionUnfilteredMM, shared->Timing.elapsedRunningTime );
-
 		// Get updated state values
 		shared->Target.positionFilteredNewMM = Kalman.GetPosition();
 		shared->Target.velocityFilteredNewMM = Kalman.GetVelocity();
@@ -273,6 +392,17 @@ void UpdateSystem() {
 			// Offset based on calibrated touch
 		}
 	}
+
+	// Hand the frame's state to the controller, predicted to actuation time when it runs
+	ControlInputStruct input;
+	input.isTargetFound		   = shared->Target.isTargetFound;
+	input.isTargetReset		   = isTargetReset;
+	input.positionFilteredMM   = shared->Target.positionFilteredNewMM;
+	input.velocityFilteredMM   = shared->Target.velocityFilteredNewMM;
+	input.positionIntegratedMM = shared->Target.positionIntegratedMM;
+	input.timeCaptured		   = shared->Capture.timeGrabbed;
+
+	ControlLoop.Post( input );
 }
 
 
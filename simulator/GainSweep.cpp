@@ -0,0 +1,297 @@
+// Standard libraries
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Plant simulator and the controller whose gains are searched
+#include "ControllerClass.h"
+#include "PlantSimulatorClass.h"
+#include "SystemDataManager.h"
+#include "WorkStealingPool.h"
+
+
+
+/**
+ * @brief One set of controller settings and how it did over the trials
+ */
+struct CandidateStruct {
+
+	// Settings
+	Point4f gainKp;
+	Point4f gainKi;
+	Point4f gainKd;
+	float	integralDecay	  = 0.9f;
+	int		integrationRadius = 100;
+	float	rampDurationTime  = 1.0f;
+
+	// Means over the trials
+	float settleTimeS = 0.0f;	 // Unsettled trials count as the full trial
+	float overshootMM = 0.0f;
+	float errorRMSMM  = 0.0f;
+	int	  nUnsettled  = 0;
+	float cost		  = 0.0f;
+};
+
+
+/**
+ * @brief Search ranges, wide enough to include unstable settings
+ */
+struct SweepRangeStruct {
+	float kpMin = 0.2f, kpMax = 3.0f;
+	float kiMin = 0.0f, kiMax = 2.0f;
+	float kdMin = 0.0f, kdMax = 0.1f;
+	float decayMin = 0.5f, decayMax = 0.99f;
+	int	  radiusMin = 20, radiusMax = 200;
+	float rampMin = 0.1f, rampMax = 2.0f;
+};
+
+
+
+/**
+ * @brief Copy a candidate into a data manager's controller settings
+ */
+static void ApplyCandidate( const CandidateStruct& candidate, ManagedData& data ) {
+
+	data.Controller.gainKp			  = candidate.gainKp;
+	data.Controller.gainKi			  = candidate.gainKi;
+	data.Controller.gainKd			  = candidate.gainKd;
+	data.Controller.integralDecay	  = candidate.integralDecay;
+	data.Controller.integrationRadius = candidate.integrationRadius;
+	data.Controller.rampDurationTime  = candidate.rampDurationTime;
+}
+
+
+
+/**
+ * @brief Uniform draw of every setting within the ranges
+ */
+static CandidateStruct RandomCandidate( cv::RNG& rng, const SweepRangeStruct& range ) {
+
+	auto gains = [&]( float min, float max ) {
+		return Point4f { rng.uniform( min, max ), rng.uniform( min, max ), rng.uniform( min, max ), rng.uniform( min, max ) };
+	};
+
+	CandidateStruct candidate;
+	candidate.gainKp			= gains( range.kpMin, range.kpMax );
+	candidate.gainKi			= gains( range.kiMin, range.kiMax );
+	candidate.gainKd			= gains( range.kdMin, range.kdMax );
+	candidate.integralDecay		= rng.uniform( range.decayMin, range.decayMax );
+	candidate.integrationRadius = rng.uniform( range.radiusMin, range.radiusMax + 1 );
+	candidate.rampDurationTime	= rng.uniform( range.rampMin, range.rampMax );
+	return candidate;
+}
+
+
+
+/**
+ * @brief Scale every setting of a parent by up to +-spread, kept within the ranges
+ */
+static CandidateStruct PerturbCandidate( const CandidateStruct& parent, cv::RNG& rng, const SweepRangeStruct& range, float spread ) {
+
+	auto scale = [&]( float value, float min, float max ) {
+		return std::clamp( value * rng.uniform( 1.0f - spread, 1.0f + spread ), min, max );
+	};
+	auto gains = [&]( const Point4f& g, float min, float max ) {
+		return Point4f { scale( g.abd, min, max ), scale( g.add, min, max ), scale( g.flx, min, max ), scale( g.ext, min, max ) };
+	};
+
+	CandidateStruct candidate;
+	candidate.gainKp			= gains( parent.gainKp, range.kpMin, range.kpMax );
+	candidate.gainKi			= gains( parent.gainKi, range.kiMin, range.kiMax );
+	candidate.gainKd			= gains( parent.gainKd, range.kdMin, range.kdMax );
+	candidate.integralDecay		= scale( parent.integralDecay, range.decayMin, range.decayMax );
+	candidate.integrationRadius = int( std::lround( scale( float( parent.integrationRadius ), float( range.radiusMin ), float( range.radiusMax ) ) ) );
+	candidate.rampDurationTime	= scale( parent.rampDurationTime, range.rampMin, range.rampMax );
+	return candidate;
+}
+
+
+
+/**
+ * @brief Offline controller tuning on the plant simulator
+ *
+ * Every candidate runs the same simulated Fitts trials: from rest, the target appears at a random
+ * distance and direction and the device has to bring the finger onto it. Trials are spread over
+ * all cores with a work-stealing pool. Candidates are ranked by a weighted sum of settling time,
+ * overshoot and tracking error. Later rounds search around the best candidates so far. The best
+ * settings are written in the format ControllerClass::LoadGains() reads, for
+ * NURingIntegratedController --gains.
+ *
+ * Usage: NURingGainSweep [--candidates n] [--trials n] [--rounds n] [--duration s] [--gains start.txt] [--out gains.txt]
+ *                        [--w-settle w] [--w-overshoot w] [--w-error w] [--seed n]
+ */
+int main( int argc, char** argv ) {
+
+	size_t		nCandidates	 = 2000;
+	size_t		nTrials		 = 16;
+	size_t		nRounds		 = 2;
+	float		durationS	 = 2.0f;
+	float		wSettle		 = 1.0f;
+	float		wOvershoot	 = 0.1f;
+	float		wError		 = 0.05f;
+	uint64_t	seed		 = 1;
+	std::string startPath	 = "";
+	std::string outPath		 = "gains.txt";
+
+	for ( int i = 1; i < argc; i += 2 ) {
+		std::string arg = argv[i];
+
+		// Every option takes a value
+		if ( i + 1 >= argc ) {
+			std::cout << "GainSweep:    Unknown option " << arg << "\n";
+			return 1;
+		}
+		std::string value = argv[i + 1];
+
+		if ( arg == "--candidates" ) {
+			nCandidates = std::stoul( value );
+		} else if ( arg == "--trials" ) {
+			nTrials = std::stoul( value );
+		} else if ( arg == "--rounds" ) {
+			nRounds = std::stoul( value );
+		} else if ( arg == "--duration" ) {
+			durationS = std::stof( value );
+		} else if ( arg == "--gains" ) {
+			startPath = value;
+		} else if ( arg == "--out" ) {
+			outPath = value;
+		} else if ( arg == "--w-settle" ) {
+			wSettle = std::stof( value );
+		} else if ( arg == "--w-overshoot" ) {
+			wOvershoot = std::stof( value );
+		} else if ( arg == "--w-error" ) {
+			wError = std::stof( value );
+		} else if ( arg == "--seed" ) {
+			seed = std::stoull( value );
+		} else {
+			std::cout << "GainSweep:    Unknown option " << arg << "\n";
+			return 1;
+		}
+	}
+	if ( nCandidates == 0 || nTrials == 0 || nRounds == 0 ) {
+		std::cout << "GainSweep:    Nothing to do.\n";
+		return 1;
+	}
+
+	// Same Fitts targets for every candidate
+	cv::RNG					 rng( seed );
+	std::vector<cv::Point3f> targets;
+	for ( size_t t = 0; t < nTrials; t++ ) {
+		float distanceMM = rng.uniform( 5.0f, 25.0f );
+		float direction	 = rng.uniform( 0.0f, 2.0f * float( CV_PI ) );
+		targets.push_back( cv::Point3f( distanceMM * std::cos( direction ), distanceMM * std::sin( direction ), 200.0f ) );
+	}
+
+	// One data manager and simulator per worker
+	WorkStealingPool								  pool;
+	std::vector<std::unique_ptr<SystemDataManager>>	  managers;
+	std::vector<std::unique_ptr<PlantSimulatorClass>> simulators;
+	for ( size_t w = 0; w < pool.Workers(); w++ ) {
+		managers.push_back( std::make_unique<SystemDataManager>() );
+		simulators.push_back( std::make_unique<PlantSimulatorClass>( *managers.back() ) );
+	}
+
+	// Optional starting point, ranked with the rest
+	SweepRangeStruct			 range;
+	std::vector<CandidateStruct> ranked;
+	if ( !startPath.empty() ) {
+		SystemDataManager startHandle;
+		ControllerClass	  startController( startHandle );
+		if ( !startController.LoadGains( startPath ) ) {
+			return 1;
+		}
+		const ControllerStruct& c = startHandle.getData()->Controller;
+		CandidateStruct			start;
+		start.gainKp			= c.gainKp;
+		start.gainKi			= c.gainKi;
+		start.gainKd			= c.gainKd;
+		start.integralDecay		= c.integralDecay;
+		start.integrationRadius = c.integrationRadius;
+		start.rampDurationTime	= c.rampDurationTime;
+		ranked.push_back( start );
+	}
+
+	std::cout << "\nGainSweep:    " << nRounds << " rounds of " << nCandidates << " candidates x " << nTrials << " trials on " << pool.Workers() << " workers\n";
+
+	for ( size_t round = 0; round < nRounds; round++ ) {
+
+		// First round covers the ranges, later rounds refine the best so far
+		std::vector<CandidateStruct> candidates;
+		size_t						 nParents = std::min<size_t>( 10, ranked.size() );
+		for ( size_t n = 0; n < nCandidates; n++ ) {
+			if ( round == 0 || nParents == 0 ) {
+				candidates.push_back( RandomCandidate( rng, range ) );
+			} else {
+				candidates.push_back( PerturbCandidate( ranked[n % nParents], rng, range, 0.3f / float( round ) ) );
+			}
+		}
+		if ( round == 0 ) {
+			candidates.insert( candidates.end(), ranked.begin(), ranked.end() );
+		}
+
+		// Every trial of every candidate is one task. Noise is seeded by the trial, not the worker that
+		// happens to steal it, so all candidates face the same camera and runs are reproducible
+		auto							timeStart = std::chrono::steady_clock::now();
+		std::vector<PlantResultStruct> results( candidates.size() * nTrials );
+		pool.Run( results.size(), [&]( size_t task, size_t worker ) {
+			const CandidateStruct& candidate = candidates[task / nTrials];
+			const cv::Point3f	   target	 = targets[task % nTrials];
+			ApplyCandidate( candidate, *managers[worker]->getData() );
+			simulators[worker]->settings.seed = seed + task % nTrials;
+			results[task]					  = simulators[worker]->Run( durationS, [target]( float ) { return target; } );
+		} );
+		double wallTimeS = std::chrono::duration<double>( std::chrono::steady_clock::now() - timeStart ).count();
+
+		// Score
+		for ( size_t c = 0; c < candidates.size(); c++ ) {
+			CandidateStruct& candidate = candidates[c];
+			candidate.settleTimeS = candidate.overshootMM = candidate.errorRMSMM = 0.0f;
+			candidate.nUnsettled  = 0;
+			for ( size_t t = 0; t < nTrials; t++ ) {
+				const PlantResultStruct& result = results[c * nTrials + t];
+				candidate.settleTimeS += ( result.settleTimeS < 0.0f ? durationS : result.settleTimeS ) / nTrials;
+				candidate.overshootMM += result.overshootMM / nTrials;
+				candidate.errorRMSMM += result.errorRMSMM / nTrials;
+				candidate.nUnsettled += ( result.settleTimeS < 0.0f ) ? 1 : 0;
+			}
+			candidate.cost = wSettle * candidate.settleTimeS + wOvershoot * candidate.overshootMM + wError * candidate.errorRMSMM;
+		}
+
+		// Keep everything ranked so far
+		ranked.insert( ranked.end(), candidates.begin(), candidates.end() );
+		std::sort( ranked.begin(), ranked.end(), []( const CandidateStruct& a, const CandidateStruct& b ) { return a.cost < b.cost; } );
+		ranked.resize( std::min<size_t>( ranked.size(), 100 ) );
+
+		std::cout << "GainSweep:    Round " << round + 1 << ", " << results.size() << " trials in " << std::fixed << std::setprecision( 1 ) << wallTimeS << " s ("
+				  << std::setprecision( 0 ) << results.size() * durationS / wallTimeS << "x real time), best cost " << std::setprecision( 3 ) << ranked.front().cost << "\n";
+	}
+
+	// Top of the ranking
+	std::cout << "\n  rank    cost  settle [s]  overshoot [mm]  rms [mm]  unsettled   Kp abd/add/flx/ext          Ki abd/add/flx/ext          Kd abd/add/flx/ext          decay  radius  ramp [s]\n";
+	for ( size_t r = 0; r < std::min<size_t>( 10, ranked.size() ); r++ ) {
+		const CandidateStruct& c = ranked[r];
+		std::cout << std::fixed << std::setprecision( 3 ) << std::setw( 6 ) << r + 1 << std::setw( 8 ) << c.cost << std::setw( 12 ) << c.settleTimeS << std::setw( 16 ) << c.overshootMM
+				  << std::setw( 10 ) << c.errorRMSMM << std::setw( 11 ) << c.nUnsettled << "   "
+				  << std::setprecision( 2 ) << c.gainKp.abd << " " << c.gainKp.add << " " << c.gainKp.flx << " " << c.gainKp.ext << "   "
+				  << c.gainKi.abd << " " << c.gainKi.add << " " << c.gainKi.flx << " " << c.gainKi.ext << "   "
+				  << std::setprecision( 3 ) << c.gainKd.abd << " " << c.gainKd.add << " " << c.gainKd.flx << " " << c.gainKd.ext << "   "
+				  << std::setprecision( 2 ) << c.integralDecay << std::setw( 8 ) << c.integrationRadius << std::setw( 10 ) << c.rampDurationTime << "\n";
+	}
+
+	// Best settings for the live app
+	SystemDataManager bestHandle;
+	ControllerClass	  bestController( bestHandle );
+	ApplyCandidate( ranked.front(), *bestHandle.getData() );
+	if ( !bestController.SaveGains( outPath ) ) {
+		return 1;
+	}
+	std::cout << "\nGainSweep:    Best gains written to " << outPath << ", start the controller with --gains " << outPath << "\n";
+
+	return 0;
+}
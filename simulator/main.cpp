@@ -0,0 +1,101 @@
+// Standard libraries
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+// Plant simulator
+#include "PlantSimulatorClass.h"
+#include "SystemDataManager.h"
+
+
+
+/**
+ * @brief Print one run in the benchmark report layout
+ */
+static void PrintRun( const std::string& name, float durationS, const PlantResultStruct& result ) {
+
+	std::cout << std::left << std::setw( 32 ) << name << std::right << std::fixed << std::setprecision( 2 )
+			  << " rms = " << std::setw( 6 ) << result.errorRMSMM << " mm"
+			  << "   max = " << std::setw( 6 ) << result.errorMaxMM << " mm"
+			  << "   end = " << std::setw( 6 ) << result.errorEndMM << " mm"
+			  << "   overshoot = " << std::setw( 6 ) << result.overshootMM << " mm"
+			  << "   settle = " << std::setw( 5 ) << result.settleTimeS << " s"
+			  << "   current = " << std::setprecision( 3 ) << result.currentMeanA << " A"
+			  << "   limit steps = " << result.nOverLimit
+			  << "   speed-up = " << std::setprecision( 0 ) << durationS / result.wallTimeS << "x\n";
+}
+
+
+
+/**
+ * @brief Run the filter and controller against the simulated hand, camera and amplifier
+ *
+ * Usage: NURingSimulator [--kp gain] [--ki gain] [--kd gain] [--noise mm] [--latency ms] [--dropout chance] [--duration s]
+ *
+ * Gains apply to all four directions.
+ */
+int main( int argc, char** argv ) {
+
+	SystemDataManager	dataHandle;
+	auto				shared = dataHandle.getData();
+	PlantSettingsStruct settings;
+	float				kp		  = 1.0f;
+	float				ki		  = 0.0f;
+	float				kd		  = 0.0f;
+	float				durationS = 5.0f;
+
+	for ( int i = 1; i < argc; i += 2 ) {
+		std::string arg = argv[i];
+
+		// Every option takes a value
+		if ( i + 1 >= argc ) {
+			std::cout << "Simulator:    Unknown option " << arg << "\n";
+			return 1;
+		}
+		float value = std::stof( argv[i + 1] );
+
+		if ( arg == "--kp" ) {
+			kp = value;
+		} else if ( arg == "--ki" ) {
+			ki = value;
+		} else if ( arg == "--kd" ) {
+			kd = value;
+		} else if ( arg == "--noise" ) {
+			settings.cameraNoiseMM = value;
+		} else if ( arg == "--latency" ) {
+			settings.cameraLatencyMS = value;
+		} else if ( arg == "--dropout" ) {
+			settings.cameraDropout = value;
+		} else if ( arg == "--duration" ) {
+			durationS = value;
+		} else {
+			std::cout << "Simulator:    Unknown option " << arg << "\n";
+			return 1;
+		}
+	}
+
+	shared->Controller.gainKp = { kp, kp, kp, kp };
+	shared->Controller.gainKi = { ki, ki, ki, ki };
+	shared->Controller.gainKd = { kd, kd, kd, kd };
+
+	std::cout << "\nSimulator:    Kp = " << kp << "   Ki = " << ki << "   Kd = " << kd << "   " << durationS << " s per run\n\n";
+
+	PlantSimulatorClass Simulator( dataHandle, settings );
+
+	// Target held off to one side
+	PrintRun( "sim/step", durationS, Simulator.Run( durationS, []( float ) { return cv::Point3f( 15.0f, -10.0f, 200.0f ); } ) );
+
+	// Target circling at 0.5 Hz
+	PrintRun( "sim/circle", durationS, Simulator.Run( durationS, []( float t ) {
+		float theta = 2.0f * float( CV_PI ) * 0.5f * t;
+		return cv::Point3f( 20.0f * std::cos( theta ), 20.0f * std::sin( theta ), 200.0f );
+	} ) );
+
+	// Same step without prediction
+	shared->Controller.isPredictionEnabled = false;
+	PrintRun( "sim/step_no_prediction", durationS, Simulator.Run( durationS, []( float ) { return cv::Point3f( 15.0f, -10.0f, 200.0f ); } ) );
+
+	std::cout << "\nSimulator:    Done.\n";
+	return 0;
+}
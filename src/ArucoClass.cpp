@@ -4,6 +4,9 @@
 // System data manager
 #include "SystemDataManager.h"
 
+// Math
+#include <cmath>
+
 /**
  * @brief Construct a new Aruco Class:: Aruco Class object
  * 
@@ -42,6 +45,11 @@ void ArucoClass::Initialize() {
 	// Re-initialize detector
 	arucoDetector = cv::aruco::ArucoDetector( arucoDictionary, arucoDetectorParams );
 
+	// Coarse detector for the pyramid search, corners are refined at full resolution afterwards
+	cv::aruco::DetectorParameters arucoCoarseParams = arucoDetectorParams;
+	arucoCoarseParams.cornerRefinementMethod		= cv::aruco::CORNER_REFINE_NONE;
+	arucoDetectorCoarse								= cv::aruco::ArucoDetector( arucoDictionary, arucoCoarseParams );
+
 	// Configure real-world conversion system
 	arucoPoints.ptr<cv::Vec3f>( 0 )[0] = cv::Vec3f( -CONFIG_LARGE_MARKER_WIDTH / 2.f, CONFIG_LARGE_MARKER_WIDTH / 2.f, 0 );
 	arucoPoints.ptr<cv::Vec3f>( 0 )[1] = cv::Vec3f( CONFIG_LARGE_MARKER_WIDTH / 2.f, CONFIG_LARGE_MARKER_WIDTH / 2.f, 0 );
@@ -68,6 +76,7 @@ void ArucoClass::FindTags() {
 
 			// Reset global flags
 			shared->Target.isTargetFound = false;
+			shared->Target.isMarkerFound.fill( false );
 			// shared->FLAG_FINGER_MARKER_FOUND = false;
 
 			// Reset individual tag state
@@ -75,9 +84,38 @@ void ArucoClass::FindTags() {
 				arucoTagsPresent[t] = false;
 			}
 
+			// Window follows one tag only, start over when the active tag changes
+			if ( trackedID != shared->Target.activeID ) {
+				trackedCorners.clear();
+				shared->Aruco.trackingMisses = 0;
+				isPosePrevious				 = false;
+			}
+
+			// Search around the last corners while tracking, otherwise the whole frame. The window only
+			// follows the active tag, so a periodic full-frame pass keeps the other bank markers measured
+			// before their filters time out
+			const cv::Size frameSize( shared->Capture.frameGray.cols, shared->Capture.frameGray.rows );
+			shared->Aruco.isTracking = shared->Aruco.isTrackingEnabled && !trackedCorners.empty() && framesSinceFullSearch < CONFIG_ARUCO_FULL_SEARCH_FRAMES;
+			framesSinceFullSearch	 = shared->Aruco.isTracking ? framesSinceFullSearch + 1 : 0;
+			shared->Aruco.searchRegionPX = shared->Aruco.isTracking ? PredictSearchRegion( frameSize ) : cv::Rect( cv::Point( 0, 0 ), frameSize );
+
 			// Run detector
 			// arucoDetector.detectMarkers( shared->matFrameGray, arucoCorners, arucoDetectedIDs, arucoRejects );
-			arucoDetector.detectMarkers( shared->Capture.frameGray, arucoCorners, arucoDetectedIDs );
+			if ( !shared->Aruco.isTracking && shared->Aruco.pyramidLevel > 0 ) {
+				DetectPyramid( shared->Capture.frameGray, shared->Aruco.pyramidLevel );
+			} else {
+				arucoDetector.detectMarkers( shared->Capture.frameGray( shared->Aruco.searchRegionPX ), arucoCorners, arucoDetectedIDs );
+			}
+
+			// Move window corners back to full-frame coordinates
+			if ( shared->Aruco.isTracking ) {
+				const cv::Point2f offset( shared->Aruco.searchRegionPX.tl() );
+				for ( std::vector<cv::Point2f>& corners : arucoCorners ) {
+					for ( cv::Point2f& corner : corners ) {
+						corner += offset;
+					}
+				}
+			}
 
 			// Check if markers have been found
 			if ( !arucoDetectedIDs.empty() ) {
@@ -87,54 +125,86 @@ void ArucoClass::FindTags() {
 
 					if ( ( arucoDetectedIDs[i] > 0 && arucoDetectedIDs[i] <= 5 ) || ( arucoDetectedIDs[i] == 8 ) ) {
 
-						if ( ( arucoDetectedIDs[i] > 0 ) && ( arucoDetectedIDs[i] == shared->Target.activeID ) ) {	  // Only process active tag
+						const bool isActive = ( arucoDetectedIDs[i] == shared->Target.activeID );
+						const int  slot		= MarkerBankSlot( arucoDetectedIDs[i] );
 
+						// Copy into the preallocated corner buffer
+						arucoMarkerCornersPX.assign( arucoCorners[i].begin(), arucoCorners[i].end() );
 
-							// Extract current corner
-							std::vector<std::vector<cv::Point2f>> currentCorner = { arucoCorners[i] };
+						// Corners found on the raw frame are moved into undistorted display space
+						if ( shared->Capture.isGrayRaw ) {
+							UndistortCorners( arucoMarkerCornersPX );
+						}
 
-							// Estimate tag pose formarkers in the valid range
-							cv::aruco::estimatePoseSingleMarkers( currentCorner, CONFIG_LARGE_MARKER_WIDTH, CONFIG_CAMERA_MATRIX, CONFIG_DISTORTION_COEFFS, arucoRotationVector, arucoTranslationVector );
+						// Estimate tag pose formarkers in the valid range
+						if ( !EstimatePose( arucoMarkerCornersPX, ( shared->Capture.isGrayRaw ? arucoNoDistortion : CONFIG_DISTORTION_COEFFS ), isActive ) ) {
+							continue;
+						}
 
-							if ( arucoTranslationVector.empty() ) {
-								continue;
+						// Every valid marker feeds its own filter, so switching targets needs no re-convergence
+						const cv::Point3f positionMM		  = cv::Point3f( arucoTranslationVector[0], -arucoTranslationVector[1], arucoTranslationVector[2] );
+						arucoTagsPresent[arucoDetectedIDs[i]] = true;
+						if ( slot >= 0 ) {
+							float reprojectionPX				   = 0.0f;
+							shared->Target.isMarkerFound[slot]	   = true;
+							shared->Target.markerPositionsMM[slot] = positionMM;
+							shared->Target.markerVarianceMM2[slot] = MeasurementVariance( arucoMarkerCornersPX, ( shared->Capture.isGrayRaw ? arucoNoDistortion : CONFIG_DISTORTION_COEFFS ), reprojectionPX );
+							if ( isActive ) {
+								shared->Aruco.reprojectionPX = reprojectionPX;
 							}
+						}
+
+						if ( isActive ) {	 // Only the active tag drives the display and controller
 
 							// Update flag
-							shared->Target.isTargetFound		  = true;
-							arucoTagsPresent[arucoDetectedIDs[i]] = true;
+							shared->Target.isTargetFound = true;
+
+							// Remember where the tag was for the next search window
+							trackedCorners = arucoCorners[i];
+							trackedID	   = arucoDetectedIDs[i];
+							trackedDepthMM = arucoTranslationVector[2];
+							timeTracked	   = shared->Capture.timeSource;
 
 							// Update 2D pixel coordinates
-							int avgX						= int( ( currentCorner[0][0].x + currentCorner[0][1].x + currentCorner[0][2].x + currentCorner[0][3].x ) / 4.0f );
-							int avgY						= int( ( currentCorner[0][0].y + currentCorner[0][1].y + currentCorner[0][2].y + currentCorner[0][3].y ) / 4.0f );
+							int avgX						= int( ( arucoMarkerCornersPX[0].x + arucoMarkerCornersPX[1].x + arucoMarkerCornersPX[2].x + arucoMarkerCornersPX[3].x ) / 4.0f );
+							int avgY						= int( ( arucoMarkerCornersPX[0].y + arucoMarkerCornersPX[1].y + arucoMarkerCornersPX[2].y + arucoMarkerCornersPX[3].y ) / 4.0f );
 							shared->Target.screenPositionPX = cv::Point2i( avgX, avgY );
 
 							// Update 2D corner vector for active marker
-							shared->Target.cornersPX[0] = cv::Point2i( currentCorner[0][0].x, currentCorner[0][0].y );
-							shared->Target.cornersPX[1] = cv::Point2i( currentCorner[0][1].x, currentCorner[0][1].y );
-							shared->Target.cornersPX[2] = cv::Point2i( currentCorner[0][2].x, currentCorner[0][2].y );
-							shared->Target.cornersPX[3] = cv::Point2i( currentCorner[0][3].x, currentCorner[0][3].y );
+							shared->Target.cornersPX[0] = cv::Point2i( arucoMarkerCornersPX[0].x, arucoMarkerCornersPX[0].y );
+							shared->Target.cornersPX[1] = cv::Point2i( arucoMarkerCornersPX[1].x, arucoMarkerCornersPX[1].y );
+							shared->Target.cornersPX[2] = cv::Point2i( arucoMarkerCornersPX[2].x, arucoMarkerCornersPX[2].y );
+							shared->Target.cornersPX[3] = cv::Point2i( arucoMarkerCornersPX[3].x, arucoMarkerCornersPX[3].y );
 
 							// Update 3D real-world coordinates
-							shared->Target.positionUnfilteredMM = cv::Point3f( arucoTranslationVector[0][0], -arucoTranslationVector[0][1], arucoTranslationVector[0][2] );
-							shared->Target.rotationDEG			= arucoRotationVector[0][1] * RAD2DEG;
+							shared->Target.positionUnfilteredMM = positionMM;
+							shared->Target.rotationDEG			= arucoRotationVector[1] * RAD2DEG;
 						}
 
 
 					}	 // End process valid marker
-					else {
-						// shared->FLAG_TARGET_MARKER_FOUND = false;
-						shared->Controller.isRampingUp = true;
-					}
 				}	 // For loop
 
 			} else {
 				// shared->lostCount++;
 			}	 // End empty check
+
+			// Warm start only from the frame directly before
+			isPosePrevious = shared->Target.isTargetFound;
+
+			// Give the window a few frames to catch up before searching the full frame again
+			if ( shared->Target.isTargetFound ) {
+				shared->Aruco.trackingMisses = 0;
+			} else if ( shared->Aruco.isTracking && ++shared->Aruco.trackingMisses >= CONFIG_ARUCO_ROI_MAX_MISSES ) {
+				trackedCorners.clear();
+				shared->Aruco.trackingMisses = 0;
+			}
+
+			// Detection stage done for this frame
+			shared->Latency.timeDetected = std::chrono::steady_clock::now();
 		} else {
 
-			// Display error message
-			std::cout << "ArucoClass: Image not ready for processing!\n";
+			// No new frame from the capture thread yet, keep the last detection
 
 		}	 // End is frame ready
 
@@ -153,6 +223,223 @@ void ArucoClass::FindTags() {
 		shared->Target.cornersPX[1] = cv::Point2i( 0, 0 );
 		shared->Target.cornersPX[2] = cv::Point2i( 0, 0 );
 		shared->Target.cornersPX[3] = cv::Point2i( 0, 0 );
+
+		// No markers outside a task
+		shared->Target.isMarkerFound.fill( false );
+
+		// Start the next task with a full-frame search
+		trackedCorners.clear();
+		isPosePrevious				 = false;
+		shared->Aruco.isTracking	 = false;
+		shared->Aruco.trackingMisses = 0;
 	}
 
 }	 // End function
+
+
+
+/**
+ * @brief Move raw-frame marker corners into the undistorted (and optionally rotated) display space
+ *
+ * Only used in corner-space detection, where detectMarkers runs on the raw camera image. The result
+ * matches what detection on the undistorted frame would have produced, so the display and pose code
+ * downstream do not need to know which mode is active.
+ *
+ * @param corners Four marker corners, overwritten in place
+ */
+void ArucoClass::UndistortCorners( std::vector<cv::Point2f>& corners ) {
+
+	// Same camera matrix as the display remap so the pixels line up
+	cv::undistortPoints( corners, arucoCornersUndistorted, CONFIG_CAMERA_MATRIX, CONFIG_DISTORTION_COEFFS, cv::noArray(), CONFIG_CAMERA_MATRIX );
+
+	// Rotation is applied to the corners instead of the detection image
+	if ( shared->Capture.rotateCamera ) {
+		for ( cv::Point2f& corner : arucoCornersUndistorted ) {
+			corner = cv::Point2f( ( CONFIG_CAM_WIDTH - 1 ) - corner.x, ( CONFIG_CAM_HEIGHT - 1 ) - corner.y );
+		}
+	}
+
+	corners.assign( arucoCornersUndistorted.begin(), arucoCornersUndistorted.end() );
+}
+
+
+
+/**
+ * @brief Search window for the next frame, predicted from the last corners and the Kalman velocity
+ *
+ * The last bounding box is shifted by the filtered velocity projected at the last tag depth, then
+ * grown by a fixed margin, by half the expected shift, and by the expected growth when the tag moves
+ * towards the camera. Every missed frame widens the window further until the full-frame fallback.
+ *
+ * @param frameSize Size of the detection image
+ * @return cv::Rect Window in detection space, clipped to the frame
+ */
+cv::Rect ArucoClass::PredictSearchRegion( const cv::Size& frameSize ) {
+
+	// Time since the corners were seen
+	float dt = std::chrono::duration<float>( shared->Capture.timeSource - timeTracked ).count();
+	dt		 = std::clamp( dt, 0.0f, 0.1f );
+
+	// Filtered velocity in pixels per second at the tag depth
+	cv::Point3f velocityMM = shared->Target.velocityFilteredNewMM;
+	float		depthMM	   = std::max( trackedDepthMM, 1.0f );
+	cv::Point2f velocityPX( CONFIG_CAMERA_MATRIX.at<double>( 0, 0 ) * velocityMM.x / depthMM, -CONFIG_CAMERA_MATRIX.at<double>( 1, 1 ) * velocityMM.y / depthMM );
+
+	// The raw detection image is not rotated, the pose is
+	if ( shared->Capture.isGrayRaw && shared->Capture.rotateCamera ) {
+		velocityPX = -velocityPX;
+	}
+
+	// Predicted box
+	cv::Rect2f	box		 = cv::boundingRect( trackedCorners );
+	cv::Point2f shiftPX	 = velocityPX * dt;
+	float		growthPX = 0.5f * std::max( box.width, box.height ) * std::max( 0.0f, depthMM / std::max( depthMM + velocityMM.z * dt, 1.0f ) - 1.0f );
+	float		marginPX = ( CONFIG_ARUCO_ROI_MARGIN_PX + 0.5f * float( cv::norm( shiftPX ) ) + growthPX ) * ( 1 + shared->Aruco.trackingMisses );
+
+	cv::Rect region( cv::Point( int( box.x + shiftPX.x - marginPX ), int( box.y + shiftPX.y - marginPX ) ), cv::Point( int( box.br().x + shiftPX.x + marginPX ) + 1, int( box.br().y + shiftPX.y + marginPX ) + 1 ) );
+
+	// Predicted entirely off-frame, search everything
+	region &= cv::Rect( cv::Point( 0, 0 ), frameSize );
+	if ( region.empty() ) {
+		region = cv::Rect( cv::Point( 0, 0 ), frameSize );
+	}
+
+	return region;
+}
+
+
+
+/**
+ * @brief Full-frame search on a scaled image, with corners refined on the full-resolution frame
+ *
+ * Adaptive thresholding and contour search are the expensive part of detectMarkers and scale with
+ * the pixel count, so candidates are found on a 1/2^level image without refinement. The upscaled
+ * corners are then refined with cornerSubPix on the original frame, using a window no larger than
+ * half a marker cell so neighbouring bits do not pull the corner.
+ *
+ * @param frameGray Full-resolution detection image
+ * @param level Pyramid level, 1 = half and 2 = quarter resolution
+ */
+void ArucoClass::DetectPyramid( const cv::Mat& frameGray, int level ) {
+
+	const int scale = 1 << level;
+
+	// Area averaging keeps thin marker borders from aliasing away
+	cv::resize( frameGray, arucoPyramid, cv::Size( frameGray.cols / scale, frameGray.rows / scale ), 0, 0, cv::INTER_AREA );
+	arucoDetectorCoarse.detectMarkers( arucoPyramid, arucoCorners, arucoDetectedIDs );
+
+	for ( std::vector<cv::Point2f>& corners : arucoCorners ) {
+
+		// Coarse pixel centres to full-resolution pixel centres
+		for ( cv::Point2f& corner : corners ) {
+			corner = ( corner + cv::Point2f( 0.5f, 0.5f ) ) * float( scale ) - cv::Point2f( 0.5f, 0.5f );
+		}
+
+		// Shortest marker edge bounds the refinement window
+		float edgeMinPX = float( cv::norm( corners[0] - corners[3] ) );
+		for ( size_t c = 0; c < 3; c++ ) {
+			edgeMinPX = std::min( edgeMinPX, float( cv::norm( corners[c] - corners[c + 1] ) ) );
+		}
+		int halfWindow = std::clamp( 2 * scale, 2, std::max( 2, int( edgeMinPX / 12.0f ) ) );
+
+		cv::cornerSubPix( frameGray, corners, cv::Size( halfWindow, halfWindow ), cv::Size( -1, -1 ), cv::TermCriteria( cv::TermCriteria::MAX_ITER | cv::TermCriteria::EPS, arucoDetectorParams.cornerRefinementMaxIterations, arucoDetectorParams.cornerRefinementMinAccuracy ) );
+	}
+}
+
+
+
+/**
+ * @brief Marker pose from four corners, without per-call allocation in this class
+ *
+ * IPPE_SQUARE solves the square-marker case in closed form and picks the better of its two
+ * solutions. Under noise that choice can flip between frames on a nearly frontal marker, so with
+ * warm start enabled the pose is refined with Levenberg-Marquardt from the previous frame instead,
+ * which stays in the same basin. The warm-started result is only kept if it lands near the IPPE
+ * position, otherwise the tag has moved too far for the previous pose to be a useful guess.
+ *
+ * Only the active tag is warm started, the other bank markers use the closed form on its own.
+ *
+ * @param corners Marker corners in arucoPoints order
+ * @param distortion Distortion of the space the corners are in
+ * @param isActive Corners belong to the active tag
+ * @return true if a pose was found, stored in arucoRotationVector and arucoTranslationVector
+ */
+bool ArucoClass::EstimatePose( const std::vector<cv::Point2f>& corners, const cv::Mat& distortion, bool isActive ) {
+
+	auto timeStart = std::chrono::steady_clock::now();
+
+	// Closed form
+	if ( !cv::solvePnP( arucoPoints, corners, CONFIG_CAMERA_MATRIX, distortion, arucoRotationVector, arucoTranslationVector, false, cv::SOLVEPNP_IPPE_SQUARE ) ) {
+		return false;
+	}
+
+	// Iterative refinement from the previous frame
+	if ( isActive && shared->Aruco.isPoseWarmStart && isPosePrevious ) {
+
+		arucoRotationRefined	= arucoRotationPrevious;
+		arucoTranslationRefined = arucoTranslationPrevious;
+		cv::solvePnPRefineLM( arucoPoints, corners, CONFIG_CAMERA_MATRIX, distortion, arucoRotationRefined, arucoTranslationRefined, arucoRefineCriteria );
+
+		if ( cv::norm( arucoTranslationRefined - arucoTranslationVector ) < CONFIG_ARUCO_WARM_START_MAX_MM ) {
+			arucoRotationVector	   = arucoRotationRefined;
+			arucoTranslationVector = arucoTranslationRefined;
+		}
+	}
+
+	// Behind the camera
+	if ( arucoTranslationVector[2] <= 0.0 ) {
+		return false;
+	}
+
+	// Seed for the next frame
+	if ( isActive ) {
+		arucoRotationPrevious	 = arucoRotationVector;
+		arucoTranslationPrevious = arucoTranslationVector;
+		shared->Aruco.poseTimeMS = std::chrono::duration<float, std::milli>( std::chrono::steady_clock::now() - timeStart ).count();
+	}
+
+	return true;
+}
+
+
+
+/**
+ * @brief Measurement noise of the pose just estimated, from how well the tag was seen
+ *
+ * Corner noise grows with the reprojection error of the pose and with the tilt of the tag, whose
+ * edges are foreshortened. Lateral noise is that corner noise scaled to the tag's depth. Depth
+ * comes from the tag's apparent size, so its noise also grows as the tag gets smaller in the
+ * image. Large, sharp tags give a small R and a fast filter, small or blurred ones more smoothing.
+ *
+ * @param corners Marker corners the pose was estimated from
+ * @param distortion Distortion of the space the corners are in
+ * @param reprojectionPX [px] RMS reprojection error of the corners
+ * @return cv::Point3f [mm^2] Variance per axis
+ */
+cv::Point3f ArucoClass::MeasurementVariance( const std::vector<cv::Point2f>& corners, const cv::Mat& distortion, float& reprojectionPX ) {
+
+	// Corner fit
+	cv::projectPoints( arucoPoints, arucoRotationVector, arucoTranslationVector, CONFIG_CAMERA_MATRIX, distortion, arucoReprojectedPX );
+	float errorSquared = 0.0f;
+	for ( size_t c = 0; c < 4; c++ ) {
+		cv::Point2f error = corners[c] - arucoReprojectedPX[c];
+		errorSquared += error.dot( error );
+	}
+	reprojectionPX = std::sqrt( errorSquared / 4.0f );
+
+	// Tilt away from the camera, cosine of the angle between tag normal and optical axis
+	double angle   = cv::norm( arucoRotationVector );
+	double axisZ   = ( angle > 1e-9 ) ? arucoRotationVector[2] / angle : 0.0;
+	float  cosTilt = float( std::abs( std::cos( angle ) + axisZ * axisZ * ( 1.0 - std::cos( angle ) ) ) );
+
+	// Corner noise
+	float noisePX = std::hypot( CONFIG_KALMAN_CORNER_NOISE_PX, reprojectionPX ) / std::max( cosTilt, 0.25f );
+
+	// Scale to millimetres
+	float depthMM  = float( arucoTranslationVector[2] );
+	float sizePX   = std::sqrt( std::max( float( cv::contourArea( corners ) ), 1.0f ) );
+	float lateral  = noisePX * depthMM / float( CONFIG_CAMERA_MATRIX.at<double>( 0, 0 ) );
+	float depth	   = noisePX * depthMM / sizePX;
+
+	return cv::Point3f( lateral * lateral, lateral * lateral, depth * depth );
+}
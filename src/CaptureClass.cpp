@@ -5,121 +5,234 @@
 // System data manager
 #include "SystemDataManager.h"
 
+// Trace events
+#include "TraceClass.h"
+
 // Constructor
 CaptureClass::CaptureClass( SystemDataManager& ctx )
 	: dataHandle( ctx )
-	, shared( ctx.getData() ) {
+	, shared( ctx.getData() )
+	, Undistort( ctx ) { }
+
 
-	Initialize();
+/**
+ * @brief Open the configured frame source, a recording if one is set, otherwise the camera
+ *
+ * Not done in the constructor, so command line options can pick the source first.
+ *
+ * @return true if the source opened
+ */
+bool CaptureClass::Initialize() {
+
+	if ( !CONFIG_CAPTURE_REPLAY_PATH.empty() ) {
+		return SetSource( std::make_unique<RecordedSourceClass>( CONFIG_CAPTURE_REPLAY_PATH, ( CONFIG_CAPTURE_REPLAY_REAL_TIME ? replayModeEnum::REAL_TIME : replayModeEnum::AS_FAST_AS_POSSIBLE ), CONFIG_CAPTURE_REPLAY_LOOP ) );
+	}
+	return SetSource( std::make_unique<LiveSourceClass>( CONFIG_CAPTURE_DEVICE ) );
 }
 
 
-void CaptureClass::Initialize() {
+/**
+ * @brief Replace the frame source, only allowed while the capture thread is stopped
+ *
+ * @param source New source, opened here
+ * @return true if the source opened
+ */
+bool CaptureClass::SetSource( std::unique_ptr<FrameSourceClass> source ) {
 
+	if ( isCaptureRunning ) {
+		std::cout << "CaptureClass: Stop capture before changing the frame source.\n";
+		return false;
+	}
 
+	// Release previous source
+	if ( Source ) {
+		Source->Close();
+	}
 
-	// Configure OpenCV Optimizations
-	cv::setUseOptimized( true );
+	// Open new source
+	Source							 = std::move( source );
+	shared->Capture.isSourceFinished = false;
+	shared->Capture.sourceName		 = Source->Describe();
 
-	// Initialize undistort map tool
-	cv::initUndistortRectifyMap( CONFIG_CAMERA_MATRIX, CONFIG_DISTORTION_COEFFS, cv::Mat(), CONFIG_CAMERA_MATRIX, shared->Capture.frameRaw.size(), CV_32F, shared->Capture.matRemap1, shared->Capture.matRemap2 );
+	return Source->Open();
+}
 
-	// Try catch to open camera device
-	try {
-		// Capture device
-		Capture.open( "/dev/video0", cv::CAP_V4L2 );
 
-		// Capture settings
-		Capture.set( cv::CAP_PROP_FOURCC, cv::VideoWriter::fourcc( 'M', 'J', 'P', 'G' ) );
-		Capture.set( cv::CAP_PROP_FRAME_WIDTH, CONFIG_CAM_WIDTH );
-		Capture.set( cv::CAP_PROP_FRAME_HEIGHT, CONFIG_CAM_HEIGHT );
-		Capture.set( cv::CAP_PROP_FPS, CONFIG_CAM_FRAMERATE );
-		Capture.set( cv::CAP_PROP_HW_ACCELERATION, cv::VIDEO_ACCELERATION_ANY );
+/**
+ * @brief Stop the capture thread when the object goes out of scope
+ */
+CaptureClass::~CaptureClass() {
+	Close();
+}
 
-		// Camera settings
-		Capture.set( cv::CAP_PROP_BRIGHTNESS, CONFIG_CAM_BRIGHTNESS );
 
-		Capture.set( cv::CAP_PROP_CONTRAST, CONFIG_CAM_CONTRAST );
-		Capture.set( cv::CAP_PROP_SATURATION, CONFIG_CAM_SATURATION );
-		Capture.set( cv::CAP_PROP_HUE, CONFIG_CAM_HUE );
-		Capture.set( cv::CAP_PROP_AUTO_WB, CONFIG_CAM_AUTO_WHITEBALANCE );
-		Capture.set( cv::CAP_PROP_GAMMA, CONFIG_CAM_GAMMA );
-		Capture.set( cv::CAP_PROP_GAIN, CONFIG_CAM_GAIN );
-		Capture.set( cv::CAP_PROP_SHARPNESS, CONFIG_CAM_SHARPNESS );
-		Capture.set( cv::CAP_PROP_BACKLIGHT, CONFIG_CAM_BACKLIGHT );
-		Capture.set( cv::CAP_PROP_AUTO_EXPOSURE, CONFIG_CAM_AUTO_EXPOSURE );
-		Capture.set( cv::CAP_PROP_EXPOSURE, CONFIG_CAM_EXPOSURE_LEVEL );
-		Capture.set( cv::CAP_PROP_PAN, CONFIG_CAM_PAN );
-		Capture.set( cv::CAP_PROP_TILT, CONFIG_CAM_TILT );
-		Capture.set( cv::CAP_PROP_FOCUS, CONFIG_CAM_FOCUS_LEVEL );
-		Capture.set( cv::CAP_PROP_AUTOFOCUS, CONFIG_CAM_AUTO_FOCUS );
-		Capture.set( cv::CAP_PROP_ZOOM, CONFIG_CAM_ZOOM );
+/**
+ * @brief Pre-allocate the frame slots and launch the capture thread
+ */
+void CaptureClass::Start() {
 
+	// Already running, or nothing to read from
+	if ( isCaptureRunning ) {
+		return;
+	}
+	if ( !Source || !Source->IsOpen() ) {
+		std::cout << "CaptureClass: No open frame source, capture thread not started.\n";
+		return;
+	}
 
-		// Ensure capture devices open and running
-		if ( !Capture.isOpened() ) {
-			std::cerr << "Error: Could not open the camera." << std::endl;
-		}
-	} catch ( cv::Exception& e ) {
-		std::cout << "Exception in CameraInterface::Begin(): " << e.msg << "\n";
+	// Allocate every slot up front so the capture thread never reallocates
+	for ( CaptureFrameStruct& frame : frameBuffer.Slots() ) {
+		frame.frameRaw	= cv::Mat( CONFIG_CAM_HEIGHT, CONFIG_CAM_WIDTH, CV_8UC3 );
+		frame.frameGray = cv::Mat( CONFIG_CAM_HEIGHT, CONFIG_CAM_WIDTH, CV_8UC1 );
+	}
+	for ( cv::Mat& frameUndistorted : displayBuffer.Slots() ) {
+		frameUndistorted = cv::Mat( CONFIG_CAM_HEIGHT, CONFIG_CAM_WIDTH, CV_8UC3 );
 	}
 
-	// Output confirmation
-	std::cout << "CaptureClass: Camera initialized at ( " << Capture.get( cv::CAP_PROP_FRAME_HEIGHT ) << " x " << Capture.get( cv::CAP_PROP_FRAME_WIDTH ) << " ) @ " << Capture.get( cv::CAP_PROP_FPS ) << " fps, mode = " << Capture.get( cv::CAP_PROP_BACKEND )
-			  << " , Accel = " << Capture.get( cv::CAP_PROP_HW_ACCELERATION ) << "\n";
+	// Launch thread
+	isCaptureRunning = true;
+	captureThread	 = std::thread( &CaptureClass::CaptureLoop, this );
+
+	std::cout << "CaptureClass: Capture thread started on " << shared->Capture.sourceName << ".\n";
 }
 
+
 /**
- * @brief Captures the latest frame
+ * @brief Stop the capture thread and release the camera
  */
-void CaptureClass::GetFrame() {
+void CaptureClass::Close() {
+
+	// Signal thread and wait for the current grab to finish
+	isCaptureRunning = false;
+	if ( captureThread.joinable() ) {
+		captureThread.join();
+		std::cout << "CaptureClass: Capture thread stopped.\n";
+	}
+
+	// Release source
+	if ( Source ) {
+		Source->Close();
+	}
+}
 
-	// Reset flag
-	shared->Capture.isFrameReady = false;
 
-	// Capture latest frame
-	Capture.grab();
-	Capture.retrieve( shared->Capture.frameRaw );
+/**
+ * @brief Capture thread body, grabs and processes frames as fast as the camera delivers them
+ */
+void CaptureClass::CaptureLoop() {
 
-	// Make sure frame isn't empty
-	if ( !shared->Capture.frameRaw.empty() ) {
+	while ( isCaptureRunning ) {
 
-		// Upload mats to GPU
-		shared->Capture.GpuMatFrameRaw.upload( shared->Capture.frameRaw );
-		shared->Capture.GpuMatRemap1.upload( shared->Capture.matRemap1 );
-		shared->Capture.GpuMatRemap2.upload( shared->Capture.matRemap2 );
+		// Slot owned by this thread until published
+		CaptureFrameStruct& frame = frameBuffer.WriteBuffer();
 
-		// Remap using GPU
-		cv::cuda::remap( shared->Capture.GpuMatFrameRaw, shared->Capture.GpuMatFrameUndistorted, shared->Capture.GpuMatRemap1, shared->Capture.GpuMatRemap2, cv::INTER_NEAREST );
+		// Block on the source here instead of in the main loop
+		bool isFrameRead = false;
+		{
+			TraceScope trace( shared->Trace, traceLaneEnum::CAPTURE, traceEventEnum::FRAME_READ );
+			isFrameRead = Source->Read( frame.frameRaw, frame.timeGrabbed, frame.timeSource );
+		}
+		if ( !isFrameRead ) {
+			if ( Source->IsFinished() ) {
+				shared->Capture.isSourceFinished = true;
+			}
+			std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+			continue;
+		}
 
-		// Convert to grayscale using GPU
-		cv::cuda::cvtColor( shared->Capture.GpuMatFrameUndistorted, shared->Capture.GpuMatFrameGray, cv::COLOR_BGR2GRAY );
+		// Make sure frame isn't empty
+		if ( frame.frameRaw.empty() ) {
+			std::cerr << "CaptureClass: Captured frame is empty!\n";
+			std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+			continue;
+		}
 
+		// Remap tables are built for the configured camera size, recordings must match
+		if ( frame.frameRaw.cols != CONFIG_CAM_WIDTH || frame.frameRaw.rows != CONFIG_CAM_HEIGHT || frame.frameRaw.type() != CV_8UC3 ) {
+			std::cerr << "CaptureClass: Frame from " << Source->Describe() << " does not match the configured camera format!\n";
+			std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+			continue;
+		}
 
+		// In corner-space mode the display image is only rebuilt every few frames
+		const bool isRawDetection  = ( shared->Capture.detectionSpace == detectionSpaceEnum::RAW_CORNERS );
+		const bool isColorRequired = shared->Capture.isColorRequested && ( !isRawDetection || ( frameCounter % CONFIG_CAPTURE_DISPLAY_INTERVAL ) == 0 );
 
-		// Extract frames from GPU
-		shared->Capture.GpuMatFrameUndistorted.download( shared->Capture.matFrameUndistorted );
-		shared->Capture.GpuMatFrameGray.download( shared->Capture.frameGray );
+		// Undistort and convert
+		frame.isGrayRaw = isRawDetection;
+		ProcessFrame( frame, displayBuffer.WriteBuffer(), isColorRequired );
 
-		// Rotate 180 degrees on GPU (flip both axes)
-		if ( shared->Capture.rotateCamera ) {
-			cv::flip( shared->Capture.frameGray, shared->Capture.frameGray, -1 );
-			cv::flip( shared->Capture.matFrameUndistorted, shared->Capture.matFrameUndistorted, -1 );
+		// Hand off to main loop
+		frame.frameNumber = ++frameCounter;
+		frameBuffer.Publish();
+		if ( isColorRequired ) {
+			displayBuffer.Publish();
 		}
 
+		// Wake the main loop
+		{
+			std::lock_guard<std::mutex> lock( frameMutex );
+			framesPublished++;
+		}
+		frameSignal.notify_one();
+	}
+}
 
-		// brightness: shift (beta), contrast: scale (alpha)
-		double alpha = 1.4;	   // contrast (1.0 = no change)
-		double beta	 = 100;	   // brightness (0 = no change)
 
-		// // Apply contrast and brightness adjustment
-		shared->Capture.frameGray.convertTo( shared->Capture.frameGray, -1, alpha, beta );
+/**
+ * @brief Prepare the detection image and, when asked for, the undistorted display image
+ *
+ * @param frame Slot owned by the capture thread
+ * @param frameUndistorted Display slot owned by the capture thread
+ * @param isColorRequired Build the display image for this frame
+ */
+void CaptureClass::ProcessFrame( CaptureFrameStruct& frame, cv::Mat& frameUndistorted, bool isColorRequired ) {
 
-		// Update flag
-		shared->Capture.isFrameReady = true;
+	TraceScope trace( shared->Trace, traceLaneEnum::CAPTURE, traceEventEnum::FRAME_PROCESS );
 
+	if ( frame.isGrayRaw ) {
+		Undistort.ProcessRaw( frame.frameRaw, frameUndistorted, frame.frameGray, isColorRequired );
 	} else {
-		std::cerr << "CaptureClass: Captured frame is empty!\n";
+		Undistort.Process( frame.frameRaw, frameUndistorted, frame.frameGray, isColorRequired );
+	}
+}
+
+
+/**
+ * @brief Takes the newest frame finished by the capture thread
+ *
+ * Waits up to CONFIG_CAPTURE_WAIT_MS when none is ready, so the main loop runs once per frame
+ * instead of spinning, and the controller and serial send that follow it keep the frame rate.
+ */
+void CaptureClass::GetFrame() {
+
+	// Sleep until the capture thread publishes, or give up so input stays responsive
+	{
+		std::unique_lock<std::mutex> lock( frameMutex );
+		frameSignal.wait_for( lock, std::chrono::milliseconds( CONFIG_CAPTURE_WAIT_MS ), [&]() { return framesPublished != framesTaken || !isCaptureRunning; } );
+		framesTaken = framesPublished;
+	}
+
+	// Display image is published separately and may lag the detection image
+	if ( displayBuffer.Acquire() ) {
+		shared->Capture.matFrameUndistorted = displayBuffer.ReadBuffer();
+	}
+
+	// Nothing new since the last call
+	if ( !frameBuffer.Acquire() ) {
 		shared->Capture.isFrameReady = false;
+		return;
 	}
+
+	// Borrow the slot, it stays valid until the next successful Acquire()
+	CaptureFrameStruct& frame	= frameBuffer.ReadBuffer();
+	shared->Capture.frameRaw	= frame.frameRaw;
+	shared->Capture.frameGray	= frame.frameGray;
+	shared->Capture.isGrayRaw	= frame.isGrayRaw;
+	shared->Capture.timeGrabbed = frame.timeGrabbed;
+	shared->Capture.timeSource	= frame.timeSource;
+	shared->Capture.frameNumber = frame.frameNumber;
+
+	// Update flag
+	shared->Capture.isFrameReady = true;
 }
@@ -0,0 +1,187 @@
+// Call to class header
+#include "ControlLoopClass.h"
+
+// Real-time priority
+#include <pthread.h>
+#include <sched.h>
+
+// System data manager
+#include "SystemDataManager.h"
+
+// Serial send
+#include "SerialClass.h"
+
+// Trace events
+#include "TraceClass.h"
+
+
+/**
+ * @brief Constructor
+ */
+ControlLoopClass::ControlLoopClass( SystemDataManager& ctx, ControllerClass& controller, SerialClass& serial )
+	: dataHandle( ctx )
+	, shared( ctx.getData() )
+	, Controller( controller )
+	, Serial( serial ) { }
+
+
+
+/**
+ * @brief Stop the control thread when the object goes out of scope
+ */
+ControlLoopClass::~ControlLoopClass() {
+	Close();
+}
+
+
+
+/**
+ * @brief Launch the control thread, at real-time priority when the system allows it
+ */
+void ControlLoopClass::Start() {
+
+	// Already running
+	if ( isControlRunning ) {
+		return;
+	}
+
+	// First tick already has settings to work with
+	settingsBuffer.WriteBuffer() = Controller.ReadSettings();
+	settingsBuffer.Publish();
+
+	// Launch thread
+	nTicks			 = 0;
+	nTicksLate		 = 0;
+	isControlRunning = true;
+	controlThread	 = std::thread( &ControlLoopClass::ControlLoop, this );
+
+	// Keep the tick on time while the main loop detects and draws
+	sched_param param;
+	param.sched_priority = sched_get_priority_max( SCHED_FIFO );
+	if ( pthread_setschedparam( controlThread.native_handle(), SCHED_FIFO, &param ) != 0 ) {
+		std::cout << "ControlLoopClass: Could not set real-time priority, running at normal priority.\n";
+	}
+
+	std::cout << "ControlLoopClass: Control thread started at " << CONFIG_CONTROL_RATE_HZ << " Hz.\n";
+}
+
+
+
+/**
+ * @brief Stop the control thread and report how many ticks ran late
+ */
+void ControlLoopClass::Close() {
+
+	isControlRunning = false;
+	if ( controlThread.joinable() ) {
+		controlThread.join();
+		std::cout << "ControlLoopClass: Control thread stopped, " << nTicksLate << " of " << nTicks << " ticks late.\n";
+	}
+}
+
+
+
+/**
+ * @brief Hand the newest target state to the control thread, main loop only
+ */
+void ControlLoopClass::Post( const ControlInputStruct& input ) {
+
+	if ( !isControlRunning ) {
+		Controller.SetInput( input );
+		return;
+	}
+
+	inputBuffer.WriteBuffer() = input;
+	inputBuffer.Publish();
+}
+
+
+
+/**
+ * @brief Once per main loop, settings in and the latest result out, or a whole tick without the thread
+ */
+void ControlLoopClass::Update() {
+
+	// Gains, flags and amplifier feedback as of this loop
+	const ControlSettingsStruct settings = Controller.ReadSettings();
+
+	if ( !isControlRunning ) {
+		Controller.SetSettings( settings );
+		Controller.Update();
+		TraceTick( Serial.Send( traceLaneEnum::MAIN, settings, Controller.GetOutput() ) );
+		Controller.WriteOutput( Controller.GetOutput() );
+		return;
+	}
+
+	settingsBuffer.WriteBuffer() = settings;
+	settingsBuffer.Publish();
+
+	// Result of the latest tick, for the display and logger
+	if ( outputBuffer.Acquire() ) {
+		Controller.WriteOutput( outputBuffer.ReadBuffer() );
+	}
+}
+
+
+
+/**
+ * @brief Control thread body, one controller update and serial send per tick
+ */
+void ControlLoopClass::ControlLoop() {
+
+	using namespace std::chrono;
+
+	const steady_clock::duration period	  = duration_cast<steady_clock::duration>( duration<double>( 1.0 / CONFIG_CONTROL_RATE_HZ ) );
+	steady_clock::time_point	 timeNext = steady_clock::now();
+
+	while ( isControlRunning ) {
+
+		{
+			TraceScope trace( shared->Trace, traceLaneEnum::CONTROL, traceEventEnum::CONTROL_TICK );
+
+			// Newest frame and settings, if they arrived since the last tick
+			if ( inputBuffer.Acquire() ) {
+				Controller.SetInput( inputBuffer.ReadBuffer() );
+			}
+			if ( settingsBuffer.Acquire() ) {
+				Controller.SetSettings( settingsBuffer.ReadBuffer() );
+			}
+
+			Controller.Update();
+			TraceTick( Serial.Send( traceLaneEnum::CONTROL, settingsBuffer.ReadBuffer(), Controller.GetOutput() ) );
+
+			// Result back to the main loop
+			outputBuffer.WriteBuffer() = Controller.GetOutput();
+			outputBuffer.Publish();
+		}
+		nTicks++;
+
+		// Fixed rate, start over from now instead of bursting when a tick ran long
+		timeNext += period;
+		if ( steady_clock::now() > timeNext ) {
+			nTicksLate++;
+			timeNext = steady_clock::now();
+		} else {
+			std::this_thread::sleep_until( timeNext );
+		}
+	}
+}
+
+
+
+/**
+ * @brief Hand the stamps of the first tick on a frame to LatencyClass, tagged with the frame's grab time
+ *
+ * @param timeSent Serial write time of the tick, default if nothing went out
+ */
+void ControlLoopClass::TraceTick( std::chrono::steady_clock::time_point timeSent ) {
+
+	const ControlOutputStruct& result = Controller.GetOutput();
+	if ( result.timeCaptured == timeTraced ) {
+		return;
+	}
+	timeTraced = result.timeCaptured;
+
+	// Dropped if LatencyClass falls behind, the frame then goes untraced
+	shared->Latency.controlStamps.Push( { result.timeCaptured, result.timeControlled, timeSent } );
+}
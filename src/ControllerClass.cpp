@@ -1,56 +1,169 @@
 #include "ControllerClass.h"
 #include "SystemDataManager.h"
 
+// Gains file
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <sstream>
+
 ControllerClass::ControllerClass( SystemDataManager& ctx )
 	: dataHandle( ctx )
 	, shared( ctx.getData() ) {
-	//
+
+	BuildAllocationTable();
 }
 
 
 
-void ControllerClass::Update() {
+/**
+ * @brief Take a new target state from the vision side
+ *
+ * Called from the thread that runs Update(), either the main loop or the control thread after
+ * taking the state out of its mailbox.
+ */
+void ControllerClass::SetInput( const ControlInputStruct& newInput ) {
 
-	// 4D version
+	input		 = newInput;
+	isInputFresh = true;
+}
 
-	// Reset ramp if target was reset
-	if ( shared->Target.isTargetReset ) {
 
-		shared->Controller.rampPercentage = 0.0f;
-		shared->Controller.rampStartTime  = shared->Timing.elapsedRunningTime;
-	}
 
-	// Ramp-up value
-	if ( shared->Controller.isRampingUp && shared->Target.isTargetFound ) {
-		float elapsed					  = shared->Timing.elapsedRunningTime - shared->Controller.rampStartTime;
-		shared->Controller.rampPercentage = std::clamp( elapsed / shared->Controller.rampDurationTime, 0.0f, 1.0f );
+/**
+ * @brief Take new gains, flags and amplifier feedback from the main loop, same thread rules as SetInput()
+ */
+void ControllerClass::SetSettings( const ControlSettingsStruct& newSettings ) {
 
-		if ( shared->Controller.rampPercentage >= 1.0f ) {
-			shared->Controller.isRampingUp = false;
-		}
+	settings = newSettings;
+}
+
+
+
+/**
+ * @brief Everything Update() and the serial send read from shared data, gathered on the main loop
+ *
+ * Only the main loop writes these, so the control thread works on a consistent copy instead of
+ * reading them while the input handler changes them.
+ */
+ControlSettingsStruct ControllerClass::ReadSettings() const {
+
+	ControlSettingsStruct result;
+
+	// Controller
+	result.gainKp			   = shared->Controller.gainKp;
+	result.gainKi			   = shared->Controller.gainKi;
+	result.gainKd			   = shared->Controller.gainKd;
+	result.integralDecay	   = shared->Controller.integralDecay;
+	result.rampDurationTime	   = shared->Controller.rampDurationTime;
+	result.nRampRequests	   = shared->Controller.nRampRequests;
+	result.isPredictionEnabled = shared->Controller.isPredictionEnabled;
+	result.sendP50MS		   = shared->Latency.sendP50MS;
+	result.packetDelayMS	   = float( shared->Serial.packetDelay );
+	result.isTensionOnly	   = shared->Amplifier.isTensionOnly;
+	result.commandedTensionABC = shared->Controller.commandedTensionABC;
+	result.commandedLimits	   = shared->Amplifier.commandedLimits;
+	result.isOverLimitA		   = shared->Amplifier.isOverLimitA;
+	result.isOverLimitB		   = shared->Amplifier.isOverLimitB;
+	result.isOverLimitC		   = shared->Amplifier.isOverLimitC;
+
+	// Serial send
+	result.isSending		  = shared->Serial.isSerialSendOpen && shared->Serial.isSerialSending;
+	result.state			  = shared->System.state;
+	result.isAmplifierActive  = shared->Amplifier.isAmplifierActive;
+	result.isReverseRequested = shared->Controller.toggleReverse && shared->Task.isRunning;
+	result.isReverseConstant  = shared->Amplifier.isReverseConstant;
+
+	return result;
+}
+
+
+
+/**
+ * @brief Copy a control tick's result into shared data for the display, tasks and logger
+ */
+void ControllerClass::WriteOutput( const ControlOutputStruct& result ) {
+
+	shared->Target.positionPredictedMM		  = result.positionPredictedMM;
+	shared->Target.predictionHorizonMS		  = result.predictionHorizonMS;
+	shared->Controller.proportionalTerm		  = result.proportionalTerm;
+	shared->Controller.integralTerm			  = result.integralTerm;
+	shared->Controller.derivativeTerm		  = result.derivativeTerm;
+	shared->Controller.combinedPIDTerms		  = result.combinedPIDTerms;
+	shared->Controller.percentageProportional = result.percentageProportional;
+	shared->Controller.percentageIntegral	  = result.percentageIntegral;
+	shared->Controller.percentageDerivative	  = result.percentageDerivative;
+	shared->Controller.commandedPercentageABC = result.commandedPercentageABC;
+	shared->Controller.commandedCurrentABC	  = result.commandedCurrentABC;
+	shared->Controller.commandedPwmABC		  = result.commandedPwmABC;
+	shared->Controller.rampPercentage		  = result.rampPercentage;
+	shared->Controller.isRampingUp			  = result.isRampingUp;
+}
+
+
+
+/**
+ * @brief Propagate the filtered target state to when the next command reaches the motors
+ *
+ * The horizon is the age of the frame so far, the median control-to-send time and the serial
+ * packet delay, capped at CONFIG_PREDICTION_MAX_MS. Between frames the horizon grows, so a fast
+ * control loop keeps following the target on the constant-velocity model.
+ */
+void ControllerClass::Predict( std::chrono::steady_clock::time_point timeNow ) {
+
+	float horizonMS = 0.0f;
+	if ( settings.isPredictionEnabled && input.isTargetFound ) {
+		float frameAgeMS = std::chrono::duration<float, std::milli>( timeNow - input.timeCaptured ).count();
+		horizonMS		 = std::clamp( frameAgeMS + settings.sendP50MS + settings.packetDelayMS, 0.0f, CONFIG_PREDICTION_MAX_MS );
 	}
 
-	if ( shared->Target.isTargetFound ) {
+	output.predictionHorizonMS = horizonMS;
+	output.positionPredictedMM = input.positionFilteredMM + input.velocityFilteredMM * ( horizonMS / 1000.0f );
+}
+
+
+
+void ControllerClass::Update() {
+
+	Update( std::chrono::steady_clock::now() );
+}
+
+
+
+/**
+ * @brief Controller update at a given time, frame ages are measured against timeNow
+ */
+void ControllerClass::Update( std::chrono::steady_clock::time_point timeNow ) {
+
+	// 4D version
+
+	// Act on the position predicted to actuation time
+	Predict( timeNow );
+
+	// Ramp-up value
+	RampUp( timeNow );
+
+	if ( input.isTargetFound ) {
 
 
 		// Proportional AB+AD / FLEX+EXT
-		shared->Target.positionFilteredNewMM.x < 0 ? ( shared->Controller.proportionalTerm.x = shared->Controller.gainKp.abd * shared->Target.positionFilteredNewMM.x ) : ( shared->Controller.proportionalTerm.x = shared->Controller.gainKp.add * shared->Target.positionFilteredNewMM.x );
-		shared->Target.positionFilteredNewMM.y < 0 ? ( shared->Controller.proportionalTerm.y = shared->Controller.gainKp.flx * shared->Target.positionFilteredNewMM.y ) : ( shared->Controller.proportionalTerm.y = shared->Controller.gainKp.ext * shared->Target.positionFilteredNewMM.y );
+		output.positionPredictedMM.x < 0 ? ( output.proportionalTerm.x = settings.gainKp.abd * output.positionPredictedMM.x ) : ( output.proportionalTerm.x = settings.gainKp.add * output.positionPredictedMM.x );
+		output.positionPredictedMM.y < 0 ? ( output.proportionalTerm.y = settings.gainKp.flx * output.positionPredictedMM.y ) : ( output.proportionalTerm.y = settings.gainKp.ext * output.positionPredictedMM.y );
 
 		// Calculate derivative term
-		// shared->Target.velocityFilteredNewMM.x < 0 ? ( shared->Controller.derivativeTerm.x = -shared->Controller.gainKd.abd * shared->Target.velocityFilteredNewMM.x ) : ( shared->Controller.derivativeTerm.x = shared->Controller.gainKd.add * shared->Target.velocityFilteredNewMM.x );
-		// shared->Target.velocityFilteredNewMM.y < 0 ? ( shared->Controller.derivativeTerm.y = shared->Controller.gainKd.flx * shared->Target.velocityFilteredNewMM.y ) : ( shared->Controller.derivativeTerm.y = shared->Controller.gainKd.ext * shared->Target.velocityFilteredNewMM.y );
+		// shared->Target.velocityFilteredNewMM.x < 0 ? ( output.derivativeTerm.x = -settings.gainKd.abd * shared->Target.velocityFilteredNewMM.x ) : ( output.derivativeTerm.x = settings.gainKd.add * shared->Target.velocityFilteredNewMM.x );
+		// shared->Target.velocityFilteredNewMM.y < 0 ? ( output.derivativeTerm.y = settings.gainKd.flx * shared->Target.velocityFilteredNewMM.y ) : ( output.derivativeTerm.y = settings.gainKd.ext * shared->Target.velocityFilteredNewMM.y );
 
 		
 
 
 		// Direction to target
-		cv::Point2f posError	= cv::Point2f( shared->Target.positionFilteredNewMM.x, shared->Target.positionFilteredNewMM.y );
+		cv::Point2f posError	= cv::Point2f( output.positionPredictedMM.x, output.positionPredictedMM.y );
 		float		posNorm		= cv::norm( posError ) + 1e-6f;	   // prevent div-by-zero
 		cv::Point2f dirToTarget = posError * ( 1.0f / posNorm );
 
 		// Velocity
-		cv::Point2f velocity = cv::Point2f( shared->Target.velocityFilteredNewMM.x, shared->Target.velocityFilteredNewMM.y );
+		cv::Point2f velocity = cv::Point2f( input.velocityFilteredMM.x, input.velocityFilteredMM.y );
 
 		// Project velocity onto direction to target
 		float vTowardTarget = velocity.dot( dirToTarget );
@@ -59,34 +172,46 @@ void ControllerClass::Update() {
 		if ( vTowardTarget < 0.0f ) {
 			// You can adjust this to use axis-specific Kd like you had
 
-			shared->Target.positionFilteredNewMM.x < 0 ? ( shared->Controller.derivativeTerm.x = vTowardTarget * shared->Controller.gainKd.abd * dirToTarget.x ) : ( shared->Controller.derivativeTerm.x = vTowardTarget * shared->Controller.gainKd.add * dirToTarget.x );
-			shared->Target.positionFilteredNewMM.y < 0 ? ( shared->Controller.derivativeTerm.y = vTowardTarget * shared->Controller.gainKd.flx * dirToTarget.y ) : ( shared->Controller.derivativeTerm.y = vTowardTarget * shared->Controller.gainKd.ext * dirToTarget.y );
-			// shared->Controller.derivativeTerm = cv::Point3f( vTowardTarget * shared->Controller.gainKd.abd * dirToTarget.x, vTowardTarget * shared->Controller.gainKd.flx * dirToTarget.y, 0.0f );
+			output.positionPredictedMM.x < 0 ? ( output.derivativeTerm.x = vTowardTarget * settings.gainKd.abd * dirToTarget.x ) : ( output.derivativeTerm.x = vTowardTarget * settings.gainKd.add * dirToTarget.x );
+			output.positionPredictedMM.y < 0 ? ( output.derivativeTerm.y = vTowardTarget * settings.gainKd.flx * dirToTarget.y ) : ( output.derivativeTerm.y = vTowardTarget * settings.gainKd.ext * dirToTarget.y );
+			// output.derivativeTerm = cv::Point3f( vTowardTarget * settings.gainKd.abd * dirToTarget.x, vTowardTarget * settings.gainKd.flx * dirToTarget.y, 0.0f );
 		} else {
-			shared->Controller.derivativeTerm = cv::Point3f( 0.0f, 0.0f, 0.0f );
+			output.derivativeTerm = cv::Point3f( 0.0f, 0.0f, 0.0f );
 		}
 
 
 
 		// Calculate integral term
-		shared->Target.positionIntegratedMM.x < 0 ? ( shared->Controller.integralTerm.x = shared->Controller.gainKi.abd * shared->Target.positionIntegratedMM.x ) : ( shared->Controller.integralTerm.x = shared->Controller.gainKi.add * shared->Target.positionIntegratedMM.x );
-		shared->Target.positionIntegratedMM.y < 0 ? ( shared->Controller.integralTerm.y = shared->Controller.gainKi.flx * shared->Target.positionIntegratedMM.y ) : ( shared->Controller.integralTerm.y = shared->Controller.gainKi.ext * shared->Target.positionIntegratedMM.y );
+		input.positionIntegratedMM.x < 0 ? ( output.integralTerm.x = settings.gainKi.abd * input.positionIntegratedMM.x ) : ( output.integralTerm.x = settings.gainKi.add * input.positionIntegratedMM.x );
+		input.positionIntegratedMM.y < 0 ? ( output.integralTerm.y = settings.gainKi.flx * input.positionIntegratedMM.y ) : ( output.integralTerm.y = settings.gainKi.ext * input.positionIntegratedMM.y );
 
 		// Sum terms (working)
-		shared->Controller.combinedPIDTerms = ( shared->Controller.proportionalTerm + shared->Controller.integralTerm + shared->Controller.derivativeTerm ) * shared->Controller.rampPercentage;
+		output.combinedPIDTerms = ( output.proportionalTerm + output.integralTerm + output.derivativeTerm ) * output.rampPercentage;
 
 
-	} else {
-		shared->Controller.proportionalTerm *= 0.9f;
-		shared->Controller.integralTerm *= 0.9f;
-		shared->Controller.derivativeTerm *= 0.9f;
-		shared->Controller.combinedPIDTerms = ( shared->Controller.proportionalTerm + shared->Controller.integralTerm + shared->Controller.derivativeTerm ) * shared->Controller.rampPercentage;
+	} else if ( isInputFresh ) {
+
+		// Decay once per frame, however often the controller runs
+		output.proportionalTerm *= 0.9f;
+		output.integralTerm *= settings.integralDecay;
+		output.derivativeTerm *= 0.9f;
+		output.combinedPIDTerms = ( output.proportionalTerm + output.integralTerm + output.derivativeTerm ) * output.rampPercentage;
 	}
-	// Calculate motor contributions
-	MapToContributionABC( shared->Controller.combinedPIDTerms );
-	shared->Controller.percentageProportional = MapToContributionTerm( shared->Controller.proportionalTerm );
-	shared->Controller.percentageIntegral	  = MapToContributionTerm( shared->Controller.integralTerm );
-	shared->Controller.percentageDerivative	  = MapToContributionTerm( shared->Controller.derivativeTerm );
+	// Calculate motor contributions, all terms in one pass
+	const cv::Point3f terms[] = { output.combinedPIDTerms, output.proportionalTerm, output.integralTerm, output.derivativeTerm };
+	cv::Point3f		  shares[4];
+	AllocateTerms( terms, shares, 4 );
+
+	contribution = shares[0];
+	MapToMotors();
+	output.percentageProportional = shares[1];
+	output.percentageIntegral	  = shares[2];
+	output.percentageDerivative	  = shares[3];
+
+	// Control stage done, for the frame the input came from
+	output.timeCaptured	  = input.timeCaptured;
+	output.timeControlled = std::chrono::steady_clock::now();
+	isInputFresh = false;
 }
 
 
@@ -122,150 +247,197 @@ void ControllerClass::UpdateAmplifier() {
 
 
 /**
- * @brief Maps the controller PID values to motor output values
- * 
+ * @brief Sample the motor shares over the direction angle, once at construction
+ *
+ * The shares are linear in the angle between two motors, and the motor angles fall on sample
+ * points, so interpolating the table reproduces the sector formulas. Angles are in the same
+ * DEG2RAD steps as thA, thB and thC. Only the two motors of the sector pull, the third is zero.
  */
-void ControllerClass::MapToContributionABC( cv::Point3f terms ) {
+void ControllerClass::BuildAllocationTable() {
 
-	// Old (no PID)
-	// Calculate error angle for motor selection
-	thTarget = std::atan2( terms.y, terms.x );
-	rTarget	 = cv::norm( cv::Vec2f( terms.x, terms.y ) );
+	for ( int i = 0; i <= ALLOCATION_STEPS; i++ ) {
 
-	// Calculate max strength
-	rMax = std::clamp( float( std::atan2( rTarget, shared->Target.positionFilteredNewMM.z ) ), 0.0f, float( 40.0 * DEG2RAD ) ) / ( 40.0 * DEG2RAD );
+		float		th	  = ( float( i ) / ALLOCATION_STEPS_PER_DEG ) * DEG2RAD;
+		cv::Point3f share = cv::Point3f( 0.0f, 0.0f, 0.0f );
 
-	// Wrap angle within 0-360 deg
-	if ( thTarget < 0 ) {
-		thTarget += ( 360.0f * DEG2RAD );
-	}
+		if ( th >= thC || th < thA ) {
 
-	// Determine angle and calculate contributions
-	if ( thTarget >= ( 270 * DEG2RAD ) || thTarget < ( 35 * DEG2RAD ) ) {
+			// Wrap-around for 360/0 deg, motors AC
+			float thCT = ( th < thA ) ? thAC - ( thA - th ) : th - thC;
+			share.x	   = thCT / thAC;
+			share.z	   = 1.0f - ( thCT / thAC );
+		} else if ( th < thB ) {
 
-		// Wrap-around for 360/0 deg, calculate angles AC
-		if ( thTarget < thA ) {
-			thAT = thA - thTarget;
-			thCT = thAC - thAT;
-		}
-		if ( thTarget > thC ) {
-			thCT = thTarget - thC;
-			thAT = thAC - thCT;
+			// Motors AB
+			float thAT = th - thA;
+			share.x	   = 1.0f - ( thAT / thAB );
+			share.y	   = thAT / thAB;
+		} else {
+
+			// Motors BC
+			float thBT = th - thB;
+			share.y	   = 1.0f - ( thBT / thBC );
+			share.z	   = thBT / thBC;
 		}
 
-		// rMax		   = rMax * RAD2DEG;
-		contribution.x = ( 1.0f - ( thAT / thAC ) ) * rMax;
-		contribution.z = ( 1.0f - ( thCT / thAC ) ) * rMax;
+		allocationTable[i] = share;
+	}
+}
 
-		// Debug
-		// std::cout << "|A+C| Angle: " << shared->FormatDecimal( thTarget * RAD2DEG, 2 ) << "   Contrib: A: " << shared->FormatDecimal( contribution.x, 2 ) << " , C: " << shared->FormatDecimal( contribution.z, 2 ) << "   rMax: " << shared->FormatDecimal( rMax, 2 ) << "\n";
-	} else if ( thTarget >= ( 35 * DEG2RAD ) && thTarget < ( 145 * DEG2RAD ) ) {
 
-		// Calculate angles AB
-		thAT = thTarget - thA;
-		thBT = thAB - thAT;
 
-		contribution.x = ( 1.0f - ( thAT / thAB ) ) * rMax;
-		contribution.y = ( 1.0f - ( thBT / thAB ) ) * rMax;
+/**
+ * @brief atan2 to about 1e-5 rad, without branches so the term loop vectorizes
+ */
+static inline float FastAtan2( float y, float x ) {
+
+	float ax = std::abs( x );
+	float ay = std::abs( y );
+	float mx = std::max( ax, ay );
+	float t	 = ( mx > 0.0f ) ? std::min( ax, ay ) / mx : 0.0f;
+	float s	 = t * t;
+	float r	 = t * ( 0.99997726f + s * ( -0.33262347f + s * ( 0.19354346f + s * ( -0.11643287f + s * ( 0.05265332f - s * 0.01172120f ) ) ) ) );
+
+	r = ( ay > ax ) ? 1.57079633f - r : r;
+	r = ( x < 0.0f ) ? 3.14159265f - r : r;
+	return ( y < 0.0f ) ? -r : r;
+}
+
 
-		// std::cout << "|A+B| Angle: " << shared->FormatDecimal( thTarget * RAD2DEG, 2 ) << "   Contrib: A: " << shared->FormatDecimal( contribution.x, 2 ) << " , B: " << shared->FormatDecimal( contribution.y, 2 ) << "   rMax: " << shared->FormatDecimal( rMax, 2 ) << "\n";
-	} else if ( thTarget >= ( 145 * DEG2RAD ) && thTarget < ( 270 * DEG2RAD ) ) {
 
-		// Calculate angles BC
-		thBT = thTarget - thB;
-		thCT = thBC - thBT;
+/**
+ * @brief Motor shares of a batch of controller terms
+ *
+ * Direction picks the motors from the allocation table, strength is the angle the term subtends
+ * at the target depth, saturating at 40 deg.
+ *
+ * @param terms		XY terms, z is ignored
+ * @param shares	Output, one ABC share per term
+ * @param nTerms	Number of terms
+ */
+void ControllerClass::AllocateTerms( const cv::Point3f* terms, cv::Point3f* shares, size_t nTerms ) const {
 
-		contribution.y = ( 1.0f - ( thBT / thBC ) ) * rMax;
-		contribution.z = ( 1.0f - ( thCT / thBC ) ) * rMax;
+	const float depth	   = input.positionFilteredMM.z;
+	const float wrap	   = 360.0f * DEG2RAD;
+	const float stepsPerTh = ALLOCATION_STEPS_PER_DEG / DEG2RAD;
+	const float thMax	   = 40.0f * DEG2RAD;
 
-		// std::cout << "|B+C| Angle: " << shared->FormatDecimal( thTarget * RAD2DEG, 2 ) << "   Contrib: B: " << shared->FormatDecimal( contribution.y, 2 ) << " , C: " << shared->FormatDecimal( contribution.z, 2 ) << "   rMax: " << shared->FormatDecimal( rMax, 2 ) << "\n";
+	for ( size_t n = 0; n < nTerms; n++ ) {
+
+		// Strength
+		float r	   = std::sqrt( terms[n].x * terms[n].x + terms[n].y * terms[n].y );
+		float rMax = std::clamp( FastAtan2( r, depth ), 0.0f, thMax ) / thMax;
+
+		// Direction within 0-360 deg, in table steps
+		float th = FastAtan2( terms[n].y, terms[n].x );
+		th		 = ( th < 0.0f ) ? th + wrap : th;
+		float u	 = th * stepsPerTh;
+		int	  i	 = std::min( int( u ), ALLOCATION_STEPS - 1 );
+		float f	 = u - float( i );
+
+		shares[n] = ( allocationTable[i] + ( allocationTable[i + 1] - allocationTable[i] ) * f ) * rMax;
 	}
+}
+
+
+
+/**
+ * @brief Maps the controller PID values to motor output values
+ * 
+ */
+void ControllerClass::MapToContributionABC( cv::Point3f terms ) {
+
+	AllocateTerms( &terms, &contribution, 1 );
+	MapToMotors();
+}
+
+
+
+/**
+ * @brief Turn the current contribution into commanded percentages, currents and PWM
+ */
+void ControllerClass::MapToMotors() {
 
 	// Update percentage and constrain to max depending on torque
-	if ( shared->Amplifier.isTensionOnly ) {
+	if ( settings.isTensionOnly ) {
 
-		shared->Controller.commandedPercentageABC.x = std::clamp( shared->Controller.commandedTensionABC.x, 0.0f, shared->Amplifier.commandedLimits.x );
-		shared->Controller.commandedPercentageABC.y = std::clamp( shared->Controller.commandedTensionABC.y, 0.0f, shared->Amplifier.commandedLimits.y );
-		shared->Controller.commandedPercentageABC.z = std::clamp( shared->Controller.commandedTensionABC.z, 0.0f, shared->Amplifier.commandedLimits.z );
+		output.commandedPercentageABC.x = std::clamp( settings.commandedTensionABC.x, 0.0f, settings.commandedLimits.x );
+		output.commandedPercentageABC.y = std::clamp( settings.commandedTensionABC.y, 0.0f, settings.commandedLimits.y );
+		output.commandedPercentageABC.z = std::clamp( settings.commandedTensionABC.z, 0.0f, settings.commandedLimits.z );
 	} else {
 
-		shared->Controller.commandedPercentageABC.x = std::clamp( ( contribution.x + shared->Controller.commandedTensionABC.x ), 0.0f, shared->Amplifier.commandedLimits.x );
-		shared->Controller.commandedPercentageABC.y = std::clamp( ( contribution.y + shared->Controller.commandedTensionABC.y ), 0.0f, shared->Amplifier.commandedLimits.y );
-		shared->Controller.commandedPercentageABC.z = std::clamp( ( contribution.z + shared->Controller.commandedTensionABC.z ), 0.0f, shared->Amplifier.commandedLimits.z );
+		output.commandedPercentageABC.x = std::clamp( ( contribution.x + settings.commandedTensionABC.x ), 0.0f, settings.commandedLimits.x );
+		output.commandedPercentageABC.y = std::clamp( ( contribution.y + settings.commandedTensionABC.y ), 0.0f, settings.commandedLimits.y );
+		output.commandedPercentageABC.z = std::clamp( ( contribution.z + settings.commandedTensionABC.z ), 0.0f, settings.commandedLimits.z );
 	}
 
 
 	// Map to current
-	// shared->Controller.commandedCurrentABC = MapToCurrent( shared->Controller.commandedPercentageABC, CONFIG_DEVICE_NOMINAL_CURRENT );
+	// output.commandedCurrentABC = MapToCurrent( output.commandedPercentageABC, CONFIG_DEVICE_NOMINAL_CURRENT );
 
 
-	// Persistent over-limit state tracker
-	static bool wasOverLimitA = false;
-	static bool wasOverLimitB = false;
-	static bool wasOverLimitC = false;
-
 	// Step 1: Compute desired current from percentage
-	shared->Controller.commandedCurrentABC = MapToCurrent( shared->Controller.commandedPercentageABC, CONFIG_DEVICE_NOMINAL_CURRENT );
+	output.commandedCurrentABC = MapToCurrent( output.commandedPercentageABC, CONFIG_DEVICE_NOMINAL_CURRENT );
 
 	// Step 2: Compute new PWM command
-	cv::Point3i targetPWM = MapToPWM( shared->Controller.commandedPercentageABC, 4, 2044 );
+	cv::Point3i targetPWM = MapToPWM( output.commandedPercentageABC, 4, 2044 );
 
 	// Decay constants
 	const float decayFactor	 = 1.01f;
 	const float recoverBlend = 0.1f;	// smaller = slower ramp back
 
 	// Motor A
-	if ( shared->Amplifier.isOverLimitA ) {
-		shared->Controller.commandedPwmABC.x *= decayFactor;
+	if ( settings.isOverLimitA ) {
+		output.commandedPwmABC.x *= decayFactor;
 		wasOverLimitA = true;
 	} else {
 		if ( wasOverLimitA ) {
 			// Gradual recovery
-			shared->Controller.commandedPwmABC.x = shared->Controller.commandedPwmABC.x * ( 1.0f - recoverBlend ) + targetPWM.x * recoverBlend;
+			output.commandedPwmABC.x = output.commandedPwmABC.x * ( 1.0f - recoverBlend ) + targetPWM.x * recoverBlend;
 
 			// If close enough, consider recovered
-			if ( std::abs( shared->Controller.commandedPwmABC.x - targetPWM.x ) < 1.0f ) {
+			if ( std::abs( output.commandedPwmABC.x - targetPWM.x ) < 1.0f ) {
 				wasOverLimitA = false;
 			}
 		} else {
-			shared->Controller.commandedPwmABC.x = targetPWM.x;
+			output.commandedPwmABC.x = targetPWM.x;
 		}
 	}
 
 	// Motor B
-	if ( shared->Amplifier.isOverLimitB ) {
-		shared->Controller.commandedPwmABC.y *= decayFactor;
+	if ( settings.isOverLimitB ) {
+		output.commandedPwmABC.y *= decayFactor;
 		wasOverLimitB = true;
 	} else {
 		if ( wasOverLimitB ) {
-			shared->Controller.commandedPwmABC.y = shared->Controller.commandedPwmABC.y * ( 1.0f - recoverBlend ) + targetPWM.y * recoverBlend;
-			if ( std::abs( shared->Controller.commandedPwmABC.y - targetPWM.y ) < 1.0f ) {
+			output.commandedPwmABC.y = output.commandedPwmABC.y * ( 1.0f - recoverBlend ) + targetPWM.y * recoverBlend;
+			if ( std::abs( output.commandedPwmABC.y - targetPWM.y ) < 1.0f ) {
 				wasOverLimitB = false;
 			}
 		} else {
-			shared->Controller.commandedPwmABC.y = targetPWM.y;
+			output.commandedPwmABC.y = targetPWM.y;
 		}
 	}
 
 	// Motor C
-	if ( shared->Amplifier.isOverLimitC ) {
-		shared->Controller.commandedPwmABC.z *= decayFactor;
+	if ( settings.isOverLimitC ) {
+		output.commandedPwmABC.z *= decayFactor;
 		wasOverLimitC = true;
 	} else {
 		if ( wasOverLimitC ) {
-			shared->Controller.commandedPwmABC.z = shared->Controller.commandedPwmABC.z * ( 1.0f - recoverBlend ) + targetPWM.z * recoverBlend;
-			if ( std::abs( shared->Controller.commandedPwmABC.z - targetPWM.z ) < 1.0f ) {
+			output.commandedPwmABC.z = output.commandedPwmABC.z * ( 1.0f - recoverBlend ) + targetPWM.z * recoverBlend;
+			if ( std::abs( output.commandedPwmABC.z - targetPWM.z ) < 1.0f ) {
 				wasOverLimitC = false;
 			}
 		} else {
-			shared->Controller.commandedPwmABC.z = targetPWM.z;
+			output.commandedPwmABC.z = targetPWM.z;
 		}
 	}
 
 	// Clamp PWM values
-	shared->Controller.commandedPwmABC.x = std::clamp( shared->Controller.commandedPwmABC.x, 4, 2044 );
-	shared->Controller.commandedPwmABC.y = std::clamp( shared->Controller.commandedPwmABC.y, 4, 2044 );
-	shared->Controller.commandedPwmABC.z = std::clamp( shared->Controller.commandedPwmABC.z, 4, 2044 );
+	output.commandedPwmABC.x = std::clamp( output.commandedPwmABC.x, 4, 2044 );
+	output.commandedPwmABC.y = std::clamp( output.commandedPwmABC.y, 4, 2044 );
+	output.commandedPwmABC.z = std::clamp( output.commandedPwmABC.z, 4, 2044 );
 }
 
 
@@ -276,62 +448,8 @@ void ControllerClass::MapToContributionABC( cv::Point3f terms ) {
  */
 cv::Point3f ControllerClass::MapToContributionTerm( cv::Point3f terms ) {
 
-	cv::Point3f termContrib = cv::Point3f( 0.0f, 0.0f, 0.0f );
-
-	// Old (no PID)
-	// Calculate error angle for motor selection
-	thTarget = std::atan2( terms.y, terms.x );
-	rTarget	 = cv::norm( cv::Vec2f( terms.x, terms.y ) );
-
-	// Calculate max strength
-	rMax = std::clamp( float( std::atan2( rTarget, shared->Target.positionFilteredNewMM.z ) ), 0.0f, float( 40.0 * DEG2RAD ) ) / ( 40.0 * DEG2RAD );
-
-	// Wrap angle within 0-360 deg
-	if ( thTarget < 0 ) {
-		thTarget += ( 360.0f * DEG2RAD );
-	}
-
-	// Determine angle and calculate contributions
-	if ( thTarget >= ( 270 * DEG2RAD ) || thTarget < ( 35 * DEG2RAD ) ) {
-
-		// Wrap-around for 360/0 deg, calculate angles AC
-		if ( thTarget < thA ) {
-			thAT = thA - thTarget;
-			thCT = thAC - thAT;
-		}
-		if ( thTarget > thC ) {
-			thCT = thTarget - thC;
-			thAT = thAC - thCT;
-		}
-
-		// rMax		   = rMax * RAD2DEG;
-		termContrib.x = ( 1.0f - ( thAT / thAC ) ) * rMax;
-		termContrib.z = ( 1.0f - ( thCT / thAC ) ) * rMax;
-
-		// Debug
-		// std::cout << "|A+C| Angle: " << shared->FormatDecimal( thTarget * RAD2DEG, 2 ) << "   Contrib: A: " << shared->FormatDecimal( contribution.x, 2 ) << " , C: " << shared->FormatDecimal( contribution.z, 2 ) << "   rMax: " << shared->FormatDecimal( rMax, 2 ) << "\n";
-	} else if ( thTarget >= ( 35 * DEG2RAD ) && thTarget < ( 145 * DEG2RAD ) ) {
-
-		// Calculate angles AB
-		thAT = thTarget - thA;
-		thBT = thAB - thAT;
-
-		termContrib.x = ( 1.0f - ( thAT / thAB ) ) * rMax;
-		termContrib.y = ( 1.0f - ( thBT / thAB ) ) * rMax;
-
-		// std::cout << "|A+B| Angle: " << shared->FormatDecimal( thTarget * RAD2DEG, 2 ) << "   Contrib: A: " << shared->FormatDecimal( contribution.x, 2 ) << " , B: " << shared->FormatDecimal( contribution.y, 2 ) << "   rMax: " << shared->FormatDecimal( rMax, 2 ) << "\n";
-	} else if ( thTarget >= ( 145 * DEG2RAD ) && thTarget < ( 270 * DEG2RAD ) ) {
-
-		// Calculate angles BC
-		thBT = thTarget - thB;
-		thCT = thBC - thBT;
-
-		termContrib.y = ( 1.0f - ( thBT / thBC ) ) * rMax;
-		termContrib.z = ( 1.0f - ( thCT / thBC ) ) * rMax;
-
-		// std::cout << "|B+C| Angle: " << shared->FormatDecimal( thTarget * RAD2DEG, 2 ) << "   Contrib: B: " << shared->FormatDecimal( contribution.y, 2 ) << " , C: " << shared->FormatDecimal( contribution.z, 2 ) << "   rMax: " << shared->FormatDecimal( rMax, 2 ) << "\n";
-	}
-
+	cv::Point3f termContrib;
+	AllocateTerms( &terms, &termContrib, 1 );
 	return termContrib;
 }
 
@@ -357,20 +475,112 @@ cv::Point3i ControllerClass::MapToPWM( cv::Point3f percentage, int min, int max
 
 
 
-void ControllerClass::RampUp() {
+/**
+ * @brief Restart the ramp when asked to or when the target was reset, advance it while the target is in view
+ */
+void ControllerClass::RampUp( std::chrono::steady_clock::time_point timeNow ) {
 
 	// Reset ramp-up
-	shared->Controller.rampPercentage = 0.0f;
-	shared->Controller.rampStartTime  = shared->Timing.elapsedRunningTime;
-
+	if ( settings.nRampRequests != nRampRequestsSeen || input.isTargetReset ) {
+		nRampRequestsSeen	  = settings.nRampRequests;
+		input.isTargetReset	  = false;
+		output.rampPercentage = 0.0f;
+		output.isRampingUp	  = true;
+		timeRampStart		  = timeNow;
+	}
 
 	// Ramp-up value
-	if ( shared->Controller.isRampingUp && shared->Target.isTargetFound ) {
-		float elapsed					  = shared->Timing.elapsedRunningTime - shared->Controller.rampStartTime;
-		shared->Controller.rampPercentage = std::clamp( elapsed / shared->Controller.rampDurationTime, 0.0f, 1.0f );
+	if ( output.isRampingUp && input.isTargetFound ) {
+		float elapsed		  = std::chrono::duration<float>( timeNow - timeRampStart ).count();
+		output.rampPercentage = std::clamp( elapsed / settings.rampDurationTime, 0.0f, 1.0f );
+
+		if ( output.rampPercentage >= 1.0f ) {
+			output.isRampingUp = false;
+		}
+	}
+}
+
+
+/**
+ * @brief Read gains written by SaveGains(), e.g. from the offline gain sweep
+ *
+ * One "<name> <value>" pair per line, '#' starts a comment. Values missing from the file keep
+ * their current setting.
+ *
+ * @param path Gains file
+ * @return true if every line was understood
+ */
+bool ControllerClass::LoadGains( const std::string& path ) {
+
+	std::ifstream file( path );
+	if ( !file.is_open() ) {
+		std::cerr << "ControllerClass: Could not open gains file " << path << "\n";
+		return false;
+	}
 
-		if ( shared->Controller.rampPercentage >= 1.0f ) {
-			shared->Controller.isRampingUp = false;
+	auto& c = shared->Controller;
+	std::map<std::string, float*> gains = {
+		{ "kp.abd", &c.gainKp.abd }, { "kp.add", &c.gainKp.add }, { "kp.flx", &c.gainKp.flx }, { "kp.ext", &c.gainKp.ext },
+		{ "ki.abd", &c.gainKi.abd }, { "ki.add", &c.gainKi.add }, { "ki.flx", &c.gainKi.flx }, { "ki.ext", &c.gainKi.ext },
+		{ "kd.abd", &c.gainKd.abd }, { "kd.add", &c.gainKd.add }, { "kd.flx", &c.gainKd.flx }, { "kd.ext", &c.gainKd.ext },
+		{ "integralDecay", &c.integralDecay }, { "rampDurationTime", &c.rampDurationTime },
+	};
+
+	std::string line;
+	int			lineNumber = 0;
+	bool		isValid	   = true;
+	while ( std::getline( file, line ) ) {
+		lineNumber++;
+		line = line.substr( 0, line.find( '#' ) );
+
+		std::istringstream tokens( line );
+		std::string		   name;
+		float			   value = 0.0f;
+		if ( !( tokens >> name ) ) {
+			continue;
+		}
+		if ( !( tokens >> value ) ) {
+			std::cerr << "ControllerClass: Gains line " << lineNumber << ": missing value for " << name << "\n";
+			isValid = false;
+		} else if ( name == "integrationRadius" ) {
+			c.integrationRadius = int( std::lround( value ) );
+		} else if ( gains.count( name ) ) {
+			*gains[name] = value;
+		} else {
+			std::cerr << "ControllerClass: Gains line " << lineNumber << ": unknown gain " << name << "\n";
+			isValid = false;
 		}
 	}
-}
\ No newline at end of file
+
+	std::cout << "ControllerClass: Loaded gains from " << path << "\n";
+	return isValid;
+}
+
+
+
+/**
+ * @brief Write the current gains in the format LoadGains() reads
+ *
+ * @param path Gains file
+ * @return true if the file was written
+ */
+bool ControllerClass::SaveGains( const std::string& path ) const {
+
+	std::ofstream file( path );
+	if ( !file.is_open() ) {
+		std::cerr << "ControllerClass: Could not write gains file " << path << "\n";
+		return false;
+	}
+
+	const auto& c = shared->Controller;
+	file << std::fixed << std::setprecision( 4 );
+	file << "# NURing controller gains, directions abd / add / flx / ext\n";
+	file << "kp.abd " << c.gainKp.abd << "\nkp.add " << c.gainKp.add << "\nkp.flx " << c.gainKp.flx << "\nkp.ext " << c.gainKp.ext << "\n";
+	file << "ki.abd " << c.gainKi.abd << "\nki.add " << c.gainKi.add << "\nki.flx " << c.gainKi.flx << "\nki.ext " << c.gainKi.ext << "\n";
+	file << "kd.abd " << c.gainKd.abd << "\nkd.add " << c.gainKd.add << "\nkd.flx " << c.gainKd.flx << "\nkd.ext " << c.gainKd.ext << "\n";
+	file << "integralDecay " << c.integralDecay << "\n";
+	file << "integrationRadius " << c.integrationRadius << "\n";
+	file << "rampDurationTime " << c.rampDurationTime << "\n";
+
+	return bool( file );
+}
@@ -15,9 +15,6 @@ DisplayClass::DisplayClass( SystemDataManager& ctx )
 	: dataHandle( ctx )
 	, shared( ctx.getData() ) {
 
-	cv::namedWindow( winInterface, cv::WINDOW_AUTOSIZE );
-	cv::moveWindow( winInterface, 3440 - CONFIG_DIS_WIDTH - 2, 0 );
-
 	// Set font based on chosen resolution
 	if ( CONFIG_TYPE == "LowResolution" ) {
 		fontHeader	   = 0.65f;
@@ -37,6 +34,30 @@ DisplayClass::DisplayClass( SystemDataManager& ctx )
 }
 
 
+
+/**
+ * @brief Open the interface window and draw the static panels, skipped in headless mode
+ *
+ * Kept out of the constructor so a headless run never touches HighGUI. The capture thread only
+ * builds the undistorted color image while the overlay is shown.
+ */
+void DisplayClass::Initialize() {
+
+	shared->Capture.isColorRequested = !shared->System.isHeadless;
+
+	if ( shared->System.isHeadless ) {
+		std::cout << "DisplayClass: Headless, no windows.\n";
+		return;
+	}
+
+	cv::namedWindow( winInterface, cv::WINDOW_AUTOSIZE );
+	cv::moveWindow( winInterface, 3440 - CONFIG_DIS_WIDTH - 2, 0 );
+
+	// Add shortcut panel
+	AddStaticDisplayPanels();
+}
+
+
 /**
  *
  * 
@@ -67,6 +88,29 @@ DisplayClass::DisplayClass( SystemDataManager& ctx )
  */
 void DisplayClass::Update() {
 
+	// Nothing to draw on
+	if ( shared->System.isHeadless ) {
+		shared->Capture.isColorRequested = false;
+		return;
+	}
+
+	// Draw overlay
+	Render();
+
+	// Loop stage timings
+	BuildProfilerInterface();
+
+	// Show interface
+	ShowInterface();
+}
+
+
+
+/**
+ * @brief Draw the camera frame, markers and readouts into the overlay without showing it
+ */
+void DisplayClass::Render() {
+
 	// Clear overlay frame
 	// shared->matFrameOverlay = 0;
 
@@ -87,9 +131,6 @@ void DisplayClass::Update() {
 
 	// Add log
 	// BuildLogInterface();
-
-	// Show interface
-	ShowInterface();
 }
 
 
@@ -127,6 +168,12 @@ void DisplayClass::BuildReadoutInterface() {
 	// Task
 	AddTextTask();
 
+	// Latency
+	AddTextLatency();
+
+	// Loop deadline
+	AddTextLoop();
+
 	// Status block
 	DrawCell( shared->Display.statusString, "AO9", 10, 2, fontBody, CONFIG_colWhite, CONFIG_colBlack, true );
 
@@ -272,6 +319,63 @@ void DisplayClass::BuildLogInterface() {
 
 
 
+/**
+ * @brief Rolling stage percentiles, shown in the checklist window while the profiler is on
+ *
+ * Only redrawn when TimingClass has refreshed the numbers, about once per second. The checklist is
+ * put back when the profiler is switched off.
+ */
+void DisplayClass::BuildProfilerInterface() {
+
+	// Restore the checklist when hidden
+	if ( !shared->Timing.isProfilerShown ) {
+		if ( isProfilerDrawn ) {
+			matChecklist	= CONFIG_colBlack;
+			isProfilerDrawn = false;
+			BuildChecklist();
+		}
+		return;
+	}
+
+	if ( isProfilerDrawn && profilerRevision == shared->Timing.stagesRevision ) {
+		return;
+	}
+	profilerRevision = shared->Timing.stagesRevision;
+	isProfilerDrawn	 = true;
+
+	// Header
+	matChecklist = CONFIG_colBlack;
+	DrawChecklistCell( "Stage [ms]", "A1", 2, 1, key_fontHeader, CONFIG_colWhite, CONFIG_colGraDk, true );
+	DrawChecklistCell( "p50", "C1", 1, 1, key_fontBody, CONFIG_colWhite, CONFIG_colGraDk, true );
+	DrawChecklistCell( "p95", "D1", 1, 1, key_fontBody, CONFIG_colWhite, CONFIG_colGraDk, true );
+	DrawChecklistCell( "p99", "E1", 1, 1, key_fontBody, CONFIG_colWhite, CONFIG_colGraDk, true );
+	DrawChecklistCell( "max", "F1", 1, 1, key_fontBody, CONFIG_colWhite, CONFIG_colGraDk, true );
+
+	// One row per stage, sum of the medians at the bottom
+	float sumP50 = 0.0f;
+	for ( size_t s = 0; s < size_t( loopStageEnum::COUNT ); s++ ) {
+		const StageStatsStruct& stats = shared->Timing.stages[s];
+		std::string				row	  = std::to_string( s + 2 );
+		sumP50 += stats.p50MS;
+
+		DrawChecklistCell( loopStageNames[s], "A" + row, 2, 1, key_fontBody, CONFIG_colWhite, CONFIG_colGraBk, false );
+		DrawChecklistCell( shared->FormatDecimal( stats.p50MS, 1, 2 ), "C" + row, 1, 1, key_fontBody, CONFIG_colWhite, CONFIG_colBlack, true );
+		DrawChecklistCell( shared->FormatDecimal( stats.p95MS, 1, 2 ), "D" + row, 1, 1, key_fontBody, CONFIG_colWhite, CONFIG_colBlack, true );
+		DrawChecklistCell( shared->FormatDecimal( stats.p99MS, 1, 2 ), "E" + row, 1, 1, key_fontBody, CONFIG_colWhite, CONFIG_colBlack, true );
+		DrawChecklistCell( shared->FormatDecimal( stats.maxMS, 1, 2 ), "F" + row, 1, 1, key_fontBody, CONFIG_colWhite, CONFIG_colBlack, true );
+	}
+
+	std::string row = std::to_string( size_t( loopStageEnum::COUNT ) + 2 );
+	DrawChecklistCell( "Sum", "A" + row, 2, 1, key_fontBody, CONFIG_colWhite, CONFIG_colGraBk, false );
+	DrawChecklistCell( shared->FormatDecimal( sumP50, 1, 2 ), "C" + row, 1, 1, key_fontBody, CONFIG_colWhite, CONFIG_colBlack, true );
+	DrawChecklistCell( std::to_string( shared->Timing.measuredFrequency ) + " Hz", "D" + row, 3, 1, key_fontBody, CONFIG_colWhite, CONFIG_colBlack, true );
+
+	// Display window
+	cv::imshow( winChecklist, matChecklist );
+}
+
+
+
 /**
  * @brief Add camera elements to the main display
  * 
@@ -306,6 +410,12 @@ void DisplayClass::AddCameraElements() {
 
 
 
+	// Draw search window, only lines up with the display when detecting on the undistorted frame
+	if ( shared->Aruco.isTracking && !shared->Capture.isGrayRaw ) {
+		cv::rectangle( shared->Display.matFrameOverlay, shared->Aruco.searchRegionPX, CONFIG_colBluLt, 1 );
+	}
+
+
 	// Draw calibrated marker
 	if ( shared->Calibration.isCalibrated ) {
 		// int newX = shared->calibrationOffsetPX.x - CONFIG_TOUCHSCREEN_CENTER.x + CONFIG_CAM_PRINCIPAL_X;
@@ -774,6 +884,60 @@ void DisplayClass::AddTextTask() {
 
 
 
+void DisplayClass::AddTextLatency() {
+
+	// Glass-to-motor
+	DrawCell( "Latency", "AO4", 2, 1, fontHeader, CONFIG_colWhite, CONFIG_colGraBk, true );
+	DrawCell( "p50", "AQ4", 1, 1, fontHeader, CONFIG_colWhite, CONFIG_colGraBk, true );
+	DrawCell( shared->FormatDecimal( shared->Latency.totalP50MS, 2, 1 ), "AR4", 1, 1, fontBody, CONFIG_colWhite, CONFIG_colBlack, true );
+	DrawCell( "p95", "AS4", 1, 1, fontHeader, CONFIG_colWhite, CONFIG_colGraBk, true );
+	DrawCell( shared->FormatDecimal( shared->Latency.totalP95MS, 2, 1 ), "AT4", 1, 1, fontBody, CONFIG_colWhite, CONFIG_colBlack, true );
+	DrawCell( "max", "AU4", 1, 1, fontHeader, CONFIG_colWhite, CONFIG_colGraBk, true );
+	DrawCell( shared->FormatDecimal( shared->Latency.totalMaxMS, 2, 1 ), "AV4", 1, 1, fontBody, CONFIG_colWhite, CONFIG_colBlack, true );
+	DrawCell( "n", "AW4", 1, 1, fontHeader, CONFIG_colWhite, CONFIG_colGraBk, true );
+	DrawCell( std::to_string( shared->Latency.nFrames ), "AX4", 1, 1, fontBody, CONFIG_colWhite, CONFIG_colBlack, true );
+
+	// Median per stage
+	DrawCell( "Stage [ms]", "AO5", 2, 1, fontHeader, CONFIG_colWhite, CONFIG_colGraBk, true );
+	DrawCell( "Det", "AQ5", 1, 1, fontHeader, CONFIG_colWhite, CONFIG_colGraBk, true );
+	DrawCell( shared->FormatDecimal( shared->Latency.detectP50MS, 2, 1 ), "AR5", 1, 1, fontBody, CONFIG_colWhite, CONFIG_colBlack, true );
+	DrawCell( "Flt", "AS5", 1, 1, fontHeader, CONFIG_colWhite, CONFIG_colGraBk, true );
+	DrawCell( shared->FormatDecimal( shared->Latency.filterP50MS, 2, 1 ), "AT5", 1, 1, fontBody, CONFIG_colWhite, CONFIG_colBlack, true );
+	DrawCell( "Ctl", "AU5", 1, 1, fontHeader, CONFIG_colWhite, CONFIG_colGraBk, true );
+	DrawCell( shared->FormatDecimal( shared->Latency.controlP50MS, 2, 1 ), "AV5", 1, 1, fontBody, CONFIG_colWhite, CONFIG_colBlack, true );
+	DrawCell( "Tx", "AW5", 1, 1, fontHeader, CONFIG_colWhite, CONFIG_colGraBk, true );
+	DrawCell( shared->FormatDecimal( shared->Latency.sendP50MS, 2, 1 ), "AX5", 1, 1, fontBody, CONFIG_colWhite, CONFIG_colBlack, true );
+}
+
+
+
+void DisplayClass::AddTextLoop() {
+
+	const bool isJittery = shared->Timing.loopJitterMS > CONFIG_LOOP_JITTER_WARN_MS;
+
+	// Period over the last second
+	DrawCell( "Loop [ms]", "AO6", 2, 1, fontHeader, CONFIG_colWhite, CONFIG_colGraBk, true );
+	DrawCell( "T", "AQ6", 1, 1, fontHeader, CONFIG_colWhite, CONFIG_colGraBk, true );
+	DrawCell( shared->FormatDecimal( shared->Timing.loopPeriodMS, 2, 1 ), "AR6", 1, 1, fontBody, CONFIG_colWhite, CONFIG_colBlack, true );
+	DrawCell( "Jit", "AS6", 1, 1, fontHeader, CONFIG_colWhite, isJittery ? CONFIG_colRedBk : CONFIG_colGraBk, true );
+	DrawCell( shared->FormatDecimal( shared->Timing.loopJitterMS, 1, 1 ), "AT6", 1, 1, fontBody, CONFIG_colWhite, CONFIG_colBlack, true );
+	DrawCell( "Max", "AU6", 1, 1, fontHeader, CONFIG_colWhite, CONFIG_colGraBk, true );
+	DrawCell( shared->FormatDecimal( shared->Timing.loopPeriodMaxMS, 2, 1 ), "AV6", 1, 1, fontBody, CONFIG_colWhite, CONFIG_colBlack, true );
+	DrawCell( "Dl", "AW6", 1, 1, fontHeader, CONFIG_colWhite, CONFIG_colGraBk, true );
+	DrawCell( shared->FormatDecimal( CONFIG_LOOP_DEADLINE_MS, 2, 1 ), "AX6", 1, 1, fontBody, CONFIG_colWhite, CONFIG_colBlack, true );
+
+	// Deadline misses and the stage blamed for the last one
+	DrawCell( "Misses", "AO7", 2, 1, fontHeader, CONFIG_colWhite, shared->Timing.nOverrunsTask ? CONFIG_colRedBk : CONFIG_colGraBk, true );
+	DrawCell( "Task", "AQ7", 1, 1, fontHeader, CONFIG_colWhite, CONFIG_colGraBk, true );
+	DrawCell( std::to_string( shared->Timing.nOverrunsTask ), "AR7", 1, 1, fontBody, CONFIG_colWhite, CONFIG_colBlack, true );
+	DrawCell( "All", "AS7", 1, 1, fontHeader, CONFIG_colWhite, CONFIG_colGraBk, true );
+	DrawCell( std::to_string( shared->Timing.nOverruns ), "AT7", 1, 1, fontBody, CONFIG_colWhite, CONFIG_colBlack, true );
+	DrawCell( "Last", "AU7", 1, 1, fontHeader, CONFIG_colWhite, CONFIG_colGraBk, true );
+	DrawCell( ( shared->Timing.lastOverrunStage == loopStageEnum::COUNT ) ? "-" : loopStageNames[size_t( shared->Timing.lastOverrunStage )], "AV7", 3, 1, fontBody, CONFIG_colWhite, CONFIG_colBlack, true );
+}
+
+
+
 /*
  *
  * 
@@ -842,6 +1006,12 @@ void DisplayClass::BuildKeyboardShortcuts() {
 	DrawKeyCell( "LimitsReset", "A34", 5, 1, key_fontBody, CONFIG_colWhite, CONFIG_colBlack, false );
 	DrawKeyCell( "Change reverse mode", "A35", 5, 1, key_fontBody, CONFIG_colWhite, CONFIG_colBlack, false );
 	DrawKeyCell( "Rotate camera", "A36", 5, 1, key_fontBody, CONFIG_colWhite, CONFIG_colBlack, false );
+	DrawKeyCell( "Capture backend", "A37", 5, 1, key_fontBody, CONFIG_colWhite, CONFIG_colBlack, false );
+	DrawKeyCell( "Detection space", "A38", 5, 1, key_fontBody, CONFIG_colWhite, CONFIG_colBlack, false );
+	DrawKeyCell( "ROI tracking", "A39", 5, 1, key_fontBody, CONFIG_colWhite, CONFIG_colBlack, false );
+	DrawKeyCell( "Search resolution", "A40", 5, 1, key_fontBody, CONFIG_colWhite, CONFIG_colBlack, false );
+	DrawKeyCell( "Loop profiler", "A41", 5, 1, key_fontBody, CONFIG_colWhite, CONFIG_colBlack, false );
+	DrawKeyCell( "Record trace", "A42", 5, 1, key_fontBody, CONFIG_colWhite, CONFIG_colBlack, false );
 
 	DrawKeyCell( "Esc", "F1", 1, 1, key_fontBody, CONFIG_colWhite, CONFIG_colBlack, true );
 	DrawKeyCell( "1", "F2", 1, 1, key_fontBody, CONFIG_colWhite, CONFIG_colBlack, true );
@@ -879,6 +1049,12 @@ void DisplayClass::BuildKeyboardShortcuts() {
 	DrawKeyCell( "nCR", "F34", 1, 1, key_fontBody, CONFIG_colWhite, CONFIG_colBlack, true );
 	DrawKeyCell( "r", "F35", 1, 1, key_fontBody, CONFIG_colWhite, CONFIG_colBlack, true );
 	DrawKeyCell( "q", "F35", 1, 1, key_fontBody, CONFIG_colWhite, CONFIG_colBlack, true );
+	DrawKeyCell( "b", "F37", 1, 1, key_fontBody, CONFIG_colWhite, CONFIG_colBlack, true );
+	DrawKeyCell( "u", "F38", 1, 1, key_fontBody, CONFIG_colWhite, CONFIG_colBlack, true );
+	DrawKeyCell( "k", "F39", 1, 1, key_fontBody, CONFIG_colWhite, CONFIG_colBlack, true );
+	DrawKeyCell( "l", "F40", 1, 1, key_fontBody, CONFIG_colWhite, CONFIG_colBlack, true );
+	DrawKeyCell( "o", "F41", 1, 1, key_fontBody, CONFIG_colWhite, CONFIG_colBlack, true );
+	DrawKeyCell( "e", "F42", 1, 1, key_fontBody, CONFIG_colWhite, CONFIG_colBlack, true );
 
 
 	// Display window
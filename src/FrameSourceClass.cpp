@@ -0,0 +1,412 @@
+// Call to class header
+#include "FrameSourceClass.h"
+
+// Standard libraries
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+// OpenCV
+#include <opencv2/core/utils/filesystem.hpp>
+#include <opencv2/imgcodecs.hpp>
+
+// Runtime configuration
+#include "config.h"
+
+
+
+/*
+ *
+ *
+ *
+ *
+ *  =========================================================================================
+ *  =========================================================================================
+ *
+ *   LL       IIIII  VV     VV  EEEEEEE
+ *   LL        III   VV     VV  EE
+ *   LL        III    VV   VV   EE
+ *   LL        III    VV   VV   EEEEE
+ *   LL        III     VV VV    EE
+ *   LL        III     VV VV    EE
+ *   LLLLLLL  IIIII     VVV     EEEEEEE
+ *
+ *  =========================================================================================
+ *  =========================================================================================
+ */
+
+
+
+// Constructor
+LiveSourceClass::LiveSourceClass( const std::string& device )
+	: device( device ) { }
+
+
+/**
+ * @brief Open the camera and apply the configured capture settings
+ */
+bool LiveSourceClass::Open() {
+
+	// Try catch to open camera device
+	try {
+		// Capture device
+		Capture.open( device, cv::CAP_V4L2 );
+
+		// Capture settings
+		Capture.set( cv::CAP_PROP_FOURCC, cv::VideoWriter::fourcc( 'M', 'J', 'P', 'G' ) );
+		Capture.set( cv::CAP_PROP_FRAME_WIDTH, CONFIG_CAM_WIDTH );
+		Capture.set( cv::CAP_PROP_FRAME_HEIGHT, CONFIG_CAM_HEIGHT );
+		Capture.set( cv::CAP_PROP_FPS, CONFIG_CAM_FRAMERATE );
+		Capture.set( cv::CAP_PROP_HW_ACCELERATION, cv::VIDEO_ACCELERATION_ANY );
+
+		// Camera settings
+		Capture.set( cv::CAP_PROP_BRIGHTNESS, CONFIG_CAM_BRIGHTNESS );
+
+		Capture.set( cv::CAP_PROP_CONTRAST, CONFIG_CAM_CONTRAST );
+		Capture.set( cv::CAP_PROP_SATURATION, CONFIG_CAM_SATURATION );
+		Capture.set( cv::CAP_PROP_HUE, CONFIG_CAM_HUE );
+		Capture.set( cv::CAP_PROP_AUTO_WB, CONFIG_CAM_AUTO_WHITEBALANCE );
+		Capture.set( cv::CAP_PROP_GAMMA, CONFIG_CAM_GAMMA );
+		Capture.set( cv::CAP_PROP_GAIN, CONFIG_CAM_GAIN );
+		Capture.set( cv::CAP_PROP_SHARPNESS, CONFIG_CAM_SHARPNESS );
+		Capture.set( cv::CAP_PROP_BACKLIGHT, CONFIG_CAM_BACKLIGHT );
+		Capture.set( cv::CAP_PROP_AUTO_EXPOSURE, CONFIG_CAM_AUTO_EXPOSURE );
+		Capture.set( cv::CAP_PROP_EXPOSURE, CONFIG_CAM_EXPOSURE_LEVEL );
+		Capture.set( cv::CAP_PROP_PAN, CONFIG_CAM_PAN );
+		Capture.set( cv::CAP_PROP_TILT, CONFIG_CAM_TILT );
+		Capture.set( cv::CAP_PROP_FOCUS, CONFIG_CAM_FOCUS_LEVEL );
+		Capture.set( cv::CAP_PROP_AUTOFOCUS, CONFIG_CAM_AUTO_FOCUS );
+		Capture.set( cv::CAP_PROP_ZOOM, CONFIG_CAM_ZOOM );
+
+
+		// Ensure capture devices open and running
+		if ( !Capture.isOpened() ) {
+			std::cerr << "Error: Could not open the camera." << std::endl;
+			return false;
+		}
+	} catch ( cv::Exception& e ) {
+		std::cout << "Exception in LiveSourceClass::Open(): " << e.msg << "\n";
+		return false;
+	}
+
+	// Output confirmation
+	std::cout << "CaptureClass: Camera initialized at ( " << Capture.get( cv::CAP_PROP_FRAME_HEIGHT ) << " x " << Capture.get( cv::CAP_PROP_FRAME_WIDTH ) << " ) @ " << Capture.get( cv::CAP_PROP_FPS ) << " fps, mode = " << Capture.get( cv::CAP_PROP_BACKEND )
+			  << " , Accel = " << Capture.get( cv::CAP_PROP_HW_ACCELERATION ) << "\n";
+
+	return true;
+}
+
+
+/**
+ * @brief Wait for the next camera frame
+ */
+bool LiveSourceClass::Read( cv::Mat& frame, std::chrono::steady_clock::time_point& timeGrabbed, std::chrono::steady_clock::time_point& timeSource ) {
+
+	// Blocks until V4L2 delivers
+	if ( !Capture.grab() ) {
+		return false;
+	}
+
+	// Stamp as close to the grab as possible
+	timeGrabbed = std::chrono::steady_clock::now();
+	timeSource	= timeGrabbed;
+	return Capture.retrieve( frame );
+}
+
+
+void LiveSourceClass::Close() {
+	if ( Capture.isOpened() ) {
+		Capture.release();
+	}
+}
+
+
+bool LiveSourceClass::IsOpen() const {
+	return Capture.isOpened();
+}
+
+
+std::string LiveSourceClass::Describe() const {
+	return "live " + device;
+}
+
+
+
+/*
+ *
+ *
+ *
+ *
+ *  =========================================================================================
+ *  =========================================================================================
+ *
+ *   RRRRRR   EEEEEEE  PPPPPP   LL         AAAA   YY    YY
+ *   RR   RR  EE       PP   PP  LL        AA  AA   YY  YY
+ *   RR   RR  EE       PP   PP  LL        AA  AA    YYYY
+ *   RRRRRR   EEEEE    PPPPPP   LL       AAAAAAAA    YY
+ *   RR  RR   EE       PP       LL       AA    AA    YY
+ *   RR   RR  EE       PP       LL       AA    AA    YY
+ *   RR   RR  EEEEEEE  PP       LLLLLLL  AA    AA    YY
+ *
+ *  =========================================================================================
+ *  =========================================================================================
+ */
+
+
+
+// Constructor
+ReplaySourceClass::ReplaySourceClass( replayModeEnum mode )
+	: replayMode( mode ) { }
+
+
+/**
+ * @brief Map a recorded frame time onto the steady clock
+ *
+ * The first frame anchors the recording to the current time. In real-time mode later frames are
+ * held back until their recorded offset has elapsed; as fast as possible returns immediately but
+ * still reports the recorded spacing, so the filter sees the original timing. That time runs ahead
+ * of the clock when replaying fast, so it is only ever used as timeSource.
+ *
+ * @param frameTimeSeconds Recorded time of the frame
+ * @return std::chrono::steady_clock::time_point Recorded time on the steady clock
+ */
+std::chrono::steady_clock::time_point ReplaySourceClass::PaceFrame( double frameTimeSeconds ) {
+
+	// Anchor on first frame
+	if ( !isPacingStarted ) {
+		isPacingStarted = true;
+		firstFrameTime	= frameTimeSeconds;
+		replayStartTime = std::chrono::steady_clock::now();
+	}
+
+	// Recorded offset on the steady clock
+	auto timeFrame = replayStartTime + std::chrono::duration_cast<std::chrono::steady_clock::duration>( std::chrono::duration<double>( frameTimeSeconds - firstFrameTime ) );
+
+	if ( replayMode == replayModeEnum::REAL_TIME ) {
+		std::this_thread::sleep_until( timeFrame );
+	}
+
+	return timeFrame;
+}
+
+
+void ReplaySourceClass::ResetPacing() {
+	isPacingStarted = false;
+}
+
+
+
+// Constructor
+RecordedSourceClass::RecordedSourceClass( const std::string& path, replayModeEnum mode, bool isLooping )
+	: ReplaySourceClass( mode )
+	, path( path )
+	, isLooping( isLooping ) { }
+
+
+/**
+ * @brief Open a video file or image directory and its timestamp file
+ */
+bool RecordedSourceClass::Open() {
+
+	// Image sequence if the path is a directory with images in it
+	imageFiles.clear();
+	if ( cv::utils::fs::isDirectory( path ) ) {
+		std::vector<cv::String> filesJpg, filesBmp;
+		cv::glob( path + "/*.png", imageFiles, false );
+		cv::glob( path + "/*.jpg", filesJpg, false );
+		cv::glob( path + "/*.bmp", filesBmp, false );
+		imageFiles.insert( imageFiles.end(), filesJpg.begin(), filesJpg.end() );
+		imageFiles.insert( imageFiles.end(), filesBmp.begin(), filesBmp.end() );
+		std::sort( imageFiles.begin(), imageFiles.end() );
+	}
+	isImageFolder = !imageFiles.empty();
+
+	// Otherwise treat it as a video file
+	if ( isImageFolder ) {
+		LoadTimestamps( path + "/timestamps.txt" );
+	} else {
+		Video.open( path, cv::CAP_ANY );
+		if ( !Video.isOpened() ) {
+			std::cerr << "CaptureClass: Could not open recording " << path << "\n";
+			return false;
+		}
+		LoadTimestamps( path + ".timestamps.txt" );
+	}
+
+	// Reset state
+	frameIndex = 0;
+	loopOffset = 0.0;
+	isFinished = false;
+	isOpen	   = true;
+	ResetPacing();
+
+	std::cout << "CaptureClass: Replaying " << Describe() << ", " << ( isImageFolder ? std::to_string( imageFiles.size() ) + " images" : "video" ) << ", " << timestamps.size() << " timestamps, " << ( replayMode == replayModeEnum::REAL_TIME ? "real-time" : "as fast as possible" ) << "\n";
+
+	return true;
+}
+
+
+/**
+ * @brief Read one timestamp in seconds per line
+ */
+bool RecordedSourceClass::LoadTimestamps( const std::string& timestampPath ) {
+
+	timestamps.clear();
+
+	std::ifstream file( timestampPath );
+	if ( !file.is_open() ) {
+		return false;
+	}
+
+	double value = 0.0;
+	while ( file >> value ) {
+		timestamps.push_back( value );
+	}
+
+	return !timestamps.empty();
+}
+
+
+/**
+ * @brief Recorded time of a frame, falling back to the nominal frame rate
+ */
+double RecordedSourceClass::FrameTime( size_t index ) const {
+
+	if ( index < timestamps.size() ) {
+		return timestamps[index];
+	} else if ( !timestamps.empty() ) {
+		return timestamps.back() + ( index - timestamps.size() + 1 ) / double( CONFIG_CAM_FRAMERATE );
+	}
+	return index / double( CONFIG_CAM_FRAMERATE );
+}
+
+
+/**
+ * @brief Next recorded frame, paced according to the replay mode
+ */
+bool RecordedSourceClass::Read( cv::Mat& frame, std::chrono::steady_clock::time_point& timeGrabbed, std::chrono::steady_clock::time_point& timeSource ) {
+
+	if ( !isOpen || isFinished ) {
+		return false;
+	}
+
+	// Decode next frame
+	bool isRead = isImageFolder ? ( frameIndex < imageFiles.size() ) : Video.read( frame );
+
+	// Wrap around at the end
+	if ( !isRead && isLooping && frameIndex > 0 ) {
+
+		// First frame of the next pass follows the last frame of this one
+		loopOffset += FrameTime( frameIndex - 1 ) - FrameTime( 0 ) + 1.0 / CONFIG_CAM_FRAMERATE;
+		frameIndex = 0;
+
+		if ( isImageFolder ) {
+			isRead = true;
+		} else {
+			Video.set( cv::CAP_PROP_POS_FRAMES, 0 );
+			isRead = Video.read( frame );
+		}
+	}
+
+	// Out of frames
+	if ( !isRead ) {
+		isFinished = true;
+		std::cout << "CaptureClass: Replay finished after " << frameIndex << " frames.\n";
+		return false;
+	}
+
+	if ( isImageFolder ) {
+		frame = cv::imread( imageFiles[frameIndex], cv::IMREAD_COLOR );
+	}
+
+	timeSource	= PaceFrame( FrameTime( frameIndex ) + loopOffset );
+	timeGrabbed = std::chrono::steady_clock::now();
+	frameIndex++;
+
+	return !frame.empty();
+}
+
+
+void RecordedSourceClass::Close() {
+	if ( Video.isOpened() ) {
+		Video.release();
+	}
+	isOpen = false;
+}
+
+
+bool RecordedSourceClass::IsOpen() const {
+	return isOpen;
+}
+
+
+bool RecordedSourceClass::IsFinished() const {
+	return isFinished;
+}
+
+
+std::string RecordedSourceClass::Describe() const {
+	return "recording " + path;
+}
+
+
+size_t RecordedSourceClass::FrameCount() const {
+	return imageFiles.size();
+}
+
+
+
+// Constructor
+SyntheticSourceClass::SyntheticSourceClass( GeneratorFunction generator, replayModeEnum mode )
+	: ReplaySourceClass( mode )
+	, generator( std::move( generator ) ) { }
+
+
+bool SyntheticSourceClass::Open() {
+	isOpen	   = static_cast<bool>( generator );
+	isFinished = false;
+	ResetPacing();
+	return isOpen;
+}
+
+
+/**
+ * @brief Next generated frame, paced according to the replay mode
+ */
+bool SyntheticSourceClass::Read( cv::Mat& frame, std::chrono::steady_clock::time_point& timeGrabbed, std::chrono::steady_clock::time_point& timeSource ) {
+
+	if ( !isOpen || isFinished ) {
+		return false;
+	}
+
+	double frameTime = 0.0;
+	if ( !generator( frame, frameTime ) ) {
+		isFinished = true;
+		return false;
+	}
+
+	timeSource	= PaceFrame( frameTime );
+	timeGrabbed = std::chrono::steady_clock::now();
+	return !frame.empty();
+}
+
+
+void SyntheticSourceClass::Close() {
+	isOpen = false;
+}
+
+
+bool SyntheticSourceClass::IsOpen() const {
+	return isOpen;
+}
+
+
+bool SyntheticSourceClass::IsFinished() const {
+	return isFinished;
+}
+
+
+std::string SyntheticSourceClass::Describe() const {
+	return "synthetic";
+}
@@ -1,7 +1,10 @@
 // Call to class header
 #include "InputClass.h"
+#include <algorithm>
 #include <chrono>
+#include <fstream>
 #include <iomanip>	  // For padding zeroes
+#include <sstream>
 #include <thread>
 
 // System data manager
@@ -39,6 +42,112 @@ void InputClass::ParseInput( int key ) {
 
 
 
+/**
+ * @brief Load a timed input script for headless runs
+ *
+ * One event per line, '#' starts a comment:
+ *     <seconds> key <k>          k is a character, "esc", "backspace" or a key code
+ *     <seconds> touch <x> <y>    press the touchscreen at task-window pixels
+ *     <seconds> release          lift the touch
+ *
+ * Keys go through the same bindings as the keyboard, so a script can do anything a user can.
+ *
+ * @param path Script file
+ * @return true if the file was read without errors
+ */
+bool InputClass::LoadScript( const std::string& path ) {
+
+	std::ifstream file( path );
+	if ( !file.is_open() ) {
+		std::cerr << "Input:   Could not open script " << path << "\n";
+		return false;
+	}
+
+	script.clear();
+	scriptIndex = 0;
+
+	std::string line;
+	int			lineNumber = 0;
+	bool		isValid	   = true;
+	while ( std::getline( file, line ) ) {
+		lineNumber++;
+		line = line.substr( 0, line.find( '#' ) );
+
+		std::istringstream tokens( line );
+		ScriptEventStruct  event;
+		std::string		   command;
+		if ( !( tokens >> event.timeS ) ) {
+			continue;
+		}
+		tokens >> command;
+
+		if ( command == "key" ) {
+			std::string key;
+			tokens >> key;
+			if ( key.size() == 1 ) {
+				event.key = key[0];
+			} else if ( key == "esc" ) {
+				event.key = 27;
+			} else if ( key == "backspace" ) {
+				event.key = 8;
+			} else if ( !key.empty() && std::all_of( key.begin(), key.end(), ::isdigit ) ) {
+				event.key = std::stoi( key );
+			} else {
+				event.key = 255;
+			}
+			if ( !keyBindings.count( event.key ) ) {
+				std::cerr << "Input:   Script line " << lineNumber << ": unbound key '" << key << "'\n";
+				isValid = false;
+				continue;
+			}
+			event.command = 'k';
+		} else if ( command == "touch" && ( tokens >> event.position.x >> event.position.y ) ) {
+			event.command = 't';
+		} else if ( command == "release" ) {
+			event.command = 'r';
+		} else {
+			std::cerr << "Input:   Script line " << lineNumber << ": cannot parse \"" << line << "\"\n";
+			isValid = false;
+			continue;
+		}
+
+		script.push_back( event );
+	}
+
+	std::stable_sort( script.begin(), script.end(), []( const ScriptEventStruct& a, const ScriptEventStruct& b ) { return a.timeS < b.timeS; } );
+	std::cout << "Input:   Loaded " << script.size() << " scripted events from " << path << "\n";
+
+	return isValid;
+}
+
+
+
+/**
+ * @brief Run every scripted event that is due, in place of keyboard polling
+ */
+void InputClass::ParseScript() {
+
+	while ( scriptIndex < script.size() && script[scriptIndex].timeS <= shared->Timing.elapsedRunningTime ) {
+
+		const ScriptEventStruct& event = script[scriptIndex++];
+		switch ( event.command ) {
+			case 'k':
+				ParseInput( event.key );
+				break;
+			case 't':
+				shared->Touchscreen.positionTouched.x = event.position.x;
+				shared->Touchscreen.positionTouched.y = event.position.y;
+				shared->Touchscreen.isTouched		  = true;
+				break;
+			case 'r':
+				shared->Touchscreen.isTouched = false;
+				break;
+		}
+	}
+}
+
+
+
 // Functions
 void InputClass::IncrementValueF( std::string name, float& target, float increment ) {
 
@@ -118,6 +227,12 @@ void InputClass::RegisterKeyBindings() {
 	keyBindings[8]	 = [this]() { K_DeselectAdjustment(); };
 	keyBindings['r'] = [this]() { K_SetReverseType(); };
 	keyBindings['q'] = [this]() { K_RotateCamera(); };
+	keyBindings['b'] = [this]() { K_CaptureBackendToggle(); };
+	keyBindings['u'] = [this]() { K_DetectionSpaceToggle(); };
+	keyBindings['k'] = [this]() { K_TrackingToggle(); };
+	keyBindings['l'] = [this]() { K_PyramidLevelCycle(); };
+	keyBindings['o'] = [this]() { K_ProfilerToggle(); };
+	keyBindings['e'] = [this]() { K_TraceToggle(); };
 }
 
 
@@ -155,7 +270,9 @@ void InputClass::K_Exit() {
 	shared->Amplifier.isAmplifierActive = false;
 	shared->Serial.isSerialSending		= false;
 	shared->Serial.isSerialSendOpen		= false;
-	cv::destroyAllWindows();
+	if ( !shared->System.isHeadless ) {
+		cv::destroyAllWindows();
+	}
 	std::cout << "Shutdown initiated.\n";
 	shared->System.isShuttingDown = true;
 }
@@ -201,12 +318,10 @@ void InputClass::K_AmplifierToggle() {
 	}
 
 	if ( shared->Amplifier.isAmplifierActive ) {
-		shared->Target.isTargetReset	  = true;
-		shared->Controller.isRampingUp	  = true;
-		shared->Controller.rampPercentage = 0.0f;
-		shared->Controller.rampStartTime  = shared->Timing.elapsedRunningTime;
-		shared->System.state			  = stateEnum::DRIVING_PWM;
-		shared->Display.statusString	  = "Input: Amplifiers enabled.";
+		shared->Target.isTargetReset = true;
+		shared->Controller.nRampRequests++;
+		shared->System.state		 = stateEnum::DRIVING_PWM;
+		shared->Display.statusString = "Input: Amplifiers enabled.";
 	} else {
 		// shared->Serial.packetOut = "DX\n";
 		// shared->FLAG_PACKET_WAITING = true;
@@ -254,6 +369,44 @@ void InputClass::K_RotateCamera() {
 	shared->Capture.rotateCamera = !shared->Capture.rotateCamera;
 }
 
+// Switch capture preprocessing between CPU and GPU
+void InputClass::K_CaptureBackendToggle() {
+
+	if ( !shared->Capture.isGpuAvailable ) {
+		shared->Display.statusString = "Input: No CUDA device, capture stays on CPU.";
+		return;
+	}
+
+	shared->Capture.backend		 = ( shared->Capture.backend == captureBackendEnum::GPU ) ? captureBackendEnum::CPU : captureBackendEnum::GPU;
+	shared->Display.statusString = ( shared->Capture.backend == captureBackendEnum::GPU ) ? "Input: Capture backend set to GPU." : "Input: Capture backend set to CPU.";
+}
+
+// Switch detection between the undistorted frame and raw frame with undistorted corners
+void InputClass::K_DetectionSpaceToggle() {
+	shared->Capture.detectionSpace = ( shared->Capture.detectionSpace == detectionSpaceEnum::RAW_CORNERS ) ? detectionSpaceEnum::UNDISTORTED_FRAME : detectionSpaceEnum::RAW_CORNERS;
+	shared->Display.statusString   = ( shared->Capture.detectionSpace == detectionSpaceEnum::RAW_CORNERS ) ? "Input: Detecting on raw frame, undistorting corners." : "Input: Detecting on undistorted frame.";
+}
+
+void InputClass::K_TrackingToggle() {
+	shared->Aruco.isTrackingEnabled = !shared->Aruco.isTrackingEnabled;
+	shared->Display.statusString	= shared->Aruco.isTrackingEnabled ? "Input: ROI tracking enabled." : "Input: ROI tracking disabled, full-frame search.";
+}
+
+void InputClass::K_PyramidLevelCycle() {
+	shared->Aruco.pyramidLevel	 = ( shared->Aruco.pyramidLevel + 1 ) % 3;
+	shared->Display.statusString = "Input: Full-frame search at 1/" + std::to_string( 1 << shared->Aruco.pyramidLevel ) + " resolution.";
+}
+
+void InputClass::K_ProfilerToggle() {
+	shared->Timing.isProfilerShown = !shared->Timing.isProfilerShown;
+	shared->Display.statusString   = shared->Timing.isProfilerShown ? "Input: Loop profiler shown." : "Input: Loop profiler hidden.";
+}
+
+// Start recording trace events, or stop and write them out
+void InputClass::K_TraceToggle() {
+	shared->Trace.isToggleRequested = true;
+}
+
 /*
  *
  *
@@ -407,12 +560,12 @@ void InputClass::K_TaskCalibrationStart() {
 
 void InputClass::K_FittsStart() {
 	// Run fitts-law test
-	shared->Target.activeID		   = 1;
-	shared->Target.isTargetReset   = true;
-	shared->Controller.isRampingUp = true;
-	shared->Touchscreen.isTouched  = 0;
-	shared->Task.isRunning		   = false;
-	shared->Task.state			   = taskEnum::FITTS;
+	shared->Target.activeID		 = 1;
+	shared->Target.isTargetReset = true;
+	shared->Controller.nRampRequests++;
+	shared->Touchscreen.isTouched = 0;
+	shared->Task.isRunning		  = false;
+	shared->Task.state			  = taskEnum::FITTS;
 	shared->Task.repetitionNumber++;
 	shared->Display.statusString = "Input: Starting fitts test.";
 }
@@ -9,6 +9,9 @@
 // Math
 #include <cmath>
 
+// Trace events
+#include "TraceClass.h"
+
 /**
  * @brief Construct a new Kalman Class:: Kalman Class object
  *
@@ -16,25 +19,7 @@
  */
 KalmanClass::KalmanClass( SystemDataManager& ctx )
 	: dataHandle( ctx )
-	, shared( ctx.getData() )
-	, isInitialized( false ) {
-
-	// Build matrices
-	state				= cv::Mat::zeros( 6, 1, CV_32F );
-	P					= cv::Mat::eye( 6, 6, CV_32F ) * 1.0f;
-	Q					= cv::Mat::eye( 6, 6, CV_32F ) * kalmanProcessNoiseCovarianceQ;
-	Q.at<float>( 3, 3 ) = 0.5f;	   // Velocity
-	Q.at<float>( 4, 4 ) = 0.5f;
-	Q.at<float>( 5, 5 ) = 0.5f;
-	R					= cv::Mat::eye( 3, 3, CV_32F ) * kalmanMeasurementNoiseR;
-	H					= cv::Mat::zeros( 3, 6, CV_32F );
-	I					= cv::Mat::eye( 6, 6, CV_32F );
-
-	// Only position is measured
-	H.at<float>( 0, 0 ) = 1.0f;
-	H.at<float>( 1, 1 ) = 1.0f;
-	H.at<float>( 2, 2 ) = 1.0f;
-}
+	, shared( ctx.getData() ) { }
 
 
 
@@ -48,16 +33,11 @@ void KalmanClass::Initialize( const cv::Point3f& initialPos, float tInitial ) {
 
 	// std::cout << "KalmanClass: Initializing Kalman filter.\n";
 
-	// Populate state
-	state.at<float>( 0 ) = initialPos.x;	// Position
-	state.at<float>( 1 ) = initialPos.y;
-	state.at<float>( 2 ) = initialPos.z;
-	state.at<float>( 3 ) = 0.0f;	// Velocity
-	state.at<float>( 4 ) = 0.0f;
-	state.at<float>( 5 ) = 0.0f;
-
-	// Reset covariance (optional, if you want a clean slate)
-	P = cv::Mat::eye( 6, 6, CV_32F ) * 1.0f;
+	// Active target only, the other markers keep their state
+	activeSlot = MarkerBankSlot( shared->Target.activeID );
+	if ( activeSlot >= 0 ) {
+		InitializeSlot( activeSlot, initialPos, tInitial );
+	}
 
 	// Update values
 	tPrevious	  = tInitial;
@@ -66,66 +46,111 @@ void KalmanClass::Initialize( const cv::Point3f& initialPos, float tInitial ) {
 
 
 	// Update flag
-	isInitialized				 = true;
 	shared->Target.isTargetReset = false;
 }
 
 
 
+/**
+ * @brief Start one marker's filter at rest on its measured position
+ */
+void KalmanClass::InitializeSlot( int slot, const cv::Point3f& initialPos, float tInitial ) {
+
+	const float initial[3] = { initialPos.x, initialPos.y, initialPos.z };
+	for ( size_t axis = 0; axis < 3; axis++ ) {
+		size_t lane			= axis * CONFIG_MARKER_BANK_SIZE + slot;
+		bank.position[lane] = initial[axis];
+		bank.velocity[lane] = 0.0f;
+		bank.p00[lane]		= 1.0f;
+		bank.p01[lane]		= 0.0f;
+		bank.p11[lane]		= 1.0f;
+	}
+	bank.tMeasured[slot]	 = tInitial;
+	bank.isInitialized[slot] = true;
+	bank.nRejected[slot]	 = 0;
+}
+
+
+
 /**
  * @brief Update kalman filter
  *
- * @param measuredPos       Measured position
- * @param currentTimestamp  Updated timestamp
+ * Corrects every bank marker found in this frame, markers that were not seen keep their state.
+ * Markers seen for the first time, or again after CONFIG_KALMAN_BANK_TIMEOUT_S, start over on
+ * their measurement, as does the active marker after a target reset. Each measurement is weighted
+ * by its detection quality and predicted across the time since that marker's last accepted
+ * measurement. The integral error follows the active target only.
+ *
+ * @param currentTimestamp  Capture time of the frame the measurements come from
  */
-void KalmanClass::Update( const cv::Point3f& measuredPos, float tCurrent ) {
+void KalmanClass::Update( float tCurrent ) {
 
+	TraceScope trace( shared->Trace, traceLaneEnum::MAIN, traceEventEnum::KALMAN );
 
+	// Active target starts over on its own next measurement, this frame's if it was seen, the rest of the bank carries on
 	if ( shared->Target.isTargetReset ) {
 
 		// shared->timingTimestamp = 0.0f;
-		tCurrent					 = 0.0f;
-		tPrevious					 = 0.0f;
 		shared->Target.isTargetReset = false;
-		Initialize( shared->Target.positionUnfilteredMM, shared->Timing.elapsedRunningTime );
+		activeSlot					 = MarkerBankSlot( shared->Target.activeID );
+		if ( activeSlot >= 0 ) {
+			bank.isInitialized[activeSlot] = false;
+		}
+		integralError = cv::Point3f( 0.0f, 0.0f, 0.0f );
+		prevError	  = cv::Point3f( 0.0f, 0.0f, 0.0f );
 		// std::cout << "KalmanClass: Reset\n";
-		return;
 	}
 
-
-
-	// Make sure the filter is initialized
-	if ( !isInitialized ) {
-		Initialize( measuredPos, tCurrent );
-		return;
+	// Integral error belongs to one target
+	int slot = MarkerBankSlot( shared->Target.activeID );
+	if ( slot != activeSlot ) {
+		activeSlot	  = slot;
+		integralError = cv::Point3f( 0.0f, 0.0f, 0.0f );
+		prevError	  = cv::Point3f( 0.0f, 0.0f, 0.0f );
 	}
 
-	// Normal Kalman update
+	// Integral step
 	dt		  = std::clamp( tCurrent - tPrevious, 1e-5f, kalmanTimeStepDt );
 	tPrevious = tCurrent;
 
+	// Load this frame's measurements
+	for ( size_t s = 0; s < CONFIG_MARKER_BANK_SIZE; s++ ) {
+
+		bool		isMeasured = shared->Target.isMarkerFound[s];
+		cv::Point3f measuredMM = shared->Target.markerPositionsMM[s];
+
+		if ( isMeasured && ( !bank.isInitialized[s] || tCurrent - bank.tMeasured[s] > CONFIG_KALMAN_BANK_TIMEOUT_S ) ) {
+			InitializeSlot( int( s ), measuredMM, tCurrent );
+			isMeasured = false;
+		}
+
+		// Detection noise, with a floor for sources that do not report it
+		const cv::Point3f varianceMM2 = shared->Target.markerVarianceMM2[s];
+		const float		  measured[3] = { measuredMM.x, measuredMM.y, measuredMM.z };
+		const float		  variance[3] = { varianceMM2.x, varianceMM2.y, varianceMM2.z };
+		const float		  dtMarker	  = std::max( tCurrent - bank.tMeasured[s], 1e-5f );
+		for ( size_t axis = 0; axis < 3; axis++ ) {
+			size_t lane			  = axis * CONFIG_MARKER_BANK_SIZE + s;
+			bank.measured[lane]	  = measured[axis];
+			bank.isMeasured[lane] = isMeasured ? 1.0f : 0.0f;
+			bank.noiseR[lane]	  = std::max( variance[axis], CONFIG_KALMAN_R_MIN_MM2 );
+			bank.dt[lane]		  = dtMarker;
+		}
+	}
 
-	F					= cv::Mat::eye( 6, 6, CV_32F );
-	F.at<float>( 0, 3 ) = dt;
-	F.at<float>( 1, 4 ) = dt;
-	F.at<float>( 2, 5 ) = dt;
-
-	state = F * state;
-	P	  = F * P * F.t() + Q;
-
-	z = ( cv::Mat_<float>( 3, 1 ) << measuredPos.x, measuredPos.y, measuredPos.z );
-	y = z - H * state;
-	S = H * P * H.t() + R;
+	// Drop outliers, then all markers and axes at once
+	Innovate();
+	Gate( tCurrent );
+	PredictAndCorrect();
 
-	if ( cv::determinant( S ) > 1e-6f ) {
-		K	  = P * H.t() * S.inv();
-		state = state + K * y;
-		P	  = ( I - K * H ) * P;
-	} else {
-		std::cerr << "KalmanClass: S matrix not invertible, skipping update.\n";
+	// Integral only from a corrected active target, not on the frame it starts over
+	if ( activeSlot < 0 || bank.isMeasured[activeSlot] == 0.0f ) {
+		shared->Latency.timeFiltered = std::chrono::steady_clock::now();
+		return;
 	}
 
 	// Calculate integral term
+	cv::Point3f measuredPos		 = shared->Target.markerPositionsMM[activeSlot];
 	cv::Point3f positionEstimate = GetPosition();
 	cv::Point3f error			 = positionEstimate - ( measuredPos * -1 );
 	float		errorMagnitude	 = cv::norm( cv::Point2f( error.x, error.y ) );
@@ -148,9 +173,122 @@ void KalmanClass::Update( const cv::Point3f& measuredPos, float tCurrent ) {
 
 	// Save for derivative use
 	prevError = error;
+
+	// Filter stage done for this frame
+	shared->Latency.timeFiltered = std::chrono::steady_clock::now();
+}
+
+
+
+/**
+ * @brief Innovation and its variance for every lane, without touching the state
+ */
+void KalmanClass::Innovate() {
+
+	for ( size_t i = 0; i < KALMAN_LANES; i++ ) {
+
+		const float m	= bank.isMeasured[i];
+		const float dtM = bank.dt[i] * m;
+
+		float x	  = bank.position[i] + dtM * bank.velocity[i];
+		float p00 = bank.p00[i] + dtM * ( 2.0f * bank.p01[i] + dtM * bank.p11[i] ) + m * kalmanProcessNoiseCovarianceQ;
+
+		bank.innovation[i]	= bank.measured[i] - x;
+		bank.innovationS[i] = p00 + bank.noiseR[i];
+	}
+}
+
+
+
+/**
+ * @brief Innovation gate, replaces a fixed jump threshold
+ *
+ * The squared innovations of a marker's three axes, each over its variance, are chi-square with
+ * three degrees of freedom for a good measurement. Measurements beyond CONFIG_KALMAN_GATE_CHI2 are
+ * left out and the marker keeps its prediction, unless the jump is within CONFIG_KALMAN_GATE_MIN_MM,
+ * so quick but real hand movements are never rejected. After CONFIG_KALMAN_GATE_MAX_REJECTS
+ * rejections in a row the marker starts over on the measurement.
+ */
+void KalmanClass::Gate( float tCurrent ) {
+
+	for ( size_t s = 0; s < CONFIG_MARKER_BANK_SIZE; s++ ) {
+
+		if ( bank.isMeasured[s] == 0.0f ) {
+			continue;
+		}
+
+		float distanceSquared = 0.0f;
+		float normalized	  = 0.0f;
+		for ( size_t axis = 0; axis < 3; axis++ ) {
+			size_t lane = axis * CONFIG_MARKER_BANK_SIZE + s;
+			distanceSquared += bank.innovation[lane] * bank.innovation[lane];
+			normalized += bank.innovation[lane] * bank.innovation[lane] / bank.innovationS[lane];
+		}
+
+		// Consistent with the prediction
+		if ( normalized <= CONFIG_KALMAN_GATE_CHI2 || distanceSquared <= CONFIG_KALMAN_GATE_MIN_MM * CONFIG_KALMAN_GATE_MIN_MM ) {
+			bank.nRejected[s] = 0;
+			bank.tMeasured[s] = tCurrent;
+			continue;
+		}
+
+		// Outlier, keep the prediction
+		shared->Target.nMeasurementsGated++;
+		for ( size_t axis = 0; axis < 3; axis++ ) {
+			bank.isMeasured[axis * CONFIG_MARKER_BANK_SIZE + s] = 0.0f;
+		}
+
+		// Keeps happening, the marker really jumped
+		if ( ++bank.nRejected[s] >= CONFIG_KALMAN_GATE_MAX_REJECTS ) {
+			InitializeSlot( int( s ), shared->Target.markerPositionsMM[s], tCurrent );
+			if ( int( s ) == activeSlot ) {
+				integralError = cv::Point3f( 0.0f, 0.0f, 0.0f );
+				prevError	  = cv::Point3f( 0.0f, 0.0f, 0.0f );
+			}
+		}
+	}
 }
 
 
+
+/**
+ * @brief Predict and correct every lane with the closed-form 2x2 update
+ *
+ * F = [1 dt; 0 1], H = [1 0], Q = diag( qPos, qVel ) and per-lane R, which makes S a scalar and
+ * the gain K = P.col( 0 ) / S. Same result as a coupled 6x6 filter per marker with diagonal Q and
+ * R. Lanes without a measurement run with dt, Q and K scaled to zero, which leaves them unchanged,
+ * so the loop has no branches and vectorizes. S >= R > 0, no invertibility check needed.
+ */
+void KalmanClass::PredictAndCorrect() {
+
+	for ( size_t i = 0; i < KALMAN_LANES; i++ ) {
+
+		const float m	= bank.isMeasured[i];
+		const float dtM = bank.dt[i] * m;
+
+		// Predict, P = F * P * F' + Q
+		float x	  = bank.position[i] + dtM * bank.velocity[i];
+		float p00 = bank.p00[i] + dtM * ( 2.0f * bank.p01[i] + dtM * bank.p11[i] ) + m * kalmanProcessNoiseCovarianceQ;
+		float p01 = bank.p01[i] + dtM * bank.p11[i];
+		float p11 = bank.p11[i] + m * kalmanProcessNoiseVelocityQ;
+
+		// Gain and innovation
+		float S	 = p00 + bank.noiseR[i];
+		float k0 = m * p00 / S;
+		float k1 = m * p01 / S;
+		float y	 = bank.measured[i] - x;
+
+		// Correct, P = ( I - K * H ) * P
+		bank.position[i] = x + k0 * y;
+		bank.velocity[i] += k1 * y;
+		bank.p00[i] = ( 1.0f - k0 ) * p00;
+		bank.p01[i] = ( 1.0f - k0 ) * p01;
+		bank.p11[i] = p11 - k1 * p01;
+	}
+}
+
+
+
 // /**
 //  * @brief Get covariance matrix
 //  *
@@ -169,7 +307,11 @@ void KalmanClass::Update( const cv::Point3f& measuredPos, float tCurrent ) {
  */
 cv::Point3f KalmanClass::GetPosition() const {
 
-	return cv::Point3f( state.at<float>( 0 ), state.at<float>( 1 ), state.at<float>( 2 ) );
+	int slot = MarkerBankSlot( shared->Target.activeID );
+	if ( slot < 0 ) {
+		return cv::Point3f( 0.0f, 0.0f, 0.0f );
+	}
+	return cv::Point3f( bank.position[slot], bank.position[CONFIG_MARKER_BANK_SIZE + slot], bank.position[2 * CONFIG_MARKER_BANK_SIZE + slot] );
 }
 
 
@@ -181,7 +323,11 @@ cv::Point3f KalmanClass::GetPosition() const {
  */
 cv::Point3f KalmanClass::GetVelocity() const {
 
-	return cv::Point3f( state.at<float>( 3 ), state.at<float>( 4 ), state.at<float>( 5 ) );
+	int slot = MarkerBankSlot( shared->Target.activeID );
+	if ( slot < 0 ) {
+		return cv::Point3f( 0.0f, 0.0f, 0.0f );
+	}
+	return cv::Point3f( bank.velocity[slot], bank.velocity[CONFIG_MARKER_BANK_SIZE + slot], bank.velocity[2 * CONFIG_MARKER_BANK_SIZE + slot] );
 }
 
 
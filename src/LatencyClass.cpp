@@ -0,0 +1,166 @@
+// Call to class header
+#include "LatencyClass.h"
+
+// Standard libraries
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+// System data manager
+#include "SystemDataManager.h"
+
+
+/**
+ * @brief Constructor
+ */
+LatencyClass::LatencyClass( SystemDataManager& ctx )
+	: dataHandle( ctx )
+	, shared( ctx.getData() ) { }
+
+
+
+/**
+ * @brief Record the stage latencies of a newly captured frame and of every control tick matched so far
+ *
+ * Stamps are only trusted while they keep increasing from the grab time, anything older belongs to a
+ * previous frame and ends the chain there. Control ticks are matched to pending frames by grab time,
+ * frames the controller never picked up are dropped on the way. The total is only recorded for
+ * frames that made it all the way to the serial port.
+ */
+void LatencyClass::Update() {
+
+	using namespace std::chrono;
+
+	auto elapsedMS = []( steady_clock::time_point from, steady_clock::time_point to ) {
+		return duration<double, std::milli>( to - from ).count();
+	};
+
+	// One record per captured frame
+	if ( shared->Capture.isFrameReady && shared->Capture.timeGrabbed != timeRecorded ) {
+		timeRecorded = shared->Capture.timeGrabbed;
+
+		const LatencyStruct& stamps = shared->Latency;
+		if ( stamps.timeDetected >= timeRecorded ) {
+			histCaptureToDetect.Add( elapsedMS( timeRecorded, stamps.timeDetected ) );
+
+			if ( stamps.timeFiltered >= stamps.timeDetected ) {
+				histDetectToFilter.Add( elapsedMS( stamps.timeDetected, stamps.timeFiltered ) );
+
+				// Rest of the chain comes with the control tick, a few frames is plenty to wait for it
+				framesPending.push_back( { timeRecorded, stamps.timeFiltered } );
+				if ( framesPending.size() > 8 ) {
+					framesPending.pop_front();
+				}
+			}
+		}
+
+		// Percentiles walk the bins, no need to do that every frame
+		if ( ++nFramesSinceSummary >= 30 ) {
+			nFramesSinceSummary = 0;
+			UpdateSummary();
+		}
+	}
+
+	// Control ticks since the last loop, each on its own frame
+	ControlStampStruct tick;
+	while ( shared->Latency.controlStamps.Pop( tick ) ) {
+
+		while ( !framesPending.empty() && framesPending.front().timeGrabbed < tick.timeCaptured ) {
+			framesPending.pop_front();
+		}
+		if ( framesPending.empty() || framesPending.front().timeGrabbed != tick.timeCaptured ) {
+			continue;
+		}
+		const LatencyFrameStruct frame = framesPending.front();
+		framesPending.pop_front();
+
+		if ( tick.timeControlled >= frame.timeFiltered ) {
+			histFilterToControl.Add( elapsedMS( frame.timeFiltered, tick.timeControlled ) );
+
+			if ( tick.timeSent >= tick.timeControlled ) {
+				histControlToSend.Add( elapsedMS( tick.timeControlled, tick.timeSent ) );
+				histCaptureToSend.Add( elapsedMS( frame.timeGrabbed, tick.timeSent ) );
+			}
+		}
+	}
+}
+
+
+
+/**
+ * @brief Copy the current percentiles into shared data for the display
+ */
+void LatencyClass::UpdateSummary() {
+
+	shared->Latency.totalP50MS	 = histCaptureToSend.Percentile( 0.50 );
+	shared->Latency.totalP95MS	 = histCaptureToSend.Percentile( 0.95 );
+	shared->Latency.totalMaxMS	 = histCaptureToSend.Max();
+	shared->Latency.detectP50MS	 = histCaptureToDetect.Percentile( 0.50 );
+	shared->Latency.filterP50MS	 = histDetectToFilter.Percentile( 0.50 );
+	shared->Latency.controlP50MS = histFilterToControl.Percentile( 0.50 );
+	shared->Latency.sendP50MS	 = histControlToSend.Percentile( 0.50 );
+	shared->Latency.nFrames		 = histCaptureToSend.Count();
+}
+
+
+
+/**
+ * @brief Print the latency table and save the histograms
+ *
+ * @param timestamp Appended to the file name, as used by the task logs
+ */
+void LatencyClass::Dump( const std::string& timestamp ) {
+
+	UpdateSummary();
+
+	const std::pair<const char*, const HistogramClass*> segments[] = {
+		{ "capture->detect", &histCaptureToDetect },
+		{ "detect->filter", &histDetectToFilter },
+		{ "filter->control", &histFilterToControl },
+		{ "control->send", &histControlToSend },
+		{ "capture->send", &histCaptureToSend },
+	};
+
+	// Console table
+	std::cout << "LatencyClass: Glass-to-motor latency [ms]\n";
+	std::cout << std::left << std::setw( 18 ) << "  segment" << std::right << std::setw( 9 ) << "count" << std::setw( 9 ) << "mean" << std::setw( 9 ) << "p50" << std::setw( 9 ) << "p95" << std::setw( 9 ) << "p99" << std::setw( 9 ) << "max" << "\n";
+	std::cout << std::fixed << std::setprecision( 2 );
+	for ( const auto& [name, hist] : segments ) {
+		std::cout << "  " << std::left << std::setw( 16 ) << name << std::right << std::setw( 9 ) << hist->Count() << std::setw( 9 ) << hist->Mean() << std::setw( 9 ) << hist->Percentile( 0.50 ) << std::setw( 9 ) << hist->Percentile( 0.95 ) << std::setw( 9 ) << hist->Percentile( 0.99 ) << std::setw( 9 ) << hist->Max() << "\n";
+	}
+	std::cout << std::defaultfloat;
+
+	if ( histCaptureToDetect.Count() == 0 ) {
+		return;
+	}
+
+	// Histogram file, one row per non-empty bin
+	std::filesystem::path folder( CONFIG_LOGGING_PATH );
+	std::error_code		  error;
+	std::filesystem::create_directories( folder, error );
+	std::filesystem::path filename = folder / ( "latency" + timestamp + ".txt" );
+
+	std::ofstream file( filename );
+	if ( !file.is_open() ) {
+		std::cerr << "LatencyClass: Could not write " << filename << "\n";
+		return;
+	}
+
+	file << "segment,count,mean_ms,p50_ms,p95_ms,p99_ms,max_ms\n";
+	for ( const auto& [name, hist] : segments ) {
+		file << name << "," << hist->Count() << "," << hist->Mean() << "," << hist->Percentile( 0.50 ) << "," << hist->Percentile( 0.95 ) << "," << hist->Percentile( 0.99 ) << "," << hist->Max() << "\n";
+	}
+
+	file << "\nsegment,bin_start_ms,count\n";
+	for ( const auto& [name, hist] : segments ) {
+		const std::vector<uint64_t>& bins = hist->Bins();
+		for ( size_t i = 0; i < bins.size(); i++ ) {
+			if ( bins[i] ) {
+				file << name << "," << i * hist->BinWidth() << "," << bins[i] << "\n";
+			}
+		}
+	}
+
+	std::cout << "LatencyClass: Saved " << filename.string() << "\n";
+}
@@ -75,6 +75,10 @@ void LoggingClass::AddEntry() {
 	newEntry.custom9  = shared->Logging.variable9;
 	newEntry.custom10 = shared->Logging.variable10;
 
+	// Loop health, so degraded runs can be found in the data
+	newEntry.loopPeriodMS  = shared->Timing.loopPeriodMS;
+	newEntry.nOverrunsTask = shared->Timing.nOverrunsTask;
+
 	// Save entry
 	logFile.push_back( newEntry );
 
@@ -102,13 +106,13 @@ void LoggingClass::SaveTxt() {
 
 	// Write header
 	std::string headerString = "timestamp,Xmm,Ymm,Zmm," + shared->Logging.header1 + "," + shared->Logging.header2 + "," + shared->Logging.header3 + "," + shared->Logging.header4 + "," + shared->Logging.header5 + "," + shared->Logging.header6 + "," + shared->Logging.header7 + ","
-		+ shared->Logging.header8 + "," + shared->Logging.header9 + "," + shared->Logging.header10 + "\n";
+		+ shared->Logging.header8 + "," + shared->Logging.header9 + "," + shared->Logging.header10 + ",loopPeriodMS,loopMisses\n";
 	file << headerString;
 
 	// Write file contents
 	for ( const auto& entry : logFile ) {
 		file << entry.timestamp << "," << entry.telemetry.x << "," << entry.telemetry.y << "," << entry.telemetry.z << "," << entry.custom1 << "," << entry.custom2 << "," << entry.custom3 << "," << entry.custom4 << "," << entry.custom5 << "," << entry.custom6 << "," << entry.custom7 << ","
-			 << entry.custom8 << "," << entry.custom9 << "," << entry.custom10 << "\n";
+			 << entry.custom8 << "," << entry.custom9 << "," << entry.custom10 << "," << entry.loopPeriodMS << "," << entry.nOverrunsTask << "\n";
 	}
 
 	// Close file
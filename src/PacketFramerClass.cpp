@@ -0,0 +1,168 @@
+// Call to class header
+#include "PacketFramerClass.h"
+
+// Standard libraries
+#include <algorithm>
+#include <cstring>
+
+
+/**
+ * @brief Contiguous free space at the write end of the ring, for read() to fill
+ *
+ * A ring with no room left holds nothing but undecodable bytes, those are dropped.
+ *
+ * @param nFree Bytes that may be written
+ * @return uint8_t* Where to write them, hand the count actually written to Commit()
+ */
+uint8_t* PacketFramerClass::WriteSpace( size_t& nFree ) {
+
+	if ( tail - head == RING_SIZE ) {
+		counters.nBytesSkipped += RING_SIZE;
+		head = tail;
+	}
+
+	nFree = std::min( RING_SIZE - ( tail - head ), RING_SIZE - ( tail & ( RING_SIZE - 1 ) ) );
+	return &ring[tail & ( RING_SIZE - 1 )];
+}
+
+
+
+/**
+ * @brief Take bytes written into WriteSpace() into the ring
+ */
+void PacketFramerClass::Commit( size_t nBytes ) {
+	tail += nBytes;
+}
+
+
+
+/**
+ * @brief Copy bytes into the ring, call Next() until it returns false before the ring fills up
+ */
+void PacketFramerClass::Write( const uint8_t* bytes, size_t nBytes ) {
+
+	while ( nBytes > 0 ) {
+		size_t	 nFree = 0;
+		uint8_t* space = WriteSpace( nFree );
+		size_t	 n	   = std::min( nFree, nBytes );
+		std::memcpy( space, bytes, n );
+		Commit( n );
+		bytes += n;
+		nBytes -= n;
+	}
+}
+
+
+
+/**
+ * @brief Decode the next complete frame in the ring
+ *
+ * @param outPacket Status packet or telemetry batch, filled when a valid frame was found
+ * @return true if a packet was decoded, false once more bytes are needed
+ */
+bool PacketFramerClass::Next( FramedPacketStruct& outPacket ) {
+
+	while ( true ) {
+
+		// Resync on the start byte
+		while ( head != tail && ring[head & ( RING_SIZE - 1 )] != START_BYTE ) {
+			head++;
+			counters.nBytesSkipped++;
+		}
+
+		// Length is known as soon as it arrives
+		if ( tail - head < 2 ) {
+			return false;
+		}
+		const uint8_t packetLength = ring[( head + 1 ) & ( RING_SIZE - 1 )];
+		if ( packetLength != sizeof( PacketStruct ) && packetLength != sizeof( TelemetryPacketStruct ) ) {
+			counters.nFramingErrors++;
+			head++;
+			continue;
+		}
+
+		// Rest of the frame still on the wire
+		const size_t frameLength = size_t( packetLength ) + 4;
+		if ( tail - head < frameLength ) {
+			return false;
+		}
+		for ( size_t i = 0; i < frameLength; i++ ) {
+			frame[i] = ring[( head + i ) & ( RING_SIZE - 1 )];
+		}
+
+		// Footer, then checksum
+		if ( frame[frameLength - 1] != END_BYTE ) {
+			counters.nFramingErrors++;
+			head++;
+			continue;
+		}
+		if ( Checksum( &frame[3], packetLength ) != frame[2] ) {
+			counters.nChecksumErrors++;
+			head++;
+			continue;
+		}
+
+		outPacket.isTelemetry = packetLength == sizeof( TelemetryPacketStruct );
+		if ( outPacket.isTelemetry ) {
+			std::memcpy( &outPacket.telemetry, &frame[3], sizeof( TelemetryPacketStruct ) );
+		} else {
+			std::memcpy( &outPacket.packet, &frame[3], sizeof( PacketStruct ) );
+		}
+		head += frameLength;
+		counters.nPackets++;
+		return true;
+	}
+}
+
+
+
+/**
+ * @brief Forget buffered bytes and statistics
+ */
+void PacketFramerClass::Reset() {
+
+	head	 = 0;
+	tail	 = 0;
+	counters = SerialCountersStruct();
+}
+
+
+
+/**
+ * @brief Frame checksum, same on the PC and the Teensy
+ *
+ * @param payload Packet bytes, the packet type first
+ * @param packetLength Payload length
+ * @return uint8_t
+ */
+uint8_t PacketFramerClass::Checksum( const uint8_t* payload, uint8_t packetLength ) {
+
+	uint8_t checkSum = payload[0] ^ packetLength;
+	for ( size_t i = 0; i < packetLength; ++i ) {
+		checkSum ^= payload[i];
+	}
+	return checkSum;
+}
+
+
+
+/**
+ * @brief Frame a payload: start byte, length, checksum, payload, end byte
+ *
+ * @param payload Packet bytes, the packet type first
+ * @param packetLength Payload length
+ * @param buffer At least packetLength + 4 bytes
+ * @return size_t Number of bytes to write
+ */
+size_t PacketFramerClass::Encode( const uint8_t* payload, uint8_t packetLength, uint8_t* buffer ) {
+
+	size_t idx	  = 0;
+	buffer[idx++] = START_BYTE;
+	buffer[idx++] = packetLength;
+	buffer[idx++] = Checksum( payload, packetLength );
+	std::memcpy( &buffer[idx], payload, packetLength );
+	idx += packetLength;
+	buffer[idx++] = END_BYTE;
+
+	return idx;
+}
@@ -0,0 +1,236 @@
+// Call to class header
+#include "PlantSimulatorClass.h"
+
+// Standard libraries
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <deque>
+
+// System data manager
+#include "SystemDataManager.h"
+
+// Code under test
+#include "ControllerClass.h"
+#include "KalmanClass.h"
+
+
+// Cable directions, same motor angles as ControllerClass
+static const cv::Point2f motorDirections[3] = {
+	cv::Point2f( std::cos( 35.0f * DEG2RAD ), std::sin( 35.0f * DEG2RAD ) ),
+	cv::Point2f( std::cos( 145.0f * DEG2RAD ), std::sin( 145.0f * DEG2RAD ) ),
+	cv::Point2f( std::cos( 270.0f * DEG2RAD ), std::sin( 270.0f * DEG2RAD ) ),
+};
+
+
+/**
+ * @brief Constructor
+ */
+PlantSimulatorClass::PlantSimulatorClass( SystemDataManager& ctx, const PlantSettingsStruct& plantSettings )
+	: settings( plantSettings )
+	, dataHandle( ctx )
+	, shared( ctx.getData() ) { }
+
+
+
+/**
+ * @brief Run the closed loop from rest for a while
+ *
+ * @param durationS		[s] Simulated time
+ * @param targetPath	Target position relative to the aim at rest over simulated time [s], Target.positionUnfilteredMM convention
+ * @return PlantResultStruct
+ */
+PlantResultStruct PlantSimulatorClass::Run( float durationS, const std::function<cv::Point3f( float )>& targetPath ) {
+
+	using namespace std::chrono;
+
+	auto timeWallStart = steady_clock::now();
+
+	// Simulated clock for the controller's frame ages
+	auto clockAt = []( double t ) {
+		return steady_clock::time_point() + duration_cast<steady_clock::duration>( duration<double>( t ) );
+	};
+
+	// Fresh filter and controller on the shared data
+	KalmanClass		Kalman( dataHandle );
+	ControllerClass Controller( dataHandle );
+	cv::RNG			rng( settings.seed );
+
+	// Plant at rest
+	aimMM		   = cv::Point2f( 0.0f, 0.0f );
+	aimVelocityMMS = cv::Point2f( 0.0f, 0.0f );
+	currentABC	   = cv::Point3f( 0.0f, 0.0f, 0.0f );
+	appliedPwmABC  = cv::Point3i( 2048, 2048, 2048 );
+
+	// Ramp up as when the amplifiers are switched on, latencies as the predictor would measure them
+	shared->Controller.nRampRequests++;
+	shared->Latency.sendP50MS	 = 0.0f;
+	shared->Serial.packetDelay	 = int8_t( std::clamp( std::lround( settings.commandDelayMS ), 0L, 127L ) );
+	shared->Target.isTargetReset = false;
+	shared->Target.isMarkerFound.fill( false );
+	const int slot = MarkerBankSlot( shared->Target.activeID );
+
+	// In flight between stages
+	struct FrameStruct {
+		double		timeDelivered;
+		double		timeCaptured;
+		bool		isFound;
+		cv::Point3f positionMM;
+	};
+	struct CommandStruct {
+		double		timeApplied;
+		cv::Point3i pwmABC;
+	};
+	std::deque<FrameStruct>	  frames;
+	std::deque<CommandStruct> commands;
+
+	// Fixed steps, events on integer counters so long runs do not drift
+	const double   dt			= settings.physicsStepS;
+	const uint64_t nSteps		= uint64_t( durationS / dt );
+	const double   framePeriod	= 1.0 / settings.cameraRateHz;
+	const double   tickPeriod	= 1.0 / CONFIG_CONTROL_RATE_HZ;
+	uint64_t	   nFrame		= 0;
+	uint64_t	   nTick		= 0;
+	double		   errorSquared = 0.0;
+	double		   currentSum	= 0.0;
+	double		   timeOutside	= 0.0;
+
+	PlantResultStruct  result;
+	ControlInputStruct input;
+
+	// Overshoot is measured along the line from rest to where the target starts
+	cv::Point3f targetStart = targetPath( 0.0f );
+	cv::Point2f reach		= cv::Point2f( targetStart.x, targetStart.y );
+	float		reachMM		= float( cv::norm( reach ) );
+	reach					= ( reachMM > 0.0f ) ? reach * ( 1.0f / reachMM ) : reach;
+
+	for ( uint64_t step = 0; step <= nSteps; step++ ) {
+
+		const double t		= step * dt;
+		cv::Point3f	 target = targetPath( float( t ) );
+
+		// Camera exposes a frame
+		if ( t >= nFrame * framePeriod ) {
+			nFrame++;
+			FrameStruct frame;
+			frame.timeCaptured	= t;
+			frame.timeDelivered = t + settings.cameraLatencyMS / 1000.0;
+			frame.isFound		= rng.uniform( 0.0f, 1.0f ) >= settings.cameraDropout;
+			frame.positionMM	= target - cv::Point3f( aimMM.x, aimMM.y, 0.0f ) + cv::Point3f( rng.gaussian( settings.cameraNoiseMM ), rng.gaussian( settings.cameraNoiseMM ), rng.gaussian( settings.cameraNoiseMM ) );
+			frames.push_back( frame );
+		}
+
+		// Detection result reaches the filter, as in UpdateSystem()
+		while ( !frames.empty() && frames.front().timeDelivered <= t ) {
+
+			const FrameStruct& frame			= frames.front();
+			shared->Target.isTargetFound		= frame.isFound;
+			shared->Target.positionUnfilteredMM = frame.positionMM;
+			if ( slot >= 0 ) {
+				shared->Target.isMarkerFound[slot]	   = frame.isFound;
+				shared->Target.markerPositionsMM[slot] = frame.positionMM;
+				shared->Target.markerVarianceMM2[slot] = cv::Point3f( 1.0f, 1.0f, 1.0f ) * ( settings.cameraNoiseMM * settings.cameraNoiseMM );
+			}
+
+			Kalman.Update( float( frame.timeCaptured ) );
+
+			input.isTargetFound = frame.isFound;
+			if ( frame.isFound ) {
+				input.positionFilteredMM   = Kalman.GetPosition();
+				input.velocityFilteredMM   = Kalman.GetVelocity();
+				input.positionIntegratedMM = Kalman.GetIntegralError();
+			}
+			input.timeCaptured = clockAt( frame.timeCaptured );
+			Controller.SetInput( input );
+
+			result.nFrames++;
+			frames.pop_front();
+		}
+
+		// Control tick, command leaves for the Teensy
+		if ( t >= nTick * tickPeriod ) {
+			nTick++;
+			shared->Timing.elapsedRunningTime = float( t );
+			Controller.SetSettings( Controller.ReadSettings() );
+			Controller.Update( clockAt( t ) );
+			commands.push_back( { t + settings.commandDelayMS / 1000.0, Controller.GetOutput().commandedPwmABC } );
+			result.nTicks++;
+		}
+
+		// Command arrives at the amplifier
+		while ( !commands.empty() && commands.front().timeApplied <= t ) {
+			appliedPwmABC = commands.front().pwmABC;
+			commands.pop_front();
+		}
+
+		// Plant
+		bool isOverLimit = false;
+		StepAmplifier( float( dt ), isOverLimit );
+		StepFinger( float( dt ) );
+		result.nOverLimit += isOverLimit ? 1 : 0;
+
+		// Score the true error, not the measured one
+		float error = float( cv::norm( cv::Point2f( target.x, target.y ) - aimMM ) );
+		errorSquared += error * error;
+		currentSum += ( currentABC.x + currentABC.y + currentABC.z ) / 3.0;
+		result.errorMaxMM = std::max( result.errorMaxMM, error );
+		result.errorEndMM = error;
+		if ( reachMM > 0.0f ) {
+			result.overshootMM = std::max( result.overshootMM, aimMM.dot( reach ) - ( cv::Point2f( target.x, target.y ).dot( reach ) ) );
+		}
+		if ( error > settings.settleBandMM ) {
+			timeOutside = t + dt;
+		}
+	}
+
+	result.errorRMSMM	= float( std::sqrt( errorSquared / ( nSteps + 1 ) ) );
+	result.currentMeanA = float( currentSum / ( nSteps + 1 ) );
+	result.settleTimeS	= ( result.errorEndMM <= settings.settleBandMM ) ? float( timeOutside ) : -1.0f;
+	result.wallTimeS	= duration<double>( steady_clock::now() - timeWallStart ).count();
+
+	return result;
+}
+
+
+
+/**
+ * @brief Firmware PWM mapping, current limit and current loop lag, reported back like a feedback packet
+ */
+void PlantSimulatorClass::StepAmplifier( float dt, bool& isOverLimit ) {
+
+	const int	pwm[3]		 = { appliedPwmABC.x, appliedPwmABC.y, appliedPwmABC.z };
+	float*		current[3]	 = { &currentABC.x, &currentABC.y, &currentABC.z };
+	int16_t*	reported[3]	 = { &shared->Amplifier.currentMeasuredRawA, &shared->Amplifier.currentMeasuredRawB, &shared->Amplifier.currentMeasuredRawC };
+	bool*		overLimit[3] = { &shared->Amplifier.isOverLimitA, &shared->Amplifier.isOverLimitB, &shared->Amplifier.isOverLimitC };
+	const float blend		 = 1.0f - std::exp( -dt / ( settings.currentTauMS / 1000.0f ) );
+
+	for ( size_t m = 0; m < 3; m++ ) {
+
+		// Inverse of ControllerClass::MapToPWM, 2048 is off
+		float demand = std::clamp( ( 2048 - pwm[m] ) / 2047.0f, 0.0f, 1.0f ) * CONFIG_DEVICE_NOMINAL_CURRENT;
+
+		*overLimit[m] = demand > settings.currentLimitA;
+		isOverLimit	  = isOverLimit || *overLimit[m];
+
+		*current[m] += ( std::min( demand, settings.currentLimitA ) - *current[m] ) * blend;
+		*reported[m] = int16_t( std::lround( *current[m] * 100.0f ) );
+	}
+}
+
+
+
+/**
+ * @brief Damped hand with the three cables pulling the aim along the motor directions
+ */
+void PlantSimulatorClass::StepFinger( float dt ) {
+
+	const float omega = 2.0f * float( CV_PI ) * settings.fingerNaturalHz;
+
+	// Cables only pull
+	cv::Point2f pull = motorDirections[0] * currentABC.x + motorDirections[1] * currentABC.y + motorDirections[2] * currentABC.z;
+
+	// Semi-implicit Euler, stable well past the hand's bandwidth at the default step
+	cv::Point2f acceleration = ( pull * settings.fingerGainMMPerA - aimMM ) * ( omega * omega ) - aimVelocityMMS * ( 2.0f * settings.fingerDampingRatio * omega );
+	aimVelocityMMS += acceleration * dt;
+	aimMM += aimVelocityMMS * dt;
+}
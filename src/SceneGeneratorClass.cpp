@@ -0,0 +1,243 @@
+// Call to class header
+#include "SceneGeneratorClass.h"
+
+// Standard libraries
+#include <algorithm>
+#include <cmath>
+
+// OpenCV
+#include <opencv2/calib3d.hpp>
+#include <opencv2/imgproc.hpp>
+
+// Runtime configuration
+#include "config.h"
+
+
+
+// Constructor
+SceneGeneratorClass::SceneGeneratorClass( uint64_t seed )
+	: rng( seed ) {
+
+	arucoDictionary = cv::aruco::getPredefinedDictionary( cv::aruco::DICT_4X4_50 );
+	markerPatches.resize( arucoDictionary.bytesList.rows );
+
+	BuildDistortionMap();
+}
+
+
+/**
+ * @brief For every raw camera pixel, find where it lands in the ideal (undistorted) image
+ *
+ * This is the inverse of the map UndistortClass uses, so remapping an ideal render through it
+ * produces an image with the real lens distortion.
+ */
+void SceneGeneratorClass::BuildDistortionMap() {
+
+	std::vector<cv::Point2f> pixelsRaw;
+	std::vector<cv::Point2f> pixelsIdeal;
+	pixelsRaw.reserve( size_t( CONFIG_CAM_WIDTH ) * CONFIG_CAM_HEIGHT );
+
+	for ( int y = 0; y < CONFIG_CAM_HEIGHT; y++ ) {
+		for ( int x = 0; x < CONFIG_CAM_WIDTH; x++ ) {
+			pixelsRaw.emplace_back( float( x ), float( y ) );
+		}
+	}
+
+	// Same camera matrix as the undistorted display so the two spaces line up
+	cv::undistortPoints( pixelsRaw, pixelsIdeal, CONFIG_CAMERA_MATRIX, CONFIG_DISTORTION_COEFFS, cv::noArray(), CONFIG_CAMERA_MATRIX );
+
+	matDistortMapX.create( CONFIG_CAM_HEIGHT, CONFIG_CAM_WIDTH, CV_32FC1 );
+	matDistortMapY.create( CONFIG_CAM_HEIGHT, CONFIG_CAM_WIDTH, CV_32FC1 );
+	for ( int y = 0; y < CONFIG_CAM_HEIGHT; y++ ) {
+		float* mapX = matDistortMapX.ptr<float>( y );
+		float* mapY = matDistortMapY.ptr<float>( y );
+		for ( int x = 0; x < CONFIG_CAM_WIDTH; x++ ) {
+			const cv::Point2f& point = pixelsIdeal[size_t( y ) * CONFIG_CAM_WIDTH + x];
+			mapX[x]					 = point.x;
+			mapY[x]					 = point.y;
+		}
+	}
+}
+
+
+/**
+ * @brief Marker image with a white quiet zone, rendered once per id
+ */
+const cv::Mat& SceneGeneratorClass::MarkerPatch( int id ) {
+
+	cv::Mat& patch = markerPatches.at( id );
+
+	if ( patch.empty() ) {
+		cv::Mat marker;
+		int		quietPX = patchQuietCells * patchCellPX;
+		cv::aruco::generateImageMarker( arucoDictionary, id, ( arucoDictionary.markerSize + 2 ) * patchCellPX, marker, 1 );
+		cv::copyMakeBorder( marker, marker, quietPX, quietPX, quietPX, quietPX, cv::BORDER_CONSTANT, cv::Scalar( 255 ) );
+		marker.convertTo( patch, CV_32F );
+	}
+
+	return patch;
+}
+
+
+/**
+ * @brief Marker corners in the marker frame, same order and convention as ArucoClass
+ */
+std::vector<cv::Point3f> SceneGeneratorClass::MarkerObjectPoints( float widthMM ) const {
+	return { cv::Point3f( -widthMM / 2.f, widthMM / 2.f, 0 ), cv::Point3f( widthMM / 2.f, widthMM / 2.f, 0 ), cv::Point3f( widthMM / 2.f, -widthMM / 2.f, 0 ), cv::Point3f( -widthMM / 2.f, -widthMM / 2.f, 0 ) };
+}
+
+
+/**
+ * @brief Draw one marker into the ideal pinhole image
+ *
+ * @param marker Marker id, size and orientation
+ * @param tvec Position to render at, may differ from marker.tvec inside a motion trail
+ * @param image CV_32FC1 ideal image, drawn over in place
+ */
+void SceneGeneratorClass::RenderIdeal( const SceneMarkerStruct& marker, const cv::Vec3d& tvec, cv::Mat& image ) {
+
+	// Nothing to draw behind the camera
+	if ( tvec[2] <= 1.0 ) {
+		return;
+	}
+
+	// Outer border corners in ideal image space
+	std::vector<cv::Point2f> cornersIdeal;
+	cv::projectPoints( MarkerObjectPoints( marker.widthMM ), marker.rvec, tvec, CONFIG_CAMERA_MATRIX, cv::noArray(), cornersIdeal );
+
+	// Same corners in patch space, pixel centres sit on integer coordinates
+	const cv::Mat&			 patch		  = MarkerPatch( marker.id );
+	const float				 edgeNear	  = patchQuietCells * patchCellPX - 0.5f;
+	const float				 edgeFar	  = edgeNear + ( arucoDictionary.markerSize + 2 ) * patchCellPX;
+	std::vector<cv::Point2f> cornersPatch = { cv::Point2f( edgeNear, edgeNear ), cv::Point2f( edgeFar, edgeNear ), cv::Point2f( edgeFar, edgeFar ), cv::Point2f( edgeNear, edgeFar ) };
+	cv::Mat					 homography	  = cv::getPerspectiveTransform( cornersPatch, cornersIdeal );
+
+	// Only warp the part of the image the patch covers
+	std::vector<cv::Point2f> outlinePatch = { cv::Point2f( -0.5f, -0.5f ), cv::Point2f( patch.cols - 0.5f, -0.5f ), cv::Point2f( patch.cols - 0.5f, patch.rows - 0.5f ), cv::Point2f( -0.5f, patch.rows - 0.5f ) };
+	std::vector<cv::Point2f> outlineIdeal;
+	cv::perspectiveTransform( outlinePatch, outlineIdeal, homography );
+	cv::Rect roi = cv::boundingRect( outlineIdeal ) & cv::Rect( 0, 0, image.cols, image.rows );
+	if ( roi.empty() ) {
+		return;
+	}
+
+	// Shift the homography into the region of interest
+	cv::Mat shift		= ( cv::Mat_<double>( 3, 3 ) << 1, 0, -roi.x, 0, 1, -roi.y, 0, 0, 1 );
+	cv::Mat imageRegion = image( roi );
+	cv::warpPerspective( patch, imageRegion, shift * homography, roi.size(), cv::INTER_LINEAR, cv::BORDER_TRANSPARENT );
+}
+
+
+/**
+ * @brief Render a frame and report the ground truth it was rendered from
+ *
+ * @param markers Markers in the scene
+ * @param settings Degradations to apply
+ * @param frame CV_8UC3 output frame, camera sized
+ * @param truth Poses and corners of every marker that was rendered
+ */
+void SceneGeneratorClass::Render( const std::vector<SceneMarkerStruct>& markers, const SceneSettingsStruct& settings, cv::Mat& frame, SceneGroundTruthStruct& truth ) {
+
+	const cv::Size frameSize( CONFIG_CAM_WIDTH, CONFIG_CAM_HEIGHT );
+	const int	   nSteps = std::max( 1, settings.trailSteps );
+
+	matIdeal.create( frameSize, CV_32FC1 );
+	if ( nSteps > 1 ) {
+		matIdealSum.create( frameSize, CV_32FC1 );
+		matIdealSum.setTo( 0.0 );
+	}
+
+	// Average sub-renders spread evenly over the shutter time, centred on the given pose
+	for ( int step = 0; step < nSteps; step++ ) {
+
+		double timeOffsetS = ( nSteps > 1 ) ? ( double( step ) / ( nSteps - 1 ) - 0.5 ) * settings.exposureTimeS : 0.0;
+
+		matIdeal.setTo( settings.background );
+		for ( const SceneMarkerStruct& marker : markers ) {
+			RenderIdeal( marker, marker.tvec + marker.velocityMMS * timeOffsetS, matIdeal );
+		}
+
+		if ( nSteps > 1 ) {
+			matIdealSum += matIdeal;
+		}
+	}
+	if ( nSteps > 1 ) {
+		matIdealSum.convertTo( matIdeal, CV_32F, 1.0 / nSteps );
+	}
+
+	// Lens distortion
+	cv::remap( matIdeal, matRaw, matDistortMapX, matDistortMapY, cv::INTER_LINEAR, cv::BORDER_CONSTANT, cv::Scalar( settings.background ) );
+
+	// Optics
+	if ( settings.blurSigmaPX > 0.0 ) {
+		cv::GaussianBlur( matRaw, matRaw, cv::Size( 0, 0 ), settings.blurSigmaPX );
+	}
+
+	// Shutter
+	if ( settings.exposureGain != 1.0 || settings.exposureOffset != 0.0 ) {
+		matRaw.convertTo( matRaw, CV_32F, settings.exposureGain, settings.exposureOffset );
+	}
+
+	// Sensor
+	if ( settings.noiseSigma > 0.0 ) {
+		matNoise.create( frameSize, CV_32FC1 );
+		rng.fill( matNoise, cv::RNG::NORMAL, 0.0, settings.noiseSigma );
+		matRaw += matNoise;
+	}
+
+	// Saturate to 8 bit and hand out in the camera's format
+	matRaw.convertTo( matGray, CV_8U );
+	cv::cvtColor( matGray, frame, cv::COLOR_GRAY2BGR );
+
+	// Ground truth
+	truth.ids.clear();
+	truth.rvecs.clear();
+	truth.tvecs.clear();
+	truth.positionsMM.clear();
+	truth.cornersRawPX.clear();
+	truth.cornersUndistortedPX.clear();
+
+	for ( const SceneMarkerStruct& marker : markers ) {
+
+		if ( marker.tvec[2] <= 1.0 ) {
+			continue;
+		}
+
+		std::vector<cv::Point2f> cornersRaw, cornersUndistorted;
+		cv::projectPoints( MarkerObjectPoints( marker.widthMM ), marker.rvec, marker.tvec, CONFIG_CAMERA_MATRIX, CONFIG_DISTORTION_COEFFS, cornersRaw );
+		cv::projectPoints( MarkerObjectPoints( marker.widthMM ), marker.rvec, marker.tvec, CONFIG_CAMERA_MATRIX, cv::noArray(), cornersUndistorted );
+
+		truth.ids.push_back( marker.id );
+		truth.rvecs.push_back( marker.rvec );
+		truth.tvecs.push_back( marker.tvec );
+		truth.positionsMM.emplace_back( marker.tvec[0], -marker.tvec[1], marker.tvec[2] );
+		truth.cornersRawPX.push_back( cornersRaw );
+		truth.cornersUndistortedPX.push_back( cornersUndistorted );
+	}
+}
+
+
+/**
+ * @brief Place a marker at a random pose inside a box in front of the camera
+ *
+ * @param marker Marker to move, id and size are kept
+ * @param rangeXYMM Half-width of the box in x and y
+ * @param minZMM Nearest distance
+ * @param maxZMM Farthest distance
+ * @param maxTiltDEG Largest tilt away from facing the camera
+ */
+void SceneGeneratorClass::RandomPose( SceneMarkerStruct& marker, double rangeXYMM, double minZMM, double maxZMM, double maxTiltDEG ) {
+
+	marker.tvec = cv::Vec3d( rng.uniform( -rangeXYMM, rangeXYMM ), rng.uniform( -rangeXYMM, rangeXYMM ), rng.uniform( minZMM, maxZMM ) );
+
+	// Facing the camera, then tilted about a random in-plane axis, then spun about its normal
+	double	tiltAxis = rng.uniform( 0.0, 2.0 * CV_PI );
+	double	tilt	 = rng.uniform( 0.0, maxTiltDEG ) * CV_PI / 180.0;
+	double	spin	 = rng.uniform( -CV_PI, CV_PI );
+	cv::Mat rotFacing, rotTilt, rotSpin, rotation;
+	cv::Rodrigues( cv::Vec3d( CV_PI, 0.0, 0.0 ), rotFacing );
+	cv::Rodrigues( cv::Vec3d( std::cos( tiltAxis ), std::sin( tiltAxis ), 0.0 ) * tilt, rotTilt );
+	cv::Rodrigues( cv::Vec3d( 0.0, 0.0, spin ), rotSpin );
+	rotation = rotFacing * rotTilt * rotSpin;
+	cv::Rodrigues( rotation, marker.rvec );
+}
@@ -16,6 +16,16 @@
 // System data manager
 #include "SystemDataManager.h"
 
+// Control tick state and command
+#include "ControllerClass.h"
+
+// Trace events
+#include "TraceClass.h"
+
+// Reader thread wakeups
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
 
 
 /**
@@ -136,9 +146,66 @@ void SerialClass::InitializePort1() {
 
 
 
+/**
+ * @brief Stop the reader thread and close the ports when the object goes out of scope
+ */
+SerialClass::~SerialClass() {
+	Close();
+}
+
+
+
+/**
+ * @brief Launch the reader thread on the incoming port
+ */
+void SerialClass::Start() {
+
+	// Already running, or nothing to read
+	if ( isReceiveRunning || !shared->Serial.isSerialReceiveOpen ) {
+		return;
+	}
+
+	wakeFd = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+	if ( wakeFd < 0 ) {
+		printf( "SerialClass:  Error %i from eventfd: %s\n", errno, strerror( errno ) );
+		return;
+	}
+
+	framer.Reset();
+	isReceiveRunning = true;
+	receiveThread	 = std::thread( &SerialClass::ReceiveLoop, this );
+}
+
+
+
+/**
+ * @brief Stop the reader thread, report the receive statistics and close the ports
+ */
 void SerialClass::Close() {
-	close( SerialOut );
-	close( SerialIn );
+
+	// Reader thread
+	isReceiveRunning = false;
+	if ( receiveThread.joinable() ) {
+		uint64_t wake = 1;
+		if ( write( wakeFd, &wake, sizeof( wake ) ) < 0 ) {
+			printf( "SerialClass:  Error %i waking the reader: %s\n", errno, strerror( errno ) );
+		}
+		receiveThread.join();
+
+		const SerialCountersStruct& counters = framer.Counters();
+		std::cout << "SerialClass:  Reader stopped, " << counters.nPackets << " packets, " << counters.nFramingErrors << " framing errors, " << counters.nChecksumErrors << " checksum errors, "
+				  << counters.nBytesSkipped << " bytes skipped, " << counters.nDropped << " dropped.\n";
+	}
+
+	// Ports
+	for ( int* fd : { &wakeFd, &SerialOut, &SerialIn } ) {
+		if ( *fd >= 0 ) {
+			close( *fd );
+			*fd = -1;
+		}
+	}
+	shared->Serial.isSerialSendOpen	   = false;
+	shared->Serial.isSerialReceiveOpen = false;
 }
 
 
@@ -161,35 +228,69 @@ void SerialClass::Close() {
 
 
 /**
- * @brief Update serial interface
- * 
+ * @brief Send the current command, from the main loop or the control thread
+ *
+ * Only reads its arguments and its own packet counter, never shared data the main loop writes.
+ *
+ * @param lane Trace lane of the calling thread
+ * @param settings Main loop state as of the last control tick
+ * @param command Controller result to send
+ * @return Time the packet was written, default if nothing went out
  */
-void SerialClass::Update() {
+std::chrono::steady_clock::time_point SerialClass::Send( traceLaneEnum lane, const ControlSettingsStruct& settings, const ControlOutputStruct& command ) {
 
 	// Make sure outgoing serial port is open and running
-	if ( shared->Serial.isSerialSendOpen && shared->Serial.isSerialSending ) {
+	if ( settings.isSending ) {
 
 		// Send packet
-		SendPacketToTeensy();
+		return SendPacketToTeensy( lane, settings, command );
 	}
+	return {};
+}
 
-	// Make sure incoming serial port is open and running
-	if ( shared->Serial.isSerialReceiveOpen && shared->Serial.isSerialReceiving ) {
 
-		PacketStruct incomingPacket;
 
-		if ( ReadTeensyPacket( incomingPacket ) ) {
+/**
+ * @brief Apply the amplifier feedback read since the last call and format the packets for the display
+ */
+void SerialClass::Receive() {
 
-			ParsePacketFromTeensy( incomingPacket );
+	// Strings are only touched on the main loop
+	if ( isSendFailed.exchange( false, std::memory_order_relaxed ) ) {
+		shared->Serial.packetOut = "FAILED!";
+	} else if ( sentPackets.Acquire() ) {
+		ConvertPacketToSerialString( sentPackets.ReadBuffer() );
+	}
 
-			// Calculate time
-			elapsedTimeNow			   = shared->Timing.elapsedRunningTime;
-			shared->Serial.packetDelay = ( elapsedTimeNow - elapsedTimeLast ) * 1000.0f;
-			elapsedTimeLast			   = elapsedTimeNow;
+	// Every packet in order, so no state change or sample is missed, the newest one is shown
+	ReceivedPacketStruct received;
+	PacketStruct		 packet;
+	bool				 isReceived = false;
+	while ( receivedPackets.Pop( received ) ) {
 
+		// Port stays drained while receiving is switched off
+		if ( !shared->Serial.isSerialReceiving ) {
+			continue;
+		}
 
-		} else {
+		packet = received.frame.isTelemetry ? AppendTelemetryFromTeensy( received.frame.telemetry ) : received.frame.packet;
+		ParsePacketFromTeensy( packet );
+
+		// Time between packets
+		if ( timeReceivedLast.time_since_epoch().count() != 0 ) {
+			float delayMS			   = std::chrono::duration<float, std::milli>( received.timeReceived - timeReceivedLast ).count();
+			shared->Serial.packetDelay = int8_t( std::clamp( delayMS, 0.0f, 127.0f ) );
 		}
+		timeReceivedLast = received.timeReceived;
+		isReceived		 = true;
+	}
+	if ( isReceived ) {
+		ConvertPacketToSerialString( packet );
+	}
+
+	// Receive statistics
+	if ( receiveCounters.Acquire() ) {
+		shared->Serial.counters = receiveCounters.ReadBuffer();
 	}
 }
 
@@ -212,7 +313,9 @@ void SerialClass::Update() {
 
 
 
-void SerialClass::SendPacketToTeensy() {
+std::chrono::steady_clock::time_point SerialClass::SendPacketToTeensy( traceLaneEnum lane, const ControlSettingsStruct& settings, const ControlOutputStruct& command ) {
+
+	TraceScope trace( shared->Trace, lane, traceEventEnum::SERIAL_WRITE );
 
 	// Local
 	uint8_t		 buffer[32];
@@ -220,48 +323,45 @@ void SerialClass::SendPacketToTeensy() {
 	PacketStruct outgoingPacket;
 	uint8_t		 newType;
 
-	if ( shared->System.state == stateEnum::IDLE ) {
+	if ( settings.state == stateEnum::IDLE ) {
 		newType = 'I';
-	} else if ( shared->System.state == stateEnum::DRIVING_PWM ) {
+	} else if ( settings.state == stateEnum::DRIVING_PWM ) {
 		newType = 'D';
-	} else if ( shared->System.state == stateEnum::MEASURING_LIMITS ) {
+	} else if ( settings.state == stateEnum::MEASURING_LIMITS ) {
 		newType = 'L';
-	} else if ( shared->System.state == stateEnum::ZERO_ENCODER ) {
+	} else if ( settings.state == stateEnum::ZERO_ENCODER ) {
 		newType = 'Z';
 	} else {
 		// Nope
 	}
 
 
-	const uint8_t startByte	   = 0xAA;
-	const uint8_t endByte	   = 0x55;
-	const uint8_t packetLength = sizeof( outgoingPacket );
-
-	if ( shared->Amplifier.packetCounter == 99 ) {
-		shared->Amplifier.packetCounter = 0;
+	// Outgoing count, the Teensy's own count comes back in Amplifier.packetCounter
+	if ( packetCounter == 99 ) {
+		packetCounter = 0;
 	} else {
-		shared->Amplifier.packetCounter++;
+		packetCounter++;
 	}
 
 	// Populate packet
 	outgoingPacket.packetType	  = newType;
-	outgoingPacket.packetCounter  = shared->Amplifier.packetCounter;
-	outgoingPacket.amplifierState = shared->Amplifier.isAmplifierActive;
+	outgoingPacket.packetCounter  = packetCounter;
+	outgoingPacket.amplifierState = settings.isAmplifierActive;
 
 
-	if ( shared->System.state == stateEnum::IDLE ) {
+	if ( settings.state == stateEnum::IDLE ) {
 		outgoingPacket.pwmA = 2048;
 		outgoingPacket.pwmB = 2048;
 		outgoingPacket.pwmC = 2048;
 		// outgoingPacket.safetySwitch = shared->Vibration.isRunning;
 	} else {
-		outgoingPacket.pwmA = shared->Controller.commandedPwmABC.x;
-		outgoingPacket.pwmB = shared->Controller.commandedPwmABC.y;
-		outgoingPacket.pwmC = shared->Controller.commandedPwmABC.z;
+		outgoingPacket.pwmA = command.commandedPwmABC.x;
+		outgoingPacket.pwmB = command.commandedPwmABC.y;
+		outgoingPacket.pwmC = command.commandedPwmABC.z;
 
 		// Toggle Reverse
-		if ( shared->Controller.toggleReverse && shared->Task.isRunning ) {
-			if ( shared->Amplifier.isReverseConstant ) {
+		if ( settings.isReverseRequested ) {
+			if ( settings.isReverseConstant ) {
 				outgoingPacket.reverseToggle = 1;
 			} else {
 				outgoingPacket.reverseToggle = 2;
@@ -273,33 +373,25 @@ void SerialClass::SendPacketToTeensy() {
 		outgoingPacket.reverseToggle = 0;
 	}
 
-	// Compute checksum
-	uint8_t	 checkSum = newType ^ packetLength;
-	uint8_t* raw	  = reinterpret_cast<uint8_t*>( &outgoingPacket );
-	for ( uint8_t i = 0; i < packetLength; ++i ) {
-		checkSum ^= raw[i];
-	}
-
-	// Build packet buffer
-	buffer[idx++] = startByte;		 // 0xAA
-	buffer[idx++] = packetLength;	 // sizeof(outgoingPacket)
-	buffer[idx++] = checkSum;		 // sizeof(outgoingPacket)
-
-	memcpy( &buffer[idx], &outgoingPacket, packetLength );
-	idx += packetLength;
-	buffer[idx++] = endByte;	// sizeof(outgoingPacket)
+	// Frame packet
+	idx = EncodePacket( outgoingPacket, buffer );
 
 	// Send over serial port 0
 	ssize_t bytesWritten = write( SerialOut, buffer, idx );
 	if ( bytesWritten < 0 ) {
-		shared->Serial.packetOut = "FAILED!";
+		isSendFailed.store( true, std::memory_order_relaxed );
 		std::cout << "SerialClass: Failed to send packet!\n";
-	} else {
-
-		// std::cout << "Outgoing Packet: " << outgoingPacket.packetType << "\n";
-		// StringOutput( buffer );
-		ConvertPacketToSerialString( outgoingPacket );
+		return {};
 	}
+
+	// Command is on the wire
+	std::chrono::steady_clock::time_point timeSent = std::chrono::steady_clock::now();
+
+	// std::cout << "Outgoing Packet: " << outgoingPacket.packetType << "\n";
+	// StringOutput( buffer );
+	sentPackets.WriteBuffer() = outgoingPacket;
+	sentPackets.Publish();
+	return timeSent;
 }
 
 
@@ -321,67 +413,95 @@ void SerialClass::SendPacketToTeensy() {
 
 
 
-bool SerialClass::ReadTeensyPacket( PacketStruct& outPacket ) {
-
-	constexpr uint8_t START_BYTE = 0xAA;
-	constexpr uint8_t END_BYTE	 = 0x55;	// Assumed
-
-	uint8_t buffer[32];
-	size_t	bufferIndex = 0;
-	// std::cout << "Attempt read...";
+/**
+ * @brief Reader thread body, sleeps in epoll until bytes arrive and decodes everything available
+ */
+void SerialClass::ReceiveLoop() {
+
+	// Incoming port and the shutdown wakeup
+	int			epollFd = epoll_create1( EPOLL_CLOEXEC );
+	epoll_event event {};
+	event.events  = EPOLLIN;
+	event.data.fd = SerialIn;
+	bool isReady  = epollFd >= 0 && epoll_ctl( epollFd, EPOLL_CTL_ADD, SerialIn, &event ) == 0;
+	event.data.fd = wakeFd;
+	isReady		  = isReady && epoll_ctl( epollFd, EPOLL_CTL_ADD, wakeFd, &event ) == 0;
+	if ( !isReady ) {
+		printf( "SerialClass:  Error %i setting up the reader: %s\n", errno, strerror( errno ) );
+		if ( epollFd >= 0 ) {
+			close( epollFd );
+		}
+		return;
+	}
 
-	// Sync: look for START_BYTE
-	while ( true ) {
+	epoll_event		   events[2];
+	FramedPacketStruct packet;
 
-		uint8_t byte;
+	while ( isReceiveRunning ) {
 
-		if ( read( SerialIn, &byte, 1 ) <= 0 ) {
+		int nEvents = epoll_wait( epollFd, events, 2, -1 );
+		if ( nEvents < 0 ) {
+			if ( errno == EINTR ) {
+				continue;
+			}
+			printf( "SerialClass:  Error %i from epoll_wait: %s\n", errno, strerror( errno ) );
+			break;
+		}
 
-			std::cout << "ReadTeensyPacket: Empty!     ";
-			return false;	 // Read fail
+		bool isPortEvent = false;
+		for ( int e = 0; e < nEvents; e++ ) {
+			if ( events[e].data.fd == SerialIn ) {
+				isPortEvent = true;
+				if ( events[e].events & ( EPOLLERR | EPOLLHUP ) ) {
+					std::cout << "SerialClass:  Serial interface " << CONFIG_SERIAL_PORT_1 << " closed, reader stopped.\n";
+					isReceiveRunning = false;
+				}
+			}
 		}
-		if ( byte == START_BYTE ) {
-			// std::cout << "Byte detected     ";
+		if ( !isPortEvent || !isReceiveRunning ) {
+			continue;
 		}
-		break;
-	}
 
-	// Read packetLength and checksum
-	if ( read( SerialIn, buffer, 2 ) != 2 ) {
-		std::cout << "ReadTeensyPacket: Not equal 2";
-		return false;
-	}
+		TraceScope trace( shared->Trace, traceLaneEnum::SERIAL, traceEventEnum::SERIAL_READ );
 
-	uint8_t packetLength	 = buffer[0];
-	uint8_t expectedChecksum = buffer[1];
+		// Everything the port holds, straight into the framer's ring
+		while ( true ) {
 
-	// Read payload + 2 footer bytes (0x00 + END_BYTE)
-	if ( read( SerialIn, buffer, packetLength + 1 ) != static_cast<ssize_t>( packetLength + 1 ) ) {
-		std::cout << "ReadTeensyPacket: Wrong size";
-		return false;
-	}
+			size_t	 nFree	= 0;
+			uint8_t* space	= framer.WriteSpace( nFree );
+			ssize_t	 nBytes = read( SerialIn, space, nFree );
+			if ( nBytes <= 0 ) {
+				break;
+			}
+			framer.Commit( size_t( nBytes ) );
+
+			// Hand complete packets on as they are found
+			auto timeReceived = std::chrono::steady_clock::now();
+			while ( framer.Next( packet ) ) {
+				if ( !receivedPackets.Push( { packet, timeReceived } ) ) {
+					framer.Counters().nDropped++;
+				}
+			}
+		}
 
-	// Validate checksum
-	uint8_t actualChecksum = buffer[0] ^ packetLength;
-	for ( size_t i = 0; i < packetLength; ++i ) {
-		actualChecksum ^= buffer[i];
+		receiveCounters.WriteBuffer() = framer.Counters();
+		receiveCounters.Publish();
 	}
 
-	if ( actualChecksum != expectedChecksum ) {
-		std::cout << "ReadTeensyPacket: Checksum mismatch!" << std::endl;
-		return false;
-	}
+	close( epollFd );
+}
 
-	// Validate footer
-	if ( buffer[packetLength] != END_BYTE ) {
-		std::cout << "ReadTeensyPacket: Invalid footer!" << std::endl;
-		return false;
-	}
 
 
-	// Copy payload into struct
-	std::memcpy( &outPacket, buffer, sizeof( PacketStruct ) );
-	return true;
+/**
+ * @brief Frame a packet for the Teensy: start byte, length, checksum, payload, end byte
+ *
+ * @param packet Payload
+ * @param buffer At least sizeof( PacketStruct ) + 4 bytes
+ * @return size_t Number of bytes to write
+ */
+size_t SerialClass::EncodePacket( const PacketStruct& packet, uint8_t* buffer ) {
+	return PacketFramerClass::Encode( reinterpret_cast<const uint8_t*>( &packet ), sizeof( PacketStruct ), buffer );
 }
 
 
@@ -438,9 +558,64 @@ void SerialClass::ParsePacketFromTeensy( PacketStruct pkt ) {
 	if ( pkt.packetType == 'z' ) {
 		shared->System.state = stateEnum::IDLE;
 	}
+}
+
+
+
+/**
+ * @brief Append every sample of a telemetry batch to the amplifier history
+ *
+ * Samples the Teensy dropped before sending, or that were lost on the wire, show up as a gap in
+ * the sample index and are counted.
+ *
+ * @param telemetry Batch from the Teensy
+ * @return PacketStruct Header and newest sample, for the same handling as a single packet
+ */
+PacketStruct SerialClass::AppendTelemetryFromTeensy( const TelemetryPacketStruct& telemetry ) {
+
+	AmplifierHistoryStruct& history	 = shared->AmplifierHistory;
+	const uint8_t			nSamples = std::min( telemetry.nSamples, TELEMETRY_BATCH_SIZE );
+
+	// Gap since the last batch
+	if ( history.nSamples > 0 ) {
+		history.nSamplesLost += uint16_t( telemetry.sampleIndex - history.sampleIndexNext );
+	}
+	history.sampleIndexNext = uint16_t( telemetry.sampleIndex + nSamples );
+
+	for ( uint8_t i = 0; i < nSamples; i++ ) {
+		history.samples[history.nSamples % CONFIG_AMPLIFIER_HISTORY_SIZE] = telemetry.samples[i];
+		history.nSamples++;
+	}
+
+	// Newest readings, the last ones stand when the batch is empty
+	PacketStruct packet;
+	packet.packetType	  = telemetry.packetType;
+	packet.packetCounter  = telemetry.packetCounter;
+	packet.amplifierState = telemetry.amplifierState;
+	packet.reverseToggle  = telemetry.reverseToggle;
+	packet.pwmA			  = shared->Amplifier.measuredPwmA;
+	packet.pwmB			  = shared->Amplifier.measuredPwmB;
+	packet.pwmC			  = shared->Amplifier.measuredPwmC;
+	packet.currentA		  = shared->Amplifier.currentMeasuredRawA;
+	packet.currentB		  = shared->Amplifier.currentMeasuredRawB;
+	packet.currentC		  = shared->Amplifier.currentMeasuredRawC;
+	packet.encoderA		  = shared->Amplifier.encoderMeasuredCountA;
+	packet.encoderB		  = shared->Amplifier.encoderMeasuredCountB;
+	packet.encoderC		  = shared->Amplifier.encoderMeasuredCountC;
+	if ( nSamples > 0 ) {
+		const TelemetrySampleStruct& newest = telemetry.samples[nSamples - 1];
+		packet.pwmA							= newest.pwmA;
+		packet.pwmB							= newest.pwmB;
+		packet.pwmC							= newest.pwmC;
+		packet.currentA						= newest.currentA;
+		packet.currentB						= newest.currentB;
+		packet.currentC						= newest.currentC;
+		packet.encoderA						= newest.encoderA;
+		packet.encoderB						= newest.encoderB;
+		packet.encoderC						= newest.encoderC;
+	}
 
-	// Save as string
-	ConvertPacketToSerialString( pkt );
+	return packet;
 }
 
 
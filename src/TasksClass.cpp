@@ -73,7 +73,9 @@ void TasksClass::Calibration() {
 				shared->Task.state	   = taskEnum::IDLE;
 
 				std::cout << "TASK COMPLETE!";
-				cv::imshow( winTaskBackground, 0 );
+				if ( !shared->System.isHeadless ) {
+					cv::imshow( winTaskBackground, 0 );
+				}
 			}
 
 		} else {
@@ -101,7 +103,7 @@ void TasksClass::CalibrationStart() {
 	InitializeInterface( taskEnum::CALIBRATE );
 
 	// Show screen
-	cv::imshow( winTaskBackground, matTaskBackground );
+	ShowInterface();
 }
 
 
@@ -147,7 +149,7 @@ void TasksClass::CalibrationFinish() {
 	isFinishing = true;
 
 	// Show screen
-	cv::imshow( winTaskBackground, matTaskBackground );
+	ShowInterface();
 }
 
 
@@ -227,7 +229,7 @@ void TasksClass::FittsStart() {
 	InitializeInterface( taskEnum::FITTS );
 
 	// Show screen
-	cv::imshow( winTaskBackground, matTaskBackground );
+	ShowInterface();
 
 	// Create timestamp and start task timer
 	shared->Logging.dataAndTime = Timer.GetFullDateAndTime( false );
@@ -344,7 +346,7 @@ void TasksClass::FittsFinish() {
 	cv::putText( matTaskBackground, line5, cv::Point( 10, 220 ), cv::FONT_HERSHEY_SIMPLEX, 0.8, CONFIG_colBlack, 2 );
 
 	// Show updated task field
-	cv::imshow( winTaskBackground, matTaskBackground );
+	ShowInterface();
 
 	// Save data
 	Logger.SavePng( matTaskBackground );
@@ -606,13 +608,27 @@ void TasksClass::LimitsFinish() {
 
 
 
+/**
+ * @brief Show the task field on the touchscreen, skipped in headless mode
+ */
+void TasksClass::ShowInterface() {
+
+	if ( !shared->System.isHeadless ) {
+		cv::imshow( winTaskBackground, matTaskBackground );
+	}
+}
+
+
+
 void TasksClass::InitializeInterface( taskEnum task ) {
 
 	// Configure interface
-	cv::namedWindow( winTaskBackground, cv::WINDOW_FULLSCREEN );
-	cv::setWindowProperty( winTaskBackground, cv::WindowPropertyFlags::WND_PROP_TOPMOST, 1.0 );
-	cv::moveWindow( winTaskBackground, 3440, 0 );
-	cv::setWindowProperty( winTaskBackground, cv::WND_PROP_FULLSCREEN, cv::WINDOW_FULLSCREEN );
+	if ( !shared->System.isHeadless ) {
+		cv::namedWindow( winTaskBackground, cv::WINDOW_FULLSCREEN );
+		cv::setWindowProperty( winTaskBackground, cv::WindowPropertyFlags::WND_PROP_TOPMOST, 1.0 );
+		cv::moveWindow( winTaskBackground, 3440, 0 );
+		cv::setWindowProperty( winTaskBackground, cv::WND_PROP_FULLSCREEN, cv::WINDOW_FULLSCREEN );
+	}
 
 	// Copy marker to mat
 	matTaskBackground = CONFIG_colWhite;
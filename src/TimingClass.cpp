@@ -4,11 +4,25 @@
 // System data manager
 #include "SystemDataManager.h"
 
+// Profiler report
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+
+// Stage trace events
+#include "TraceClass.h"
+
 
 // Constructor
 TimingClass::TimingClass( SystemDataManager& ctx )
 	: dataHandle( ctx )
 	, shared( ctx.getData() ) {
+
+	// Allocate profiler storage up front, nothing is allocated while recording
+	stageRings = std::make_unique<StageRingStruct[]>( size_t( loopStageEnum::COUNT ) );
+	stageScratch.reserve( CONFIG_PROFILER_WINDOW );
+
 	std::cout << "TimingClass:  Timer initialized.\n";
 }
 
@@ -25,6 +39,19 @@ void TimingClass::StartTimer() {
 
 
 
+/**
+ * @brief Convert a steady clock time point to seconds on the elapsedRunningTime clock
+ *
+ * @param time For example a frame's grab time
+ * @return float [s] since StartTimer()
+ */
+float TimingClass::GetRunningTime( std::chrono::steady_clock::time_point time ) const {
+
+	return std::chrono::duration<float>( time - previousTime ).count();
+}
+
+
+
 /**
  * @brief Updates the timer, pulling in current time and calculating average frequency (once per second)
  */
@@ -46,6 +73,18 @@ void TimingClass::Update() {
 		UpdateTaskTime();
 	}
 
+	// Misses are counted per task from the moment it starts
+	if ( shared->Task.isRunning && !wasTaskRunning ) {
+		shared->Timing.nOverrunsTask = 0;
+	}
+	wasTaskRunning = shared->Task.isRunning;
+
+	// Period of the iteration that just finished
+	if ( isLoopTimed ) {
+		UpdateDeadline( std::chrono::duration<float, std::milli>( currentTime - previousLoopTime ).count() );
+	}
+	previousLoopTime = currentTime;
+	isLoopTimed		 = true;
 
 
 	// Check if 1 second has passed
@@ -54,6 +93,10 @@ void TimingClass::Update() {
 		shared->Timing.timestepDT		 = 1.0f / shared->Timing.measuredFrequency;
 		loopCounter						 = 0;
 		previousTimeFreq				 = currentTime;	   // This resets the time every second
+
+		// Refresh the stage percentiles and loop statistics at the same rate
+		UpdateProfile();
+		UpdateLoopStatistics();
 	}
 }
 
@@ -153,4 +196,179 @@ void TimingClass::TaskTimerStop() {
 float TimingClass::TaskTimerGetElapsedSeconds() {
 
 	return taskTimeElapsed.count();
-}
\ No newline at end of file
+}
+
+
+
+/**
+ * @brief Record the time spent in one loop stage
+ *
+ * Single writer per stage: the sample is stored before the counter is published, so UpdateProfile()
+ * never needs a lock.
+ *
+ * @param stage Stage that just finished
+ * @param timeStart When the stage started
+ */
+void TimingClass::RecordStage( loopStageEnum stage, std::chrono::steady_clock::time_point timeStart ) {
+
+	std::chrono::steady_clock::time_point timeEnd	= std::chrono::steady_clock::now();
+	float								  elapsedMS = std::chrono::duration<float, std::milli>( timeEnd - timeStart ).count();
+
+	StageRingStruct& ring = stageRings[size_t( stage )];
+	uint32_t		 n	  = ring.nWritten.load( std::memory_order_relaxed );
+	ring.samplesMS[n % CONFIG_PROFILER_WINDOW].store( elapsedMS, std::memory_order_relaxed );
+	ring.nWritten.store( n + 1, std::memory_order_release );
+	ring.session.Add( elapsedMS );
+	ring.iterationMS += elapsedMS;
+
+	// Same interval on the trace timeline
+	TraceClass::Record( shared->Trace, traceLaneEnum::MAIN, traceEventEnum( stage ), timeStart, timeEnd );
+}
+
+
+
+/**
+ * @brief Check one loop period against the deadline
+ *
+ * A late iteration is blamed on the stage that took longest in it.
+ *
+ * @param periodMS Time between the last two calls to Update()
+ */
+void TimingClass::UpdateDeadline( float periodMS ) {
+
+	periodHistogram.Add( periodMS );
+	periodSumMS += periodMS;
+	periodSumSqMS += double( periodMS ) * periodMS;
+	periodMaxMS = std::max( periodMaxMS, periodMS );
+	nPeriods++;
+
+	if ( periodMS > CONFIG_LOOP_DEADLINE_MS ) {
+
+		size_t culprit = 0;
+		for ( size_t s = 1; s < size_t( loopStageEnum::COUNT ); s++ ) {
+			if ( stageRings[s].iterationMS > stageRings[culprit].iterationMS ) {
+				culprit = s;
+			}
+		}
+
+		stageRings[culprit].nOverruns++;
+		shared->Timing.nOverruns++;
+		shared->Timing.nOverrunsTask += shared->Task.isRunning ? 1 : 0;
+		shared->Timing.lastOverrunStage = loopStageEnum( culprit );
+	}
+
+	for ( size_t s = 0; s < size_t( loopStageEnum::COUNT ); s++ ) {
+		stageRings[s].iterationMS = 0.0f;
+	}
+}
+
+
+
+/**
+ * @brief Period mean, jitter and maximum of the last second, warn when a task runs on a jittery loop
+ */
+void TimingClass::UpdateLoopStatistics() {
+
+	if ( nPeriods == 0 ) {
+		return;
+	}
+
+	double mean					   = periodSumMS / nPeriods;
+	shared->Timing.loopPeriodMS	   = float( mean );
+	shared->Timing.loopJitterMS	   = float( std::sqrt( std::max( 0.0, periodSumSqMS / nPeriods - mean * mean ) ) );
+	shared->Timing.loopPeriodMaxMS = periodMaxMS;
+
+	periodSumMS	  = 0.0;
+	periodSumSqMS = 0.0;
+	periodMaxMS	  = 0.0f;
+	nPeriods	  = 0;
+
+	if ( shared->Task.isRunning && shared->Timing.loopJitterMS > CONFIG_LOOP_JITTER_WARN_MS ) {
+		std::string stage			 = ( shared->Timing.lastOverrunStage == loopStageEnum::COUNT ) ? "none" : loopStageNames[size_t( shared->Timing.lastOverrunStage )];
+		shared->Display.statusString = "Timing: Loop jitter " + shared->FormatDecimal( shared->Timing.loopJitterMS, 1, 1 ) + " ms, " + std::to_string( shared->Timing.nOverrunsTask ) + " deadline misses this task (last: " + stage + ")";
+	}
+}
+
+
+
+/**
+ * @brief Percentiles of the rolling window of every stage into shared data
+ */
+void TimingClass::UpdateProfile() {
+
+	for ( size_t s = 0; s < size_t( loopStageEnum::COUNT ); s++ ) {
+
+		const StageRingStruct& ring = stageRings[s];
+		size_t				   n	= std::min<size_t>( ring.nWritten.load( std::memory_order_acquire ), CONFIG_PROFILER_WINDOW );
+		if ( n == 0 ) {
+			continue;
+		}
+
+		stageScratch.resize( n );
+		for ( size_t i = 0; i < n; i++ ) {
+			stageScratch[i] = ring.samplesMS[i].load( std::memory_order_relaxed );
+		}
+
+		auto rank = [&]( double fraction ) {
+			auto nth = stageScratch.begin() + size_t( fraction * ( n - 1 ) );
+			std::nth_element( stageScratch.begin(), nth, stageScratch.end() );
+			return *nth;
+		};
+
+		StageStatsStruct& stats = shared->Timing.stages[s];
+		stats.p50MS				= rank( 0.50 );
+		stats.p95MS				= rank( 0.95 );
+		stats.p99MS				= rank( 0.99 );
+		stats.maxMS				= *std::max_element( stageScratch.begin(), stageScratch.end() );
+	}
+
+	shared->Timing.stagesRevision++;
+}
+
+
+
+/**
+ * @brief Print the whole-run stage timings and save them next to the task logs
+ *
+ * @param timestamp Appended to the file name
+ */
+void TimingClass::DumpProfile( const std::string& timestamp ) {
+
+	std::filesystem::path folder( CONFIG_LOGGING_PATH );
+	std::error_code		  error;
+	std::filesystem::create_directories( folder, error );
+	std::filesystem::path filename = folder / ( "profile" + timestamp + ".txt" );
+	std::ofstream		  file( filename );
+
+	// Stages, misses are the late iterations each stage was blamed for, the period row has all of them
+	auto printRow = [&]( const char* name, const HistogramClass& hist, uint32_t nMisses ) {
+		std::cout << "  " << std::left << std::setw( 10 ) << name << std::right << std::setw( 9 ) << hist.Count() << std::setw( 9 ) << hist.Mean() << std::setw( 9 ) << hist.Percentile( 0.50 ) << std::setw( 9 ) << hist.Percentile( 0.95 ) << std::setw( 9 ) << hist.Percentile( 0.99 ) << std::setw( 9 ) << hist.Max() << std::setw( 9 ) << nMisses << "\n";
+		file << name << "," << hist.Count() << "," << hist.Mean() << "," << hist.Percentile( 0.50 ) << "," << hist.Percentile( 0.95 ) << "," << hist.Percentile( 0.99 ) << "," << hist.Max() << "," << nMisses << "\n";
+	};
+
+	std::cout << "TimingClass:  Loop stages [ms], deadline " << CONFIG_LOOP_DEADLINE_MS << " ms\n";
+	std::cout << std::left << std::setw( 12 ) << "  stage" << std::right << std::setw( 9 ) << "count" << std::setw( 9 ) << "mean" << std::setw( 9 ) << "p50" << std::setw( 9 ) << "p95" << std::setw( 9 ) << "p99" << std::setw( 9 ) << "max" << std::setw( 9 ) << "misses" << "\n";
+	std::cout << std::fixed << std::setprecision( 2 );
+	file << "stage,count,mean_ms,p50_ms,p95_ms,p99_ms,max_ms,misses\n";
+
+	for ( size_t s = 0; s < size_t( loopStageEnum::COUNT ); s++ ) {
+		printRow( loopStageNames[s], stageRings[s].session, stageRings[s].nOverruns );
+	}
+	printRow( "Period", periodHistogram, shared->Timing.nOverruns );
+	std::cout << std::defaultfloat;
+
+	// Loop period histogram, one row per non-empty bin
+	file << "\nperiod_bin_start_ms,count\n";
+	const std::vector<uint64_t>& bins = periodHistogram.Bins();
+	for ( size_t i = 0; i < bins.size(); i++ ) {
+		if ( bins[i] ) {
+			file << i * periodHistogram.BinWidth() << "," << bins[i] << "\n";
+		}
+	}
+
+	if ( file.is_open() ) {
+		std::cout << "TimingClass:  Saved " << filename.string() << "\n";
+	} else {
+		std::cerr << "TimingClass:  Could not write " << filename << "\n";
+	}
+}
@@ -35,8 +35,11 @@ TouchscreenClass::TouchscreenClass( SystemDataManager& ctx )
  * @brief Deconstructor
  */
 TouchscreenClass::~TouchscreenClass() {
-	XUngrabPointer( displayHandle, CurrentTime );	 // [NEW CODE] Release the pointer grab.
-	XCloseDisplay( displayHandle );
+	if ( displayHandle ) {
+		XUngrabPointer( displayHandle, CurrentTime );	 // [NEW CODE] Release the pointer grab.
+		XCloseDisplay( displayHandle );
+		displayHandle = nullptr;
+	}
 	std::cout << "TouchClass:   X11 shutdown complete.\n";
 }
 
@@ -53,7 +56,10 @@ void TouchscreenClass::GetCursorPosition() {
  */
 void TouchscreenClass::Close() {
 	// Close X11 handle
-	XCloseDisplay( displayHandle );
+	if ( displayHandle ) {
+		XCloseDisplay( displayHandle );
+		displayHandle = nullptr;
+	}
 }
 
 void TouchscreenClass::ParseClick() {
@@ -89,6 +95,11 @@ void TouchscreenClass::ParseClick() {
 
 void TouchscreenClass::ProcessEvents() {
 
+	// No X server (headless machine), touches can only come from a script
+	if ( !displayHandle ) {
+		return;
+	}
+
 	while ( XPending( displayHandle ) ) {
 		XEvent event;
 		XNextEvent( displayHandle, &event );
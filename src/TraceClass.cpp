@@ -0,0 +1,185 @@
+// Call to class header
+#include "TraceClass.h"
+
+// Standard libraries
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+
+// System data manager
+#include "SystemDataManager.h"
+#include "TimingClass.h"
+
+
+// Names are only looked up when the trace is written
+static const char* traceEventNames[] = { "Input", "Capture", "Task", "Detect", "System", "Control", "Touch", "Serial", "Display", "Kalman", "Serial write", "Serial read", "Frame read", "Frame process", "Control tick" };
+static const char* traceLaneNames[]	 = { "Main loop", "Capture thread", "Control thread", "Serial thread" };
+
+static_assert( std::size( traceEventNames ) == size_t( traceEventEnum::COUNT ), "Every trace event needs a name" );
+static_assert( std::size( traceLaneNames ) == size_t( traceLaneEnum::COUNT ), "Every trace lane needs a name" );
+static_assert( size_t( traceEventEnum::DISPLAY ) == size_t( loopStageEnum::DISPLAY ), "Trace events start with the loop stages" );
+
+
+/**
+ * @brief Constructor
+ */
+TraceClass::TraceClass( SystemDataManager& ctx, TimingClass& timing )
+	: dataHandle( ctx )
+	, shared( ctx.getData() )
+	, Timing( timing ) { }
+
+
+
+/**
+ * @brief Start recording right away when enabled in the configuration
+ */
+void TraceClass::Initialize() {
+
+	if ( CONFIG_TRACE_ENABLED ) {
+		Start();
+	}
+}
+
+
+
+/**
+ * @brief Handle start / stop requests from the keyboard
+ */
+void TraceClass::Update() {
+
+	if ( !shared->Trace.isToggleRequested ) {
+		return;
+	}
+	shared->Trace.isToggleRequested = false;
+
+	if ( shared->Trace.isRecording ) {
+		Stop();
+	} else {
+		Start();
+	}
+}
+
+
+
+/**
+ * @brief Write out a recording that is still running at shutdown
+ */
+void TraceClass::Close() {
+
+	if ( shared->Trace.isRecording ) {
+		Stop();
+	}
+}
+
+
+
+/**
+ * @brief Store one complete event in the lane's ring
+ *
+ * Only the thread that owns the lane may call this. The slot is filled before the counter is
+ * published, the newest CONFIG_TRACE_EVENTS events survive.
+ */
+void TraceClass::Record( TraceStruct& trace, traceLaneEnum lane, traceEventEnum event, std::chrono::steady_clock::time_point timeBegin, std::chrono::steady_clock::time_point timeEnd ) {
+
+	if ( !trace.isRecording.load( std::memory_order_acquire ) ) {
+		return;
+	}
+
+	TraceLaneStruct&  ring = trace.lanes[size_t( lane )];
+	uint32_t		  n	   = ring.nWritten.load( std::memory_order_relaxed );
+	TraceEventStruct& slot = ring.events[n % CONFIG_TRACE_EVENTS];
+	slot.beginNS		   = std::chrono::duration_cast<std::chrono::nanoseconds>( timeBegin.time_since_epoch() ).count();
+	slot.endNS			   = std::chrono::duration_cast<std::chrono::nanoseconds>( timeEnd.time_since_epoch() ).count();
+	slot.event			   = event;
+	ring.nWritten.store( n + 1, std::memory_order_release );
+}
+
+
+
+/**
+ * @brief Allocate the rings on first use and start recording
+ */
+void TraceClass::Start() {
+
+	for ( TraceLaneStruct& lane : shared->Trace.lanes ) {
+		if ( !lane.events ) {
+			lane.events = std::make_unique<TraceEventStruct[]>( CONFIG_TRACE_EVENTS );
+		}
+		lane.nStarted = lane.nWritten.load( std::memory_order_acquire );
+	}
+
+	timeStarted = std::chrono::steady_clock::now();
+	shared->Trace.isRecording.store( true, std::memory_order_release );
+
+	shared->Display.statusString = "Trace: Recording.";
+	std::cout << "TraceClass:   Recording started.\n";
+}
+
+
+
+/**
+ * @brief Stop recording and write the trace file
+ */
+void TraceClass::Stop() {
+
+	shared->Trace.isRecording.store( false, std::memory_order_release );
+	Write( Timing.GetFullDateAndTime( false ) );
+}
+
+
+
+/**
+ * @brief Write the current recording as Chrome trace-event JSON
+ *
+ * @param timestamp Appended to the file name
+ */
+void TraceClass::Write( const std::string& timestamp ) {
+
+	std::filesystem::path folder( CONFIG_LOGGING_PATH );
+	std::error_code		  error;
+	std::filesystem::create_directories( folder, error );
+	std::filesystem::path filename = folder / ( "trace" + timestamp + ".json" );
+
+	std::ofstream file( filename );
+	if ( !file.is_open() ) {
+		shared->Display.statusString = "Trace: Could not write file!";
+		std::cerr << "TraceClass:   Could not write " << filename << "\n";
+		return;
+	}
+
+	const int64_t startNS = std::chrono::duration_cast<std::chrono::nanoseconds>( timeStarted.time_since_epoch() ).count();
+	size_t		  nEvents = 0;
+
+	file << std::fixed << std::setprecision( 3 );
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+	// Thread names
+	for ( size_t l = 0; l < size_t( traceLaneEnum::COUNT ); l++ ) {
+		file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << l + 1 << ",\"args\":{\"name\":\"" << traceLaneNames[l] << "\"}},\n";
+	}
+
+	// Complete events, oldest first
+	for ( size_t l = 0; l < size_t( traceLaneEnum::COUNT ); l++ ) {
+
+		const TraceLaneStruct& lane	 = shared->Trace.lanes[l];
+		uint32_t			   n	 = lane.nWritten.load( std::memory_order_acquire );
+		uint32_t			   first = ( n - lane.nStarted > CONFIG_TRACE_EVENTS ) ? n - CONFIG_TRACE_EVENTS : lane.nStarted;
+
+		for ( uint32_t i = first; i != n; i++ ) {
+			const TraceEventStruct& event = lane.events[i % CONFIG_TRACE_EVENTS];
+			if ( event.beginNS < startNS ) {
+				continue;
+			}
+			file << "{\"name\":\"" << traceEventNames[size_t( event.event )] << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << l + 1
+				 << ",\"ts\":" << ( event.beginNS - startNS ) / 1000.0 << ",\"dur\":" << ( event.endNS - event.beginNS ) / 1000.0 << "},\n";
+			nEvents++;
+		}
+	}
+
+	// Closing metadata keeps the list valid JSON without tracking the last comma
+	file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"NURing\"}}\n]}\n";
+
+	shared->Display.statusString = "Trace: Saved " + std::to_string( nEvents ) + " events.";
+	std::cout << "TraceClass:   Saved " << nEvents << " events to " << filename.string() << "\n";
+}
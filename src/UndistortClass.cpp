@@ -0,0 +1,317 @@
+// Call to class header
+#include "UndistortClass.h"
+#include <algorithm>
+#include <opencv2/core/cuda.hpp>
+
+// System data manager
+#include "SystemDataManager.h"
+
+// Fixed-point BGR to gray weights (sum to 256), matching COLOR_BGR2GRAY to within one level
+static constexpr uint16_t GRAY_WEIGHT_B = 29;
+static constexpr uint16_t GRAY_WEIGHT_G = 150;
+static constexpr uint16_t GRAY_WEIGHT_R = 77;
+static constexpr uint16_t GRAY_ROUND	= 128;
+
+// Constructor
+UndistortClass::UndistortClass( SystemDataManager& ctx )
+	: dataHandle( ctx )
+	, shared( ctx.getData() ) {
+
+	Initialize();
+}
+
+
+/**
+ * @brief Build the remap tables once and pick the starting backend
+ */
+void UndistortClass::Initialize() {
+
+	// Configure OpenCV Optimizations
+	cv::setUseOptimized( true );
+
+	// Initialize undistort map tool
+	cv::initUndistortRectifyMap( CONFIG_CAMERA_MATRIX, CONFIG_DISTORTION_COEFFS, cv::Mat(), CONFIG_CAMERA_MATRIX, cv::Size( CONFIG_CAM_WIDTH, CONFIG_CAM_HEIGHT ), CV_32F, shared->Capture.matRemap1, shared->Capture.matRemap2 );
+
+	// Integer source coordinates for nearest-neighbour lookup on the CPU
+	cv::Mat matRemapUnused;
+	cv::convertMaps( shared->Capture.matRemap1, shared->Capture.matRemap2, matRemapFixedXY, matRemapUnused, CV_16SC2, true );
+
+	// Rotating the output 180 degrees is the same as reading the table back to front
+	cv::flip( matRemapFixedXY, matRemapFixedXYRotated, -1 );
+
+	// Byte offsets for the fused gray kernel
+	BuildOffsetTable( matRemapFixedXY, matRemapOffset );
+	BuildOffsetTable( matRemapFixedXYRotated, matRemapOffsetRotated );
+
+	// Contrast and brightness as a lookup table
+	lutContrast.create( 1, 256, CV_8UC1 );
+	for ( int i = 0; i < 256; i++ ) {
+		lutContrast.at<uchar>( i ) = cv::saturate_cast<uchar>( i * CONFIG_CAM_GRAY_ALPHA + CONFIG_CAM_GRAY_BETA );
+	}
+
+	// Check for a usable CUDA device
+#if UNDISTORT_HAS_CUDA
+	shared->Capture.isGpuAvailable = ( cv::cuda::getCudaEnabledDeviceCount() > 0 );
+#else
+	shared->Capture.isGpuAvailable = false;
+#endif
+
+	// Remap tables never change, upload once
+#if UNDISTORT_HAS_CUDA
+	if ( shared->Capture.isGpuAvailable ) {
+		cv::Mat matRemap1Rotated, matRemap2Rotated;
+		cv::flip( shared->Capture.matRemap1, matRemap1Rotated, -1 );
+		cv::flip( shared->Capture.matRemap2, matRemap2Rotated, -1 );
+
+		GpuMatRemap1.upload( shared->Capture.matRemap1 );
+		GpuMatRemap2.upload( shared->Capture.matRemap2 );
+		GpuMatRemap1Rotated.upload( matRemap1Rotated );
+		GpuMatRemap2Rotated.upload( matRemap2Rotated );
+	}
+#endif
+
+	// Select detection space
+	shared->Capture.detectionSpace = CONFIG_DETECT_IN_RAW_SPACE ? detectionSpaceEnum::RAW_CORNERS : detectionSpaceEnum::UNDISTORTED_FRAME;
+
+	// Select starting backend
+	if ( CONFIG_CAPTURE_USE_GPU && shared->Capture.isGpuAvailable ) {
+		shared->Capture.backend = captureBackendEnum::GPU;
+	} else {
+		shared->Capture.backend = captureBackendEnum::CPU;
+	}
+
+	// Output confirmation
+	std::cout << "UndistortClass: Remap tables built, backend = " << ( shared->Capture.backend == captureBackendEnum::GPU ? "GPU" : "CPU" ) << ( shared->Capture.isGpuAvailable ? "" : " (no CUDA device)" ) << ", SIMD = " << ( CV_SIMD128 ? "on" : "off" ) << "\n";
+}
+
+
+/**
+ * @brief Convert integer source coordinates into byte offsets into a continuous BGR frame
+ *
+ * Coordinates that fall outside the camera image are clamped to the nearest edge pixel so the
+ * gather never leaves the frame. Only the outermost corners of the detection image are affected.
+ *
+ * @param mapFixed CV_16SC2 source coordinates
+ * @param mapOffset CV_32SC1 byte offsets
+ */
+void UndistortClass::BuildOffsetTable( const cv::Mat& mapFixed, cv::Mat& mapOffset ) {
+
+	mapOffset.create( mapFixed.size(), CV_32SC1 );
+
+	for ( int row = 0; row < mapFixed.rows; row++ ) {
+		const cv::Vec2s* coordinates = mapFixed.ptr<cv::Vec2s>( row );
+		int*			 offsets	 = mapOffset.ptr<int>( row );
+
+		for ( int col = 0; col < mapFixed.cols; col++ ) {
+			int sourceX	  = std::clamp( int( coordinates[col][0] ), 0, CONFIG_CAM_WIDTH - 1 );
+			int sourceY	  = std::clamp( int( coordinates[col][1] ), 0, CONFIG_CAM_HEIGHT - 1 );
+			offsets[col] = ( sourceY * CONFIG_CAM_WIDTH + sourceX ) * 3;
+		}
+	}
+}
+
+
+/**
+ * @brief Undistort, grayscale and contrast-adjust a frame on the selected backend
+ *
+ * @param frameRaw Camera image
+ * @param frameUndistorted Undistorted color output, only written when requested
+ * @param frameGray Undistorted gray output for detection
+ * @param isColorRequired Produce the color image for this frame
+ */
+void UndistortClass::Process( const cv::Mat& frameRaw, cv::Mat& frameUndistorted, cv::Mat& frameGray, bool isColorRequired ) {
+
+	if ( shared->Capture.backend == captureBackendEnum::GPU && shared->Capture.isGpuAvailable ) {
+		ProcessGPU( frameRaw, frameUndistorted, frameGray, isColorRequired );
+	} else {
+		ProcessCPU( frameRaw, frameUndistorted, frameGray, isColorRequired );
+	}
+}
+
+
+/**
+ * @brief CPU backend, fused single-pass gray kernel split into row bands across cores
+ */
+void UndistortClass::ProcessCPU( const cv::Mat& frameRaw, cv::Mat& frameUndistorted, cv::Mat& frameGray, bool isColorRequired ) {
+
+	// Offsets assume a continuous camera-sized BGR frame
+	if ( frameRaw.type() != CV_8UC3 || frameRaw.size() != matRemapOffset.size() ) {
+		std::cerr << "UndistortClass: Unexpected frame format, expected " << matRemapOffset.cols << " x " << matRemapOffset.rows << " BGR!\n";
+		return;
+	}
+	const cv::Mat source = frameRaw.isContinuous() ? frameRaw : frameRaw.clone();
+
+	// Read flag once so every band agrees
+	const bool isRotated = shared->Capture.rotateCamera;
+
+	// Tables with the rotation already applied
+	const cv::Mat& mapOffset = isRotated ? matRemapOffsetRotated : matRemapOffset;
+	const cv::Mat& mapFixed	 = isRotated ? matRemapFixedXYRotated : matRemapFixedXY;
+
+	// Outputs must exist before the bands write into them
+	frameGray.create( mapOffset.size(), CV_8UC1 );
+	if ( isColorRequired ) {
+		frameUndistorted.create( mapFixed.size(), CV_8UC3 );
+	}
+
+	const int nRows	 = mapOffset.rows;
+	const int nBands = CONFIG_CAPTURE_REMAP_BANDS;
+
+	cv::parallel_for_( cv::Range( 0, nBands ), [&]( const cv::Range& range ) {
+		for ( int band = range.start; band < range.end; band++ ) {
+
+			// Band rows
+			int rowStart = ( nRows * band ) / nBands;
+			int rowEnd	 = ( nRows * ( band + 1 ) ) / nBands;
+
+			// Detection image, one pass per pixel
+			for ( int row = rowStart; row < rowEnd; row++ ) {
+				RemapGrayRow( source.data, mapOffset.ptr<int>( row ), frameGray.ptr<uchar>( row ), frameGray.cols );
+			}
+
+			// Display image
+			if ( isColorRequired ) {
+				cv::Mat bandUndistorted = frameUndistorted.rowRange( rowStart, rowEnd );
+				cv::remap( source, bandUndistorted, mapFixed.rowRange( rowStart, rowEnd ), cv::Mat(), cv::INTER_NEAREST );
+			}
+		}
+	} );
+}
+
+
+/**
+ * @brief Gather, convert to gray and contrast-adjust one output row
+ *
+ * @param source Continuous BGR camera frame
+ * @param offsets Byte offset of the source pixel for every output pixel
+ * @param destination Output gray row
+ * @param width Number of output pixels
+ */
+void UndistortClass::RemapGrayRow( const uchar* source, const int* offsets, uchar* destination, int width ) {
+
+	const uchar* lut = lutContrast.ptr<uchar>();
+	int			 col = 0;
+
+#if CV_SIMD128
+	const int			 nLanes	 = cv::v_uint8x16::nlanes;
+	const cv::v_uint16x8 weightB = cv::v_setall_u16( GRAY_WEIGHT_B );
+	const cv::v_uint16x8 weightG = cv::v_setall_u16( GRAY_WEIGHT_G );
+	const cv::v_uint16x8 weightR = cv::v_setall_u16( GRAY_WEIGHT_R );
+	const cv::v_uint16x8 round	 = cv::v_setall_u16( GRAY_ROUND );
+	uchar				 grayLanes[nLanes];
+
+	for ( ; col <= width - nLanes; col += nLanes ) {
+
+		// Gather the three channels of 16 source pixels
+		cv::v_uint8x16 blue	 = cv::v_lut( source, offsets + col );
+		cv::v_uint8x16 green = cv::v_lut( source + 1, offsets + col );
+		cv::v_uint8x16 red	 = cv::v_lut( source + 2, offsets + col );
+
+		// Widen to 16 bit
+		cv::v_uint16x8 blueLow, blueHigh, greenLow, greenHigh, redLow, redHigh;
+		cv::v_expand( blue, blueLow, blueHigh );
+		cv::v_expand( green, greenLow, greenHigh );
+		cv::v_expand( red, redLow, redHigh );
+
+		// Weighted sum, at most 255 * 256 + 128 so it never wraps
+		cv::v_uint16x8 grayLow	= cv::v_add_wrap( cv::v_add_wrap( cv::v_mul_wrap( blueLow, weightB ), cv::v_mul_wrap( greenLow, weightG ) ), cv::v_add_wrap( cv::v_mul_wrap( redLow, weightR ), round ) );
+		cv::v_uint16x8 grayHigh = cv::v_add_wrap( cv::v_add_wrap( cv::v_mul_wrap( blueHigh, weightB ), cv::v_mul_wrap( greenHigh, weightG ) ), cv::v_add_wrap( cv::v_mul_wrap( redHigh, weightR ), round ) );
+
+		// Back to 8 bit
+		cv::v_store( grayLanes, cv::v_pack( cv::v_shr<8>( grayLow ), cv::v_shr<8>( grayHigh ) ) );
+
+		// Contrast adjustment
+		for ( int lane = 0; lane < nLanes; lane++ ) {
+			destination[col + lane] = lut[grayLanes[lane]];
+		}
+	}
+#endif
+
+	// Remaining pixels
+	for ( ; col < width; col++ ) {
+		const uchar* pixel = source + offsets[col];
+		destination[col]   = lut[( pixel[0] * GRAY_WEIGHT_B + pixel[1] * GRAY_WEIGHT_G + pixel[2] * GRAY_WEIGHT_R + GRAY_ROUND ) >> 8];
+	}
+}
+
+
+/**
+ * @brief GPU backend, remap and gray conversion with CUDA
+ */
+void UndistortClass::ProcessGPU( const cv::Mat& frameRaw, cv::Mat& frameUndistorted, cv::Mat& frameGray, bool isColorRequired ) {
+
+#if UNDISTORT_HAS_CUDA
+	// Tables with the rotation already applied
+	const bool				isRotated = shared->Capture.rotateCamera;
+	const cv::cuda::GpuMat& remap1	  = isRotated ? GpuMatRemap1Rotated : GpuMatRemap1;
+	const cv::cuda::GpuMat& remap2	  = isRotated ? GpuMatRemap2Rotated : GpuMatRemap2;
+
+	// Upload mats to GPU
+	GpuMatFrameRaw.upload( frameRaw );
+
+	// Remap using GPU
+	cv::cuda::remap( GpuMatFrameRaw, GpuMatFrameUndistorted, remap1, remap2, cv::INTER_NEAREST );
+
+	// Convert to grayscale using GPU
+	cv::cuda::cvtColor( GpuMatFrameUndistorted, GpuMatFrameGray, cv::COLOR_BGR2GRAY );
+
+	// Extract frames from GPU
+	if ( isColorRequired ) {
+		GpuMatFrameUndistorted.download( frameUndistorted );
+	}
+	GpuMatFrameGray.download( frameGray );
+
+	// Apply contrast and brightness adjustment
+	cv::LUT( frameGray, lutContrast, frameGray );
+#else
+	ProcessCPU( frameRaw, frameUndistorted, frameGray, isColorRequired );
+#endif
+}
+
+
+/**
+ * @brief Corner-space mode, gray detection image in raw camera space plus an optional display image
+ *
+ * No remap runs for detection. The rotation flag only affects the display image here, ArucoClass
+ * applies it to the undistorted corners instead.
+ */
+void UndistortClass::ProcessRaw( const cv::Mat& frameRaw, cv::Mat& frameUndistorted, cv::Mat& frameGray, bool isColorRequired ) {
+
+	// Bands index the raw frame and the tables with the same rows
+	if ( frameRaw.type() != CV_8UC3 || frameRaw.size() != matRemapFixedXY.size() ) {
+		std::cerr << "UndistortClass: Unexpected frame format, expected " << matRemapFixedXY.cols << " x " << matRemapFixedXY.rows << " BGR!\n";
+		return;
+	}
+
+	// Display table with the rotation already applied
+	const cv::Mat& mapFixed = shared->Capture.rotateCamera ? matRemapFixedXYRotated : matRemapFixedXY;
+
+	// Outputs must exist before the bands write into them
+	frameGray.create( frameRaw.size(), CV_8UC1 );
+	if ( isColorRequired ) {
+		frameUndistorted.create( mapFixed.size(), CV_8UC3 );
+	}
+
+	const int nRows	 = frameRaw.rows;
+	const int nBands = CONFIG_CAPTURE_REMAP_BANDS;
+
+	cv::parallel_for_( cv::Range( 0, nBands ), [&]( const cv::Range& range ) {
+		for ( int band = range.start; band < range.end; band++ ) {
+
+			// Band rows
+			int rowStart = ( nRows * band ) / nBands;
+			int rowEnd	 = ( nRows * ( band + 1 ) ) / nBands;
+
+			// Detection image, convert and adjust in place
+			cv::Mat bandGray = frameGray.rowRange( rowStart, rowEnd );
+			cv::cvtColor( frameRaw.rowRange( rowStart, rowEnd ), bandGray, cv::COLOR_BGR2GRAY );
+			cv::LUT( bandGray, lutContrast, bandGray );
+
+			// Display image
+			if ( isColorRequired ) {
+				cv::Mat bandUndistorted = frameUndistorted.rowRange( rowStart, rowEnd );
+				cv::remap( frameRaw, bandUndistorted, mapFixed.rowRange( rowStart, rowEnd ), cv::Mat(), cv::INTER_NEAREST );
+			}
+		}
+	} );
+}